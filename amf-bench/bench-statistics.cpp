@@ -0,0 +1,166 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "bench-statistics.hpp"
+#include <algorithm>
+#include <cmath>
+
+#pragma warning(push)
+#pragma warning(disable : 4201)
+extern "C" {
+#include <obs-data.h>
+}
+#pragma warning(pop)
+
+#define BENCH_RESULTS_VERSION 1
+
+bool SaveResults(const std::string& file, const BenchResults& results)
+{
+	obs_data_t*       root    = obs_data_create();
+	obs_data_array_t* configs = obs_data_array_create();
+
+	obs_data_set_int(root, "version", BENCH_RESULTS_VERSION);
+	for (auto& kv : results) {
+		obs_data_t*       config = obs_data_create();
+		obs_data_array_t* runs   = obs_data_array_create();
+		for (auto& run : kv.second) {
+			obs_data_t* item = obs_data_create();
+			obs_data_set_double(item, "throughput", run.throughput);
+			obs_data_set_double(item, "latency_p99", run.latencyP99);
+			obs_data_array_push_back(runs, item);
+			obs_data_release(item);
+		}
+		obs_data_set_string(config, "name", kv.first.c_str());
+		obs_data_set_array(config, "runs", runs);
+		obs_data_array_push_back(configs, config);
+		obs_data_array_release(runs);
+		obs_data_release(config);
+	}
+	obs_data_set_array(root, "configurations", configs);
+	obs_data_array_release(configs);
+
+	bool success = obs_data_save_json_safe(root, file.c_str(), "tmp", "bak");
+	obs_data_release(root);
+	return success;
+}
+
+bool LoadResults(const std::string& file, BenchResults& results)
+{
+	obs_data_t* root = obs_data_create_from_json_file(file.c_str());
+	if (!root)
+		return false;
+	if (obs_data_get_int(root, "version") != BENCH_RESULTS_VERSION) {
+		obs_data_release(root);
+		return false;
+	}
+
+	obs_data_array_t* configs = obs_data_get_array(root, "configurations");
+	for (size_t idx = 0, cnt = obs_data_array_count(configs); idx < cnt; idx++) {
+		obs_data_t*       config = obs_data_array_item(configs, idx);
+		obs_data_array_t* runs   = obs_data_get_array(config, "runs");
+
+		std::vector<BenchRun>& dst = results[obs_data_get_string(config, "name")];
+		for (size_t ridx = 0, rcnt = obs_data_array_count(runs); ridx < rcnt; ridx++) {
+			obs_data_t* item = obs_data_array_item(runs, ridx);
+			dst.push_back({obs_data_get_double(item, "throughput"), obs_data_get_double(item, "latency_p99")});
+			obs_data_release(item);
+		}
+
+		obs_data_array_release(runs);
+		obs_data_release(config);
+	}
+	obs_data_array_release(configs);
+	obs_data_release(root);
+	return true;
+}
+
+double Statistics::Mean(const std::vector<double>& v)
+{
+	if (v.empty())
+		return 0;
+	double sum = 0;
+	for (double x : v)
+		sum += x;
+	return sum / v.size();
+}
+
+double Statistics::Variance(const std::vector<double>& v)
+{
+	if (v.size() < 2)
+		return 0;
+	double mean = Mean(v), sum = 0;
+	for (double x : v)
+		sum += (x - mean) * (x - mean);
+	return sum / (v.size() - 1);
+}
+
+double Statistics::Percentile(std::vector<double> v, double p)
+{
+	if (v.empty())
+		return 0;
+	std::sort(v.begin(), v.end());
+	size_t idx = (size_t)std::ceil(p * v.size());
+	return v[idx > 0 ? idx - 1 : 0];
+}
+
+// Two-sided 97.5% quantile of Student's t distribution.
+static double TQuantile(double df)
+{
+	static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+								   2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+								   2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+	if (df < 1)
+		return table[0];
+	if (df > 30)
+		return 1.960;
+	return table[(size_t)std::floor(df) - 1];
+}
+
+Statistics::Comparison Statistics::CompareSamples(const std::vector<double>& baseline,
+												  const std::vector<double>& current, double tolerance,
+												  bool higherIsWorse)
+{
+	Comparison cmp;
+	cmp.baselineMean = Mean(baseline);
+	cmp.currentMean  = Mean(current);
+	cmp.ciLow = cmp.ciHigh = 0;
+	cmp.regression         = false;
+	if ((baseline.size() < 2) || (current.size() < 2) || (cmp.baselineMean == 0))
+		return cmp;
+
+	// Welch-Satterthwaite degrees of freedom.
+	double vb = Variance(baseline) / baseline.size(), vc = Variance(current) / current.size();
+	double se = std::sqrt(vb + vc);
+	double df = (se > 0) ? ((vb + vc) * (vb + vc))
+								/ ((vb * vb) / (baseline.size() - 1) + (vc * vc) / (current.size() - 1))
+						 : 1e9;
+
+	double diff   = cmp.currentMean - cmp.baselineMean;
+	double margin = TQuantile(df) * se;
+	cmp.ciLow     = (diff - margin) / cmp.baselineMean;
+	cmp.ciHigh    = (diff + margin) / cmp.baselineMean;
+
+	// The whole interval must lie beyond the tolerance in the bad direction.
+	if (higherIsWorse) {
+		cmp.regression = cmp.ciLow > tolerance;
+	} else {
+		cmp.regression = cmp.ciHigh < -tolerance;
+	}
+	return cmp;
+}
@@ -0,0 +1,51 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+struct BenchRun {
+	double throughput; // Frames per Second
+	double latencyP99; // Microseconds
+};
+
+// Configuration Name -> Repeated Runs
+typedef std::map<std::string, std::vector<BenchRun>> BenchResults;
+
+bool SaveResults(const std::string& file, const BenchResults& results);
+bool LoadResults(const std::string& file, BenchResults& results);
+
+namespace Statistics {
+	struct Comparison {
+		double baselineMean, currentMean;
+		// 95% confidence interval of the relative change (current - baseline) / baseline.
+		double ciLow, ciHigh;
+		bool   regression;
+	};
+
+	double Mean(const std::vector<double>& v);
+	double Variance(const std::vector<double>& v);
+	double Percentile(std::vector<double> v, double p);
+
+	// Welch's t-test style interval, a regression must be significant and larger than tolerance.
+	Comparison CompareSamples(const std::vector<double>& baseline, const std::vector<double>& current,
+							  double tolerance, bool higherIsWorse);
+} // namespace Statistics
@@ -0,0 +1,1467 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "allocation-tracker.hpp"
+#include "amf-encoder-h264.hpp"
+#include "amf-encoder-h265.hpp"
+#include "amf-encoder-pool.hpp"
+#include "amf.hpp"
+#include "api-base.hpp"
+#include "bench-statistics.hpp"
+#include "bitrate-controller.hpp"
+#include "clock.hpp"
+#include "frame-hash.hpp"
+#include "gop-planner.hpp"
+#include "hrd-model.hpp"
+#include "intra-refresh.hpp"
+#include "lookahead.hpp"
+#include "ltr-manager.hpp"
+#include "scene-detector.hpp"
+#include "temporal-layers.hpp"
+#include "utility.hpp"
+
+#if defined(_WIN32) || defined(_WIN64)
+extern "C" {
+#include <windows.h>
+}
+#endif
+
+using namespace Plugin;
+using namespace Plugin::AMD;
+
+// Not loaded as a module, so there is no locale to look anything up in.
+extern "C" const char* obs_module_text(const char* val)
+{
+	return val;
+}
+
+struct BenchConfiguration {
+	Codec                         codec;
+	ColorFormat                   format;
+	std::pair<uint32_t, uint32_t> resolution;
+	bool                          multiThreaded;
+
+	std::string Name() const
+	{
+		char buf[128];
+		snprintf(buf, sizeof(buf), "%s-%s-%" PRIu32 "x%" PRIu32 "-%s", Utility::CodecToString(codec),
+				 Utility::ColorFormatToString(format), resolution.first, resolution.second,
+				 multiThreaded ? "async" : "sync");
+		return std::string(buf);
+	}
+};
+
+struct BenchOptions {
+	size_t runs      = 5;
+	size_t frames    = 600;
+	size_t warmup    = 60;
+	double tolerance = 0.02;
+	size_t encoders  = 4;
+	size_t duration  = 3600; // Seconds
+	size_t timeout   = 30;   // Seconds without progress until a worker counts as hung
+};
+
+static std::vector<BenchConfiguration> BuildConfigurations()
+{
+	std::vector<BenchConfiguration> configs;
+	for (Codec codec : {Codec::AVC, Codec::HEVC}) {
+		for (ColorFormat format : {ColorFormat::NV12, ColorFormat::I420, ColorFormat::YUY2, ColorFormat::RGBA,
+								   ColorFormat::BGRA, ColorFormat::GRAY}) {
+			for (auto res :
+				 {std::make_pair<uint32_t, uint32_t>(1280, 720), std::make_pair<uint32_t, uint32_t>(1920, 1080)}) {
+				for (bool async : {false, true}) {
+					configs.push_back({codec, format, res, async});
+				}
+			}
+		}
+	}
+	return configs;
+}
+
+static EncoderParameters GetParameters(const BenchConfiguration& cfg)
+{
+	auto api = API::GetAPI(0);
+	return {cfg.codec, api, api->EnumerateAdapters()[0], false, false, cfg.format, ColorSpace::BT709, false,
+			cfg.multiThreaded, 4};
+}
+
+static void ApplySettings(Encoder* enc, const BenchConfiguration& cfg)
+{
+	enc->SetUsage(Usage::Transcoding);
+	enc->SetQualityPreset(QualityPreset::Speed);
+	enc->SetResolution(cfg.resolution);
+	enc->SetFrameRate(std::make_pair<uint32_t, uint32_t>(60, 1));
+	enc->SetRateControlMethod(RateControlMethod::ConstantBitrate);
+	enc->SetTargetBitrate(6000000);
+	enc->SetPeakBitrate(6000000);
+	enc->SetIDRPeriod(120);
+}
+
+static std::unique_ptr<Encoder> CreateEncoder(const BenchConfiguration& cfg)
+{
+	auto enc = GetParameters(cfg).Create();
+	ApplySettings(enc.get(), cfg);
+	return enc;
+}
+
+// Test pattern in the configured format, the first plane gets shifted every frame so the encoder has work to do.
+class SyntheticFrame {
+	public:
+	SyntheticFrame(ColorFormat format, std::pair<uint32_t, uint32_t> resolution)
+		: m_Width(resolution.first), m_Height(resolution.second)
+	{
+		// Plane sizes as OBS hands them over: {bytes per line, lines}.
+		std::vector<std::pair<uint32_t, uint32_t>> planes;
+		switch (format) {
+		case ColorFormat::I420:
+			planes = {{m_Width, m_Height}, {m_Width / 2, m_Height / 2}, {m_Width / 2, m_Height / 2}};
+			break;
+		case ColorFormat::NV12:
+			planes = {{m_Width, m_Height}, {m_Width, m_Height / 2}};
+			break;
+		case ColorFormat::YUY2:
+			planes = {{m_Width * 2, m_Height}};
+			break;
+		case ColorFormat::RGBA:
+		case ColorFormat::BGRA:
+			planes = {{m_Width * 4, m_Height}};
+			break;
+		case ColorFormat::GRAY:
+			planes = {{m_Width, m_Height}};
+			break;
+		}
+
+		std::memset(&m_Frame, 0, sizeof(m_Frame));
+		m_Planes.resize(planes.size());
+		for (size_t idx = 0; idx < planes.size(); idx++) {
+			m_Planes[idx].assign((size_t)planes[idx].first * planes[idx].second, 128);
+			m_Frame.data[idx]     = m_Planes[idx].data();
+			m_Frame.linesize[idx] = planes[idx].first;
+		}
+	}
+
+	struct encoder_frame* Next(size_t index)
+	{
+		uint32_t linesize = m_Frame.linesize[0];
+		for (uint32_t y = 0; y < m_Height; y++)
+			std::memset(m_Planes[0].data() + y * linesize, (int)((y + index) & 0xFF), linesize);
+		m_Frame.pts = (int64_t)index;
+		return &m_Frame;
+	}
+
+	private:
+	uint32_t                          m_Width, m_Height;
+	std::vector<std::vector<uint8_t>> m_Planes;
+	struct encoder_frame              m_Frame;
+};
+
+static void EncodeOne(Encoder* enc, struct encoder_frame* frame)
+{
+	struct encoder_packet packet;
+	bool                  received = false;
+	std::memset(&packet, 0, sizeof(packet));
+	if (!enc->Encode(frame, &packet, &received))
+		throw std::exception("Encode failed during benchmark run.");
+}
+
+static BenchRun RunOnce(const BenchConfiguration& cfg, const BenchOptions& opts)
+{
+	auto enc = CreateEncoder(cfg);
+	enc->Start();
+
+	SyntheticFrame      source(cfg.format, cfg.resolution);
+	std::vector<double> latencies;
+	latencies.reserve(opts.frames);
+
+	std::chrono::high_resolution_clock::time_point begin;
+	for (size_t idx = 0; idx < (opts.warmup + opts.frames); idx++) {
+		struct encoder_frame* frame = source.Next(idx);
+		if (idx == opts.warmup)
+			begin = std::chrono::high_resolution_clock::now();
+
+		auto clk_start = std::chrono::high_resolution_clock::now();
+		EncodeOne(enc.get(), frame);
+		auto clk_end = std::chrono::high_resolution_clock::now();
+
+		if (idx >= opts.warmup)
+			latencies.push_back(std::chrono::duration<double, std::micro>(clk_end - clk_start).count());
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	enc->Stop();
+
+	BenchRun run;
+	run.throughput = (double)opts.frames / std::chrono::duration<double>(end - begin).count();
+	run.latencyP99 = Statistics::Percentile(latencies, 0.99);
+	return run;
+}
+
+static int CheckAllocations(const BenchOptions& opts)
+{
+	AMF::Initialize();
+	API::InitializeAPIs();
+
+	size_t failures = 0;
+	for (auto& cfg : BuildConfigurations()) {
+		try {
+			auto enc = CreateEncoder(cfg);
+			enc->Start();
+
+			SyntheticFrame source(cfg.format, cfg.resolution);
+			for (size_t idx = 0; idx < opts.warmup; idx++)
+				EncodeOne(enc.get(), source.Next(idx));
+
+			Allocation::Reset();
+			for (size_t idx = opts.warmup; idx < (opts.warmup + opts.frames); idx++)
+				EncodeOne(enc.get(), source.Next(idx));
+			Allocation::Counters total = Allocation::GetTotal();
+
+			enc->Stop();
+
+			printf("%-32s %8" PRIu64 " allocations %12" PRIu64 " bytes %8" PRIu64 " AMF objects%s\n",
+				   cfg.Name().c_str(), total.allocations, total.bytes, total.amfObjects,
+				   total.allocations > 0 ? " FAILED" : "");
+			if (total.allocations > 0) {
+				for (size_t stage = 0; stage < (size_t)Allocation::Stage::Count; stage++) {
+					Allocation::Counters cnt = Allocation::Get((Allocation::Stage)stage);
+					if (cnt.allocations > 0)
+						printf("  %-13s %8" PRIu64 " allocations %12" PRIu64 " bytes\n",
+							   Allocation::StageToString((Allocation::Stage)stage), cnt.allocations, cnt.bytes);
+				}
+				failures++;
+			}
+		} catch (const std::exception& ex) {
+			std::cout << cfg.Name() << " skipped: " << ex.what() << std::endl;
+		}
+	}
+
+	API::FinalizeAPIs();
+	AMF::Finalize();
+
+	return failures > 0 ? 1 : 0;
+}
+
+struct SoakWorker {
+	std::thread           thread;
+	std::atomic<int64_t>  progress; // steady_clock, Nanoseconds
+	std::atomic<uint64_t> frames;
+	std::atomic<uint64_t> cycles;
+	std::atomic<uint64_t> failures;
+};
+
+static int64_t SteadyNow()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+static void SoakMain(SoakWorker* worker, size_t seed, const BenchOptions* opts, std::atomic<bool>* shutdown)
+{
+	auto         configs = BuildConfigurations();
+	std::mt19937 rng((uint32_t)seed);
+
+	while (!*shutdown) {
+		const BenchConfiguration& cfg = configs[rng() % configs.size()];
+		try {
+			auto enc = CreateEncoder(cfg);
+			enc->Start();
+
+			// Rapid cycles: short bursts of frames, sometimes interrupted by a Restart.
+			SyntheticFrame source(cfg.format, cfg.resolution);
+			size_t         frames  = 1 + (rng() % opts->frames);
+			size_t         restart = (rng() % 4 == 0) ? (rng() % frames) : SIZE_MAX;
+			for (size_t idx = 0; (idx < frames) && !*shutdown; idx++) {
+				if (idx == restart)
+					enc->Restart();
+				EncodeOne(enc.get(), source.Next(idx));
+				worker->frames++;
+				worker->progress = SteadyNow();
+			}
+
+			enc->Stop();
+			worker->cycles++;
+		} catch (const std::exception& ex) {
+			worker->failures++;
+			std::cout << cfg.Name() << " failed: " << ex.what() << std::endl;
+		}
+		worker->progress = SteadyNow();
+	}
+}
+
+static int Soak(const BenchOptions& opts)
+{
+	AMF::Initialize();
+	API::InitializeAPIs();
+
+	std::atomic<bool>             shutdown(false);
+	std::unique_ptr<SoakWorker[]> workers(new SoakWorker[opts.encoders]);
+	for (size_t idx = 0; idx < opts.encoders; idx++) {
+		workers[idx].progress = SteadyNow();
+		workers[idx].frames   = 0;
+		workers[idx].cycles   = 0;
+		workers[idx].failures = 0;
+		workers[idx].thread   = std::thread(SoakMain, &workers[idx], idx, &opts, &shutdown);
+	}
+
+	// Watchdog: reports throughput once a minute and aborts on hung workers.
+	auto     begin       = std::chrono::steady_clock::now();
+	uint64_t lastFrames  = 0;
+	double   firstWindow = 0, lastWindow = 0;
+	while (std::chrono::steady_clock::now() - begin < std::chrono::seconds(opts.duration)) {
+		std::this_thread::sleep_for(std::chrono::seconds(60));
+
+		uint64_t frames = 0, cycles = 0, failures = 0;
+		for (size_t idx = 0; idx < opts.encoders; idx++) {
+			frames += workers[idx].frames;
+			cycles += workers[idx].cycles;
+			failures += workers[idx].failures;
+			if ((SteadyNow() - workers[idx].progress) > (int64_t)opts.timeout * 1000000000ll) {
+				std::cout << "Worker " << idx << " made no progress for " << opts.timeout << " seconds, hang detected."
+						  << std::endl;
+				std::exit(1); // Can't join a hung thread.
+			}
+		}
+
+		lastWindow = (double)(frames - lastFrames) / 60.0;
+		if (firstWindow == 0)
+			firstWindow = lastWindow;
+		lastFrames = frames;
+		printf("%6" PRIu64 "s: %9.2f fps, %8" PRIu64 " cycles, %6" PRIu64 " failures\n",
+			   (uint64_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - begin)
+				   .count(),
+			   lastWindow, cycles, failures);
+	}
+
+	shutdown = true;
+	uint64_t failures = 0;
+	for (size_t idx = 0; idx < opts.encoders; idx++) {
+		workers[idx].thread.join();
+		failures += workers[idx].failures;
+	}
+
+	API::FinalizeAPIs();
+	AMF::Finalize();
+
+	if (failures > 0) {
+		std::cout << failures << " encoder cycle(s) failed." << std::endl;
+		return 1;
+	}
+	if ((firstWindow > 0) && (lastWindow < firstWindow * (1.0 - opts.tolerance * 5))) {
+		printf("Throughput degraded from %.2f fps to %.2f fps.\n", firstWindow, lastWindow);
+		return 1;
+	}
+	return 0;
+}
+
+// Milliseconds from having an encoder (created here unless one is passed in) until its first packet. With pre-roll
+// only the time after Start() counts, that is what the pre-roll is supposed to shorten.
+static double TimeToFirstPacket(const BenchConfiguration& cfg, std::unique_ptr<Encoder> enc, uint32_t preRoll = 0)
+{
+	auto begin = std::chrono::high_resolution_clock::now();
+	if (!enc)
+		enc = GetParameters(cfg).Create();
+	ApplySettings(enc.get(), cfg);
+	enc->SetPreRollFrames(preRoll);
+	enc->Start();
+	if (preRoll > 0)
+		begin = std::chrono::high_resolution_clock::now();
+
+	SyntheticFrame source(cfg.format, cfg.resolution);
+	bool           received = false;
+	for (size_t idx = 0; !received; idx++) {
+		struct encoder_packet packet;
+		std::memset(&packet, 0, sizeof(packet));
+		if (!enc->Encode(source.Next(idx), &packet, &received) || (idx > 1000))
+			throw std::exception("No packet during startup measurement.");
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	enc->Stop();
+	return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+// Time to first packet for encoders created on demand, for prepared ones as handed out by the encoder pool, and after
+// a pre-roll.
+static int CheckStartup(const BenchOptions& opts)
+{
+	AMF::Initialize();
+	API::InitializeAPIs();
+
+	for (auto& cfg : BuildConfigurations()) {
+		std::vector<double> cold, prepared, prerolled;
+		try {
+			for (size_t run = 0; run < opts.runs; run++) {
+				cold.push_back(TimeToFirstPacket(cfg, nullptr));
+				auto enc = GetParameters(cfg).Create();
+				prepared.push_back(TimeToFirstPacket(cfg, std::move(enc)));
+				prerolled.push_back(TimeToFirstPacket(cfg, nullptr, 8));
+			}
+		} catch (const std::exception& ex) {
+			std::cout << cfg.Name() << " skipped: " << ex.what() << std::endl;
+			continue;
+		}
+		printf("%-32s Cold %9.2f ms (P99 %9.2f ms)  Prepared %9.2f ms (P99 %9.2f ms)  Pre-Rolled %9.2f ms (P99 %9.2f "
+			   "ms)\n",
+			   cfg.Name().c_str(), Statistics::Mean(cold), Statistics::Percentile(cold, 0.99), Statistics::Mean(prepared),
+			   Statistics::Percentile(prepared, 0.99), Statistics::Mean(prerolled),
+			   Statistics::Percentile(prerolled, 0.99));
+	}
+
+	API::FinalizeAPIs();
+	AMF::Finalize();
+	return 0;
+}
+
+// Compares Plugin::Clock against steady_clock, the TSC calibration must not drift.
+static int CheckClock(const BenchOptions& opts)
+{
+	Clock::Initialize();
+	std::cout << "Clock Source: " << (Clock::IsTSC() ? "Invariant TSC" : "steady_clock") << std::endl;
+
+	auto     s0    = std::chrono::steady_clock::now();
+	uint64_t c0    = Clock::Now();
+	double   drift = 0;
+	for (size_t sec = 1; sec <= opts.duration; sec++) {
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		uint64_t c1 = Clock::Now();
+		auto     s1 = std::chrono::steady_clock::now();
+
+		double steady = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(s1 - s0).count();
+		double clock  = (double)Clock::ToNanoseconds(c1 - c0);
+		drift         = (clock - steady) / steady * 1000000.0;
+		printf("%6zus: %+10.3f ppm\n", sec, drift);
+	}
+
+	if (std::fabs(drift) > 100.0) {
+		std::cout << "Clock drifted by more than 100 ppm." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Drives the bitrate controller with a simulated link, no GPU needed. The link buffers what it can't send right away
+// and reports how full that buffer is as congestion, like an OBS output does.
+static int CheckBitrateController(const BenchOptions&)
+{
+	const uint64_t second  = 1000000000;
+	const uint64_t step    = second / 10;
+	const uint64_t nominal = 6000000;
+
+	BitrateController::Settings settings;
+	size_t                      failures = 0;
+	auto                        fail     = [&failures](double time, const char* reason) {
+		printf("%8.1fs: %s\n", time, reason);
+		failures++;
+	};
+
+	// Capacity drops to a third for two minutes, then recovers with room to spare.
+	{
+		BitrateController ctl(settings);
+		ctl.Configure(nominal, nominal, nominal);
+
+		double   backlog = 0, previous = 1.0, settledRate = 0;
+		uint64_t lastChange = 0, settledSteps = 0;
+		for (uint64_t now = step; now <= 300 * second; now += step) {
+			double capacity = (now < 60 * second) ? 6000000.0 : ((now < 180 * second) ? 2000000.0 : 8000000.0);
+			backlog         = std::max(0.0, backlog + ((double)ctl.GetTargetBitrate() - capacity) / 10.0);
+			ctl.ReportCongestion(std::min(1.0, backlog / (capacity * 2.0)));
+
+			double time = (double)now / second;
+			if (ctl.Update(now)) {
+				double factor = ctl.GetFactor();
+				if ((now - lastChange) < settings.interval)
+					fail(time, "Changed faster than the interval allows.");
+				if (factor < previous * (1.0 - settings.decreaseStep) - 0.0001)
+					fail(time, "Stepped down further than allowed.");
+				if (factor > previous + settings.increaseStep + 0.0001)
+					fail(time, "Stepped up further than allowed.");
+				if ((factor > 1.0) || (factor < settings.minimumFactor))
+					fail(time, "Left the allowed range.");
+				lastChange = now;
+				previous   = factor;
+			}
+			if ((now >= 120 * second) && (now < 180 * second)) {
+				settledRate += (double)ctl.GetTargetBitrate();
+				settledSteps++;
+			}
+			if (now % (10 * second) == 0)
+				printf("%8.1fs: Capacity %8.0f kbit/s, Target %8" PRIu64 " kbit/s, Backlog %8.0f kbit\n", time,
+					   capacity / 1000, ctl.GetTargetBitrate() / 1000, backlog / 1000);
+		}
+		if ((settledRate / settledSteps) > 2000000.0 * 1.05)
+			fail(180, "Did not settle below the reduced capacity.");
+		if (ctl.GetTargetBitrate() != nominal)
+			fail(300, "Did not recover to the configured bitrate.");
+	}
+
+	// Congestion between the thresholds must not change anything.
+	{
+		BitrateController ctl(settings);
+		ctl.Configure(nominal, nominal, nominal);
+		for (uint64_t now = step; now <= 60 * second; now += step) {
+			ctl.ReportCongestion((settings.congestionLow + settings.congestionHigh) / 2);
+			if (ctl.Update(now))
+				fail((double)now / second, "Changed inside the hysteresis band.");
+		}
+	}
+
+	// A bandwidth estimate limits the bitrate on its own, still within the slew limit.
+	{
+		BitrateController ctl(settings);
+		ctl.Configure(nominal, nominal, nominal);
+		ctl.ReportBandwidth(3000000);
+		for (uint64_t now = step; now <= 30 * second; now += step)
+			ctl.Update(now);
+		if (ctl.GetTargetBitrate() > (uint64_t)(3000000 * settings.bandwidthHeadroom) + 1)
+			fail(30, "Ignored the bandwidth estimate.");
+	}
+
+	if (failures > 0) {
+		std::cout << failures << " bitrate controller check(s) failed." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Synthetic 1080p luma with a texture that keeps moving, the scene changes at known frames. Also no GPU needed.
+static int CheckSceneDetector(const BenchOptions&)
+{
+	const uint32_t width = 1920, height = 1080, frames = 300;
+	const uint32_t cuts[] = {100, 200, 205}; // The last one is too close to the previous one.
+
+	std::vector<uint8_t> luma(width * height);
+	SceneDetector        detector;
+	size_t               failures = 0;
+	double               total = 0, worst = 0;
+	uint32_t             scene = 0;
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		for (uint32_t cut : cuts) {
+			if (frame == cut)
+				scene++;
+		}
+		uint32_t base = 40 + scene * 70, shift = frame * 4;
+		for (uint32_t y = 0; y < height; y++) {
+			uint8_t* line = luma.data() + (size_t)y * width;
+			for (uint32_t x = 0; x < width; x++) {
+				uint32_t block = (((x + shift) / 32) * 2654435761u) ^ ((y / 32 + scene * 17) * 40503u);
+				line[x]        = (uint8_t)((base + (block >> 11) % 48) & 0xFF);
+			}
+		}
+
+		auto   start  = std::chrono::high_resolution_clock::now();
+		bool   result = detector.Analyze(luma.data(), width, width, height);
+		double time   = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start)
+						  .count();
+		total += time;
+		worst = std::max(worst, time);
+
+		bool expected = (frame == cuts[0]) || (frame == cuts[1]);
+		if (result != expected) {
+			printf("Frame %" PRIu32 ": %s (Difference %.2f, Histogram %.3f)\n", frame,
+				   result ? "Unexpected cut" : "Missed cut", detector.GetLastDifference(),
+				   detector.GetLastHistogramDistance());
+			failures++;
+		}
+	}
+
+	printf("Time per Frame: %.2f us (Worst: %.2f us)\n", total / frames, worst);
+	if ((total / frames) > 100.0) {
+		std::cout << "Scene detection is too slow." << std::endl;
+		failures++;
+	}
+	if (failures > 0) {
+		std::cout << failures << " scene detector check(s) failed." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Unchanged frames must hash the same and every single changed bit must show, otherwise a frame would be skipped.
+static int CheckFrameHash(const BenchOptions&)
+{
+	const size_t size = 1920 * 1080 * 3 / 2, runs = 200;
+
+	std::vector<uint8_t> frame(size);
+	for (size_t idx = 0; idx < size; idx++)
+		frame[idx] = (uint8_t)((idx * 7) + (idx / 1920));
+
+	size_t   failures = 0;
+	uint64_t hash     = FrameHash::Compute(frame.data(), size);
+	for (size_t flip = 0; flip < 10000; flip++) {
+		size_t  pos = (flip * 104729) % size;
+		uint8_t bit = (uint8_t)(1 << (flip % 8));
+		frame[pos] ^= bit;
+		if (FrameHash::Compute(frame.data(), size) == hash) {
+			printf("Changed bit %" PRIu8 " of byte %zu went unnoticed.\n", bit, pos);
+			failures++;
+		}
+		frame[pos] ^= bit;
+	}
+	if (FrameHash::Compute(frame.data(), size) != hash) {
+		std::cout << "Identical frames hashed differently." << std::endl;
+		failures++;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t run = 0; run < runs; run++)
+		hash ^= FrameHash::Compute(frame.data(), size, run);
+	double time =
+		std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / runs;
+	printf("Time per 1080p NV12 Frame: %.2f us (%.2f GB/s, %016" PRIx64 ")\n", time, size / time / 1000.0, hash);
+	if (time > 1000.0) {
+		std::cout << "Hashing is too slow." << std::endl;
+		failures++;
+	}
+
+	if (failures > 0) {
+		std::cout << failures << " frame hash check(s) failed." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// The modulo chain HandleTypeOverride used before the GOP planner, kept to compare against.
+static PictureType LegacyTypeOverride(const GOPPlanner::Periods& p, uint64_t index, PictureType& skipType, bool& keyframe)
+{
+	PictureType type = PictureType::None;
+	if ((p.bframe > 0) && ((index % p.bframe) == 0))
+		type = PictureType::B;
+	if ((p.pframe > 0) && ((index % p.pframe) == 0))
+		type = PictureType::P;
+	if ((p.iframe > 0) && ((index % p.iframe) == 0))
+		type = PictureType::I;
+	if ((type != PictureType::None) && (p.idr > 0) && ((index % p.idr) == 0))
+		type = PictureType::IDR;
+	keyframe = (type == PictureType::IDR) || (type == PictureType::I) || ((p.idr > 0) && ((index % p.idr) == 0));
+	if (p.skip > 0) {
+		bool shouldSkip = p.keepOnlyNth ? (index % p.skip) != 0 : (index % p.skip) == 0;
+		if (shouldSkip) {
+			if ((skipType <= PictureType::Skip) || (type < skipType))
+				skipType = type;
+			type = PictureType::Skip;
+		} else if (skipType != PictureType::None) {
+			type     = skipType;
+			skipType = PictureType::None;
+		}
+	}
+	return type;
+}
+
+// Compares the GOP planner against the modulo chain it replaced, no GPU needed. Types on skipped frames are expected
+// to move to the next frame that is not skipped, where the old code sometimes lost them. Those are counted.
+static int CheckGOPPlanner(const BenchOptions&)
+{
+	const uint64_t frames    = 20000;
+	const uint32_t idrs[]    = {0, 1, 60, 120, 250};
+	const uint32_t periods[] = {0, 1, 2, 3, 7, 30};
+	const uint32_t skips[]   = {0, 2, 3, 5};
+	size_t         configs = 0, failures = 0, recovered = 0;
+
+	auto stronger = [](PictureType a, PictureType b) {
+		if ((a == PictureType::None) || ((b != PictureType::None) && (b < a)))
+			return b;
+		return a;
+	};
+
+	for (uint32_t idr : idrs) {
+		for (uint32_t iframe : periods) {
+			for (uint32_t pframe : periods) {
+				for (uint32_t bframe : periods) {
+					for (uint32_t skip : skips) {
+						for (bool keepOnlyNth : {false, true}) {
+							GOPPlanner::Periods p   = {idr, iframe, pframe, bframe, skip, keepOnlyNth};
+							GOPPlanner::Periods raw = {idr, iframe, pframe, bframe, 0, false};
+							GOPPlanner          planner;
+							planner.Configure(p);
+							configs++;
+
+							PictureType skipType = PictureType::None, unused = PictureType::None;
+							PictureType carried  = PictureType::None;
+							for (uint64_t index = 0; index < frames; index++) {
+								bool        oldKey = false, newKey = false, rawKey = false;
+								PictureType oldType = LegacyTypeOverride(p, index, skipType, oldKey);
+								PictureType own     = LegacyTypeOverride(raw, index, unused, rawKey);
+								PictureType newType = planner.Next(index, newKey);
+
+								PictureType expected;
+								if (oldType == PictureType::Skip) {
+									expected = PictureType::Skip;
+									carried  = stronger(carried, own);
+								} else {
+									expected = stronger(own, carried);
+									carried  = PictureType::None;
+								}
+								if ((newType == expected) && ((skip > 0) || (newKey == oldKey))) {
+									if (newType != oldType)
+										recovered++;
+									continue;
+								}
+								printf("IDR %" PRIu32 " I %" PRIu32 " P %" PRIu32 " B %" PRIu32 " Skip %" PRIu32
+									   "%s, Frame %" PRIu64 ": Expected %s, got %s\n",
+									   idr, iframe, pframe, bframe, skip, keepOnlyNth ? " (Keep)" : "", index,
+									   Utility::PictureTypeToString(expected), Utility::PictureTypeToString(newType));
+								failures++;
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Cycles too long for a table are evaluated per frame and must not behave any different.
+	{
+		GOPPlanner::Periods p = {9973, 9967, 7, 0, 0, false};
+		GOPPlanner          planner;
+		planner.Configure(p);
+		if (planner.GetCycleLength() != 0) {
+			std::cout << "Expected the cycle to be too long for a table." << std::endl;
+			failures++;
+		}
+		PictureType skipType = PictureType::None;
+		for (uint64_t index = 0; index < frames; index++) {
+			bool oldKey = false, newKey = false;
+			if ((LegacyTypeOverride(p, index, skipType, oldKey) != planner.Next(index, newKey)) || (oldKey != newKey)) {
+				printf("Frame %" PRIu64 " differs without a table.\n", index);
+				failures++;
+				break;
+			}
+		}
+	}
+
+	// Segments at 59.94 fps, with frames dropped at random and every third one skipped: the first frame that makes
+	// it into a segment has to be its only IDR-Frame, whatever the type on its slot was.
+	{
+		GOPPlanner::Periods p = {0, 0, 0, 0, 3, false};
+		GOPPlanner          planner;
+		planner.Configure(p);
+		planner.SetSegmentDuration(2000, 60000, 1001);
+
+		std::mt19937 rng(47);
+		int64_t      segment  = -1;
+		size_t       segments = 0, idrs = 0;
+		for (uint64_t index = 0; index < frames; index++) {
+			if ((rng() % 10) == 0)
+				continue;
+
+			bool        key      = false;
+			PictureType type     = planner.Next(index, key);
+			int64_t     expected = (int64_t)floor(index * 1001.0 / 60000.0 / 2.0);
+			bool        first    = (expected != segment);
+			segment              = expected;
+			if (first)
+				segments++;
+			if (type == PictureType::IDR)
+				idrs++;
+			if (first != (type == PictureType::IDR)) {
+				printf("Segment %" PRId64 ", Frame %" PRIu64 ": %s IDR-Frame.\n", segment, index,
+					   first ? "Missing" : "Unexpected");
+				failures++;
+				break;
+			}
+		}
+
+		// Requests land on the next frame that is not skipped.
+		planner.Reset();
+		planner.SetSegmentDuration(0, 60000, 1001);
+		bool key = false;
+		planner.Next(2, key);
+		planner.Request(PictureType::IDR);
+		if ((planner.Next(3, key) != PictureType::Skip) || (planner.Next(4, key) != PictureType::IDR) || !key) {
+			std::cout << "Requested IDR-Frame was not placed on the next frame." << std::endl;
+			failures++;
+		}
+		printf("%zu segments, %zu IDR-Frames.\n", segments, idrs);
+	}
+
+	printf("%zu configurations, %zu carried over types the old code lost.\n", configs, recovered);
+	if (failures > 0) {
+		std::cout << failures << " GOP planner check(s) failed." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+static int CheckHRDModel(const BenchOptions&)
+{
+	const uint64_t bitrate  = 6000000;
+	const uint64_t fps      = 60;
+	const uint64_t interval = 1000000000ull / fps;
+	const uint64_t frames   = fps * 60;
+	size_t         failures = 0;
+
+	// Sends a GOP of one large keyframe and evenly sized other frames, averaging to the given rate.
+	auto stream = [&](HRDModel& model, uint64_t rate, uint64_t keyframe) {
+		uint64_t other = (rate - keyframe) / (fps - 1);
+		for (uint64_t index = 0; index < frames; index++)
+			model.AddFrame((index % fps) == 0 ? keyframe : other, index * interval);
+	};
+	auto check = [&failures](bool ok, const char* what, HRDModel& model) {
+		const HRDModel::Statistics& st = model.GetStatistics();
+		printf("%-48s Underflows(%6" PRIu64 ") Overflows(%6" PRIu64 ") Fullness(%5.1f%% - %5.1f%%)\n", what,
+			   st.underflows, st.overflows, st.minimumFullness * 100.0, st.maximumFullness * 100.0);
+		if (!ok) {
+			std::cout << "  Unexpected result." << std::endl;
+			failures++;
+		}
+	};
+
+	{
+		HRDModel model;
+		model.Configure(bitrate, bitrate, 0.5, true);
+		stream(model, bitrate, bitrate / 20);
+		const HRDModel::Statistics& st = model.GetStatistics();
+		check((st.frames == frames) && (st.underflows == 0) && (st.overflows == 0), "CBR at the bitrate", model);
+	}
+	{
+		// Also with a buffer that is kept exactly full, as filler data does.
+		HRDModel model;
+		model.Configure(bitrate, bitrate, 1.0, true);
+		stream(model, bitrate, bitrate / fps);
+		check(model.GetStatistics().overflows == 0, "CBR with a full buffer", model);
+	}
+	{
+		HRDModel model;
+		model.Configure(bitrate, bitrate / 3, 1.0, true);
+		stream(model, bitrate, bitrate / 2);
+		check(model.GetStatistics().underflows == fps, "Keyframes larger than the buffer", model);
+	}
+	{
+		HRDModel model;
+		model.Configure(bitrate, bitrate, 0.5, true);
+		stream(model, bitrate * 5 / 4, bitrate / 20);
+		check((model.GetStatistics().underflows > 0) && (model.GetPressure() > 0), "Above the bitrate", model);
+	}
+	{
+		HRDModel model;
+		model.Configure(bitrate, bitrate, 0.5, true);
+		stream(model, bitrate / 2, bitrate / 20);
+		check((model.GetStatistics().overflows > 0) && (model.GetPressure() == 0), "CBR below the bitrate", model);
+		model.Reset();
+		model.Configure(bitrate, bitrate, 0.5, false);
+		stream(model, bitrate / 2, bitrate / 20);
+		check(model.GetStatistics().overflows == 0, "VBR below the bitrate", model);
+	}
+	{
+		// Changing the bitrate mid-stream keeps the buffer, a smaller one cuts it off.
+		HRDModel model;
+		model.Configure(bitrate, bitrate, 1.0, false);
+		model.AddFrame(bitrate / 2, 0);
+		model.Configure(bitrate / 2, bitrate, 1.0, false);
+		bool kept = (model.GetFullness() == 0.5);
+		model.Configure(bitrate / 2, bitrate / 4, 1.0, false);
+		check(kept && (model.GetFullness() == 1.0), "Reconfiguration", model);
+	}
+
+	if (failures > 0) {
+		std::cout << failures << " HRD model check(s) failed." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Alternates static and constantly changing content, the static frames are the ones worth spending bits on.
+static int CheckLookahead(const BenchOptions&)
+{
+	const uint32_t width = 1920, height = 1080, depth = 16, segment = 30, segments = 12;
+
+	std::vector<uint8_t> luma(width * height);
+	Lookahead            lookahead;
+	lookahead.SetDepth(depth);
+	size_t   failures = 0, taken = 0;
+	double   total = 0, worst = 0, offsets[2] = {0, 0}, sum = 0;
+	size_t   counts[2] = {0, 0};
+	uint32_t random    = 2463534242u;
+	for (uint32_t frame = 0; frame < segment * segments + depth; frame++) {
+		bool changing = ((frame / segment) % 2) == 1;
+		if ((frame == 0) || changing) {
+			for (uint32_t y = 0; y < height; y++) {
+				uint8_t* line = luma.data() + (size_t)y * width;
+				for (uint32_t x = 0; x < width; x += 4) {
+					random ^= random << 13;
+					random ^= random >> 17;
+					random ^= random << 5;
+					std::memcpy(line + x, &random, 4);
+				}
+			}
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		lookahead.Push(lookahead.Analyze(luma.data(), width, width, height));
+		double time = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start)
+						  .count();
+		total += time;
+		worst = std::max(worst, time);
+
+		if (lookahead.GetCount() <= depth)
+			continue;
+		int32_t offset = lookahead.Next();
+		if ((offset < -6) || (offset > 6)) {
+			printf("Frame %" PRIu32 ": Offset %" PRIi32 " is out of range.\n", frame - depth, offset);
+			failures++;
+		}
+		// The first segment only sets up the average.
+		uint32_t index = frame - depth;
+		if (index >= segment * 2) {
+			size_t kind = ((index / segment) % 2);
+			offsets[kind] += offset;
+			counts[kind]++;
+			sum += offset;
+			taken++;
+		}
+	}
+
+	double stable = offsets[0] / counts[0], changing = offsets[1] / counts[1], average = sum / taken;
+	printf("Average QP Offset: Static %+.2f, Changing %+.2f, Overall %+.2f\n", stable, changing, average);
+	printf("Time per Frame: %.2f us (Worst: %.2f us)\n", total / (segment * segments + depth), worst);
+	if (!(stable < changing - 1.0)) {
+		std::cout << "Static frames should get a lower QP than changing ones." << std::endl;
+		failures++;
+	}
+	if (std::abs(average) > 1.0) {
+		std::cout << "QP offsets should average out." << std::endl;
+		failures++;
+	}
+	if ((total / (segment * segments + depth)) > 500.0) {
+		std::cout << "Lookahead analysis is too slow." << std::endl;
+		failures++;
+	}
+	if (failures > 0) {
+		std::cout << failures << " lookahead check(s) failed." << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+// Encodes a raw NV12 recording with Constant QP with and without lookahead, the QP offsets average to zero.
+static int MeasureLookahead(const std::string& file, const std::string& size, const BenchOptions& opts)
+{
+	uint32_t width = 0, height = 0;
+	if ((sscanf(size.c_str(), "%" SCNu32 "x%" SCNu32, &width, &height) != 2) || (width == 0) || (height == 0)) {
+		std::cout << "Expected the resolution as <width>x<height>." << std::endl;
+		return 2;
+	}
+
+	AMF::Initialize();
+	API::InitializeAPIs();
+
+	std::vector<uint8_t> buffer((size_t)width * height * 3 / 2);
+	struct encoder_frame frame;
+	std::memset(&frame, 0, sizeof(frame));
+	frame.data[0]     = buffer.data();
+	frame.data[1]     = buffer.data() + (size_t)width * height;
+	frame.linesize[0] = width;
+	frame.linesize[1] = width;
+
+	int result = 0;
+	for (Codec codec : {Codec::AVC, Codec::HEVC}) {
+		BenchConfiguration cfg = {codec, ColorFormat::NV12, std::make_pair(width, height), false};
+		uint64_t           bytes[2]   = {0, 0};
+		uint64_t           packets[2] = {0, 0};
+		try {
+			for (size_t pass = 0; pass < 2; pass++) {
+				FILE* input = fopen(file.c_str(), "rb");
+				if (!input)
+					throw std::exception("Unable to open the recording.");
+
+				auto enc = CreateEncoder(cfg);
+				enc->SetRateControlMethod(RateControlMethod::ConstantQP);
+				enc->SetIFrameQP(22);
+				enc->SetPFrameQP(24);
+				enc->SetLookaheadFrames(pass == 0 ? 0 : 16);
+				enc->Start();
+				for (size_t idx = 0; idx < opts.frames; idx++) {
+					if (fread(buffer.data(), 1, buffer.size(), input) != buffer.size())
+						break;
+					frame.pts = (int64_t)idx;
+
+					struct encoder_packet packet;
+					bool                  received = false;
+					std::memset(&packet, 0, sizeof(packet));
+					if (!enc->Encode(&frame, &packet, &received))
+						throw std::exception("Encode failed during measurement.");
+					if (received) {
+						bytes[pass] += packet.size;
+						packets[pass]++;
+					}
+				}
+				enc->Stop();
+				fclose(input);
+			}
+		} catch (const std::exception& ex) {
+			std::cout << Utility::CodecToString(codec) << " skipped: " << ex.what() << std::endl;
+			result = 1;
+			continue;
+		}
+		if ((packets[0] == 0) || (packets[1] == 0))
+			continue;
+
+		double without = (double)bytes[0] * 8 / packets[0], with = (double)bytes[1] * 8 / packets[1];
+		printf("%-8s Without %12.0f bit/frame  With %12.0f bit/frame  (%+.2f%%)\n", Utility::CodecToString(codec),
+			   without, with, (with / without - 1.0) * 100.0);
+	}
+
+	API::FinalizeAPIs();
+	AMF::Finalize();
+	return result;
+}
+
+static int CheckTemporalLayers(const BenchOptions&)
+{
+	// Access unit delimiter, optionally an SVC prefix, then a slice.
+	auto accessUnit = [](int prefixLayer, uint8_t sliceHeader) {
+		std::vector<uint8_t> au = {0, 0, 0, 1, 0x09, 0xF0};
+		if (prefixLayer >= 0) {
+			uint8_t prefix[] = {0, 0, 0, 1, 0x6E, 0xC0, 0x00, (uint8_t)((prefixLayer << 5) | 0x07)};
+			au.insert(au.end(), prefix, prefix + sizeof(prefix));
+		}
+		uint8_t slice[] = {0, 0, 1, sliceHeader, 0x9A, 0x00, 0x00, 0x03, 0x01, 0x22};
+		au.insert(au.end(), slice, slice + sizeof(slice));
+		return au;
+	};
+
+	size_t failures = 0;
+	for (uint8_t layers = 1; layers <= TemporalLayers::MAXIMUM; layers++) {
+		uint8_t top = layers - 1;
+
+		/// Parsing
+		for (int layer = 0; layer < 8; layer++) {
+			auto    au       = accessUnit(layer, 0x41);
+			uint8_t expected = (uint8_t)((layer > top) ? top : layer);
+			uint8_t found    = TemporalLayers::Find(au.data(), au.size(), layers);
+			if (found != expected) {
+				printf("%" PRIu8 " Layers: temporal_id %d read as layer %" PRIu8 ".\n", layers, layer, found);
+				failures++;
+			}
+		}
+		struct {
+			uint8_t header;
+			uint8_t layer;
+		} fallbacks[] = {{0x65, 0}, {0x41, 0}, {0x01, top}};
+		for (auto& fb : fallbacks) {
+			auto au = accessUnit(-1, fb.header);
+			if (TemporalLayers::Find(au.data(), au.size(), layers) != fb.layer) {
+				printf("%" PRIu8 " Layers: Slice 0x%02X without prefix is not on layer %" PRIu8 ".\n", layers,
+					   fb.header, fb.layer);
+				failures++;
+			}
+		}
+		{
+			// Cut off in the middle of the extension, must neither read past the end nor pick a layer.
+			auto au = accessUnit(top, 0x41);
+			if (TemporalLayers::Find(au.data(), 12, layers) != 0) {
+				printf("%" PRIu8 " Layers: Truncated prefix was not ignored.\n", layers);
+				failures++;
+			}
+		}
+
+		/// Priorities, never higher than the layer below
+		for (uint8_t layer = 0; layer < layers; layer++) {
+			int priority = TemporalLayers::Priority(layer, layers);
+			int expected = (layer == 0) ? 2 : ((layer == top) ? 0 : 1);
+			if (priority != expected) {
+				printf("%" PRIu8 " Layers: Layer %" PRIu8 " has priority %d instead of %d.\n", layers, layer,
+					   priority, expected);
+				failures++;
+			}
+		}
+
+		/// Bitrates
+		const uint64_t bitrate = 6000000;
+		double         frames  = 0;
+		uint64_t       sum     = 0;
+		for (uint8_t layer = 0; layer < layers; layer++) {
+			frames += TemporalLayers::FrameShare(layer, layers);
+			sum += TemporalLayers::Bitrate(layer, layers, bitrate, 0.5);
+		}
+		uint64_t base = TemporalLayers::Bitrate(0, layers, bitrate, 0.5);
+		if ((fabs(frames - 1.0) > 1e-9) || (sum > bitrate) || ((bitrate - sum) > layers)
+			|| (base != ((layers > 1) ? bitrate / 2 : bitrate))) {
+			printf("%" PRIu8 " Layers: Frame shares sum to %.6f, bitrates to %" PRIu64 " with %" PRIu64
+				   " on the base layer.\n",
+				   layers, frames, sum, base);
+			failures++;
+		}
+		// Enhancement layers spend the same on every frame.
+		for (uint8_t layer = 2; layer < layers; layer++) {
+			double perFrame[2] = {TemporalLayers::Bitrate(layer - 1, layers, bitrate, 0.5)
+									  / TemporalLayers::FrameShare(layer - 1, layers),
+								  TemporalLayers::Bitrate(layer, layers, bitrate, 0.5)
+									  / TemporalLayers::FrameShare(layer, layers)};
+			if (fabs(perFrame[0] - perFrame[1]) > 16.0) {
+				printf("%" PRIu8 " Layers: Layer %" PRIu8 " gets %.0f bit/frame, the one below %.0f.\n", layers,
+					   layer, perFrame[1], perFrame[0]);
+				failures++;
+			}
+		}
+	}
+
+	if (failures > 0) {
+		std::cout << failures << " temporal layer check(s) failed." << std::endl;
+		return 1;
+	}
+	std::cout << "Temporal layers are fine." << std::endl;
+	return 0;
+}
+
+static int CheckLTRManager(const BenchOptions&)
+{
+	size_t failures = 0;
+	auto   expect   = [&failures](bool ok, const char* what) {
+		if (!ok) {
+			std::cout << what << std::endl;
+			failures++;
+		}
+	};
+
+	{
+		/// Marking and recovery through feedback
+		LTRManager ltr;
+		ltr.Configure(2, 10, 0);
+		LTRManager::Action act = ltr.Next(0, true);
+		expect((act.mark == 0) && (act.reference == 0), "IDR-Frame was not marked into the first slot.");
+		for (uint64_t idx = 1; idx < 10; idx++) {
+			act = ltr.Next(idx, false);
+			expect(act.mark < 0, "Marked a frame before the period elapsed.");
+		}
+		act = ltr.Next(10, false);
+		expect(act.mark == 1, "Second mark did not go into the empty slot.");
+		ltr.Acknowledge(10);
+		act = ltr.Next(20, false);
+		expect(act.mark == 0, "Replaced the newest acknowledged frame instead of the oldest.");
+
+		// Frame 20 was marked after the loss, so only frame 10 is usable.
+		ltr.ReportLoss(15);
+		expect(!ltr.NeedsKeyframe(), "Asked for a keyframe with an acknowledged frame from before the loss.");
+		act = ltr.Next(21, false);
+		expect(act.reference == (1 << 1), "Recovery did not reference the acknowledged frame.");
+		act = ltr.Next(22, false);
+		expect(act.reference == 0, "Kept referencing the LTR after recovering.");
+		act = ltr.Next(30, false);
+		expect(act.mark == 0, "Frame marked after the loss was not dropped.");
+
+		const LTRManager::Statistics& st = ltr.GetStatistics();
+		expect((st.marked == 4) && (st.losses == 1) && (st.recovered == 1) && (st.keyframes == 0),
+			   "Statistics do not match.");
+	}
+
+	{
+		/// Nothing acknowledged yet, only a keyframe helps
+		LTRManager ltr;
+		ltr.Configure(2, 10, 0);
+		ltr.Next(0, true);
+		ltr.ReportLoss(5);
+		expect(ltr.NeedsKeyframe(), "Did not ask for a keyframe without an acknowledged frame.");
+		LTRManager::Action act = ltr.Next(6, true);
+		expect((act.mark == 0) && (act.reference == 0) && !ltr.NeedsKeyframe(), "Keyframe did not clear the loss.");
+		expect(ltr.GetStatistics().keyframes == 1, "Keyframe was not counted.");
+	}
+
+	{
+		/// Acknowledged by delay, as without a feedback path
+		LTRManager ltr;
+		ltr.Configure(2, 10, 3);
+		for (uint64_t idx = 0; idx < 2; idx++)
+			ltr.Next(idx, idx == 0);
+		ltr.ReportLoss(1);
+		expect(ltr.NeedsKeyframe(), "Frame counted as acknowledged before the delay.");
+		ltr.Next(2, false);
+		expect(!ltr.NeedsKeyframe(), "Frame did not count as acknowledged after the delay.");
+		LTRManager::Action act = ltr.Next(3, false);
+		expect(act.reference == (1 << 0), "Recovery did not reference the delayed acknowledged frame.");
+	}
+
+	{
+		/// Disabled, a loss still ends in a keyframe
+		LTRManager ltr;
+		ltr.ReportLoss(1);
+		expect(ltr.NeedsKeyframe(), "Loss without LTRs did not ask for a keyframe.");
+		LTRManager::Action act = ltr.Next(2, true);
+		expect((act.mark < 0) && !ltr.NeedsKeyframe(), "Disabled manager marked a frame or kept the loss.");
+	}
+
+	if (failures > 0) {
+		std::cout << failures << " long-term reference check(s) failed." << std::endl;
+		return 1;
+	}
+	std::cout << "Long-term references are fine." << std::endl;
+	return 0;
+}
+
+static int CheckIntraRefresh(const BenchOptions&)
+{
+	struct {
+		uint32_t width, height;
+	} resolutions[] = {{640, 360}, {1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160}};
+	struct {
+		uint32_t num, den;
+	} frameRates[] = {{24000, 1001}, {30, 1}, {60000, 1001}, {144, 1}};
+
+	uint32_t periods[] = {100, 500, 1000, 2000};
+	size_t   failures  = 0;
+	for (auto& res : resolutions) {
+		uint64_t columns = (res.width + 15) / 16, total = columns * ((res.height + 15) / 16);
+		for (auto& fps : frameRates) {
+			for (uint32_t period : periods) {
+				uint64_t frames = ((uint64_t)period * fps.num + 500ull * fps.den) / (1000ull * fps.den);
+				if (frames == 0)
+					frames = 1;
+
+				/// Unlimited: whole rows, covers the picture exactly once within the period
+				IntraRefresh::Layout layout =
+					IntraRefresh::Plan(res.width, res.height, fps.num, fps.den, period, 0, UINT32_MAX);
+				uint64_t covered = (uint64_t)layout.mbsPerSlot * layout.stripes;
+				if ((layout.mbsPerSlot == 0) || (layout.stripes > frames) || ((layout.mbsPerSlot % columns) != 0)
+					|| (covered < total) || ((covered - layout.mbsPerSlot) >= total)) {
+					printf("%" PRIu32 "x%" PRIu32 " %" PRIu32 "/%" PRIu32 " %" PRIu32 " ms: %" PRIu32
+						   " MBs in %" PRIu32 " Stripes for %" PRIu64 " MBs in %" PRIu64 " Frames.\n",
+						   res.width, res.height, fps.num, fps.den, period, layout.mbsPerSlot, layout.stripes, total,
+						   frames);
+					failures++;
+				}
+
+				/// Limited by the encoder, takes longer instead
+				layout = IntraRefresh::Plan(res.width, res.height, fps.num, fps.den, period, 0, 64);
+				if ((layout.mbsPerSlot > 64) || (((uint64_t)layout.mbsPerSlot * layout.stripes) < total)) {
+					printf("%" PRIu32 "x%" PRIu32 " %" PRIu32 " ms: Limit ignored, %" PRIu32 " MBs in %" PRIu32
+						   " Stripes.\n",
+						   res.width, res.height, period, layout.mbsPerSlot, layout.stripes);
+					failures++;
+				}
+			}
+		}
+	}
+
+	IntraRefresh::Layout layout = IntraRefresh::Plan(1920, 1080, 60, 1, 0, 0, UINT32_MAX);
+	if ((layout.mbsPerSlot != 0) || (layout.stripes != 0)) {
+		std::cout << "A period of 0 did not disable intra-refresh." << std::endl;
+		failures++;
+	}
+	layout = IntraRefresh::Plan(1920, 1080, 60, 1, 1000, 0, 0);
+	if ((layout.mbsPerSlot != 0) || (layout.stripes != 0)) {
+		std::cout << "An encoder without intra-refresh (maximum of 0) did not disable it." << std::endl;
+		failures++;
+	}
+
+	if (failures > 0) {
+		std::cout << failures << " intra-refresh check(s) failed." << std::endl;
+		return 1;
+	}
+	std::cout << "Intra-refresh layouts are fine." << std::endl;
+	return 0;
+}
+
+static int Run(const std::string& output, const BenchOptions& opts)
+{
+	AMF::Initialize();
+	API::InitializeAPIs();
+
+	BenchResults results;
+	for (auto& cfg : BuildConfigurations()) {
+		std::string name = cfg.Name();
+		std::cout << name << std::flush;
+		try {
+			for (size_t run = 0; run < opts.runs; run++) {
+				results[name].push_back(RunOnce(cfg, opts));
+				std::cout << "." << std::flush;
+			}
+			std::cout << std::endl;
+		} catch (const std::exception& ex) {
+			// Unsupported configurations are skipped, the comparison fails on them as missing.
+			std::cout << " skipped: " << ex.what() << std::endl;
+			results.erase(name);
+		}
+	}
+
+	API::FinalizeAPIs();
+	AMF::Finalize();
+
+	if (!SaveResults(output, results)) {
+		std::cout << "Unable to write results to '" << output << "'." << std::endl;
+		return 2;
+	}
+	return 0;
+}
+
+static int Compare(const std::string& baselineFile, const std::string& resultFile, const BenchOptions& opts)
+{
+	BenchResults baseline, current;
+	if (!LoadResults(baselineFile, baseline)) {
+		std::cout << "No baseline at '" << baselineFile << "', store one with 'update'." << std::endl;
+		return 2;
+	}
+	if (!LoadResults(resultFile, current)) {
+		std::cout << "Unable to read results from '" << resultFile << "'." << std::endl;
+		return 2;
+	}
+
+	size_t regressions = 0;
+	for (auto& kv : baseline) {
+		auto cur = current.find(kv.first);
+		if (cur == current.end()) {
+			// A configuration that stopped working is the worst regression there is.
+			std::cout << kv.first << ": missing from results." << std::endl;
+			regressions++;
+			continue;
+		}
+
+		std::vector<double> bFps, cFps, bP99, cP99;
+		for (auto& r : kv.second) {
+			bFps.push_back(r.throughput);
+			bP99.push_back(r.latencyP99);
+		}
+		for (auto& r : cur->second) {
+			cFps.push_back(r.throughput);
+			cP99.push_back(r.latencyP99);
+		}
+
+		// Throughput regresses downwards, latency regresses upwards.
+		auto fps = Statistics::CompareSamples(bFps, cFps, opts.tolerance, false);
+		auto p99 = Statistics::CompareSamples(bP99, cP99, opts.tolerance, true);
+
+		printf("%-32s FPS %9.2f -> %9.2f [%+7.2f%%, %+7.2f%%]%s  P99 %9.1f -> %9.1f us [%+7.2f%%, %+7.2f%%]%s\n",
+			   kv.first.c_str(), fps.baselineMean, fps.currentMean, fps.ciLow * 100.0, fps.ciHigh * 100.0,
+			   fps.regression ? " REGRESSION" : "", p99.baselineMean, p99.currentMean, p99.ciLow * 100.0,
+			   p99.ciHigh * 100.0, p99.regression ? " REGRESSION" : "");
+
+		if (fps.regression)
+			regressions++;
+		if (p99.regression)
+			regressions++;
+	}
+
+	if (regressions > 0) {
+		std::cout << regressions << " significant regression(s) found." << std::endl;
+		return 1;
+	}
+	std::cout << "No significant regressions." << std::endl;
+	return 0;
+}
+
+static void Usage()
+{
+	std::cout << "Usage:" << std::endl
+			  << "  enc-amf-bench run <results.json> [--runs N] [--frames N] [--warmup N]" << std::endl
+			  << "  enc-amf-bench compare <baseline.json> <results.json> [--tolerance F]" << std::endl
+			  << "  enc-amf-bench update <baseline.json> [--runs N] [--frames N] [--warmup N]" << std::endl
+			  << "  enc-amf-bench allocations [--frames N] [--warmup N]" << std::endl
+			  << "  enc-amf-bench soak [--encoders N] [--duration S] [--timeout S] [--frames N]" << std::endl
+			  << "  enc-amf-bench clock [--duration S]" << std::endl
+			  << "  enc-amf-bench startup [--runs N]" << std::endl
+			  << "  enc-amf-bench bitrate" << std::endl
+			  << "  enc-amf-bench scenecut" << std::endl
+			  << "  enc-amf-bench framehash" << std::endl
+			  << "  enc-amf-bench gop" << std::endl
+			  << "  enc-amf-bench hrd" << std::endl
+			  << "  enc-amf-bench lookahead [<recording.nv12> <width>x<height> [--frames N]]" << std::endl
+			  << "  enc-amf-bench temporal" << std::endl
+			  << "  enc-amf-bench ltr" << std::endl
+			  << "  enc-amf-bench intrarefresh" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+#if defined(_WIN32) || defined(_WIN64)
+	SetErrorMode(SEM_NOGPFAULTERRORBOX | SEM_FAILCRITICALERRORS);
+#endif
+
+	std::vector<std::string> args;
+	BenchOptions             opts;
+	for (int idx = 1; idx < argc; idx++) {
+		std::string arg = argv[idx];
+		if ((arg == "--runs") && (idx + 1 < argc)) {
+			opts.runs = strtoul(argv[++idx], nullptr, 10);
+		} else if ((arg == "--frames") && (idx + 1 < argc)) {
+			opts.frames = strtoul(argv[++idx], nullptr, 10);
+		} else if ((arg == "--warmup") && (idx + 1 < argc)) {
+			opts.warmup = strtoul(argv[++idx], nullptr, 10);
+		} else if ((arg == "--tolerance") && (idx + 1 < argc)) {
+			opts.tolerance = strtod(argv[++idx], nullptr);
+		} else if ((arg == "--encoders") && (idx + 1 < argc)) {
+			opts.encoders = strtoul(argv[++idx], nullptr, 10);
+		} else if ((arg == "--duration") && (idx + 1 < argc)) {
+			opts.duration = strtoul(argv[++idx], nullptr, 10);
+		} else if ((arg == "--timeout") && (idx + 1 < argc)) {
+			opts.timeout = strtoul(argv[++idx], nullptr, 10);
+		} else {
+			args.push_back(arg);
+		}
+	}
+	if ((opts.runs < 2) || (opts.frames == 0)) {
+		std::cout << "At least two runs with one or more frames are required." << std::endl;
+		return 2;
+	}
+
+	try {
+		if ((args.size() == 2) && ((args[0] == "run") || (args[0] == "update"))) {
+			return Run(args[1], opts);
+		} else if ((args.size() == 3) && (args[0] == "compare")) {
+			return Compare(args[1], args[2], opts);
+		} else if ((args.size() == 1) && (args[0] == "allocations")) {
+			return CheckAllocations(opts);
+		} else if ((args.size() == 1) && (args[0] == "soak")) {
+			return Soak(opts);
+		} else if ((args.size() == 1) && (args[0] == "clock")) {
+			return CheckClock(opts);
+		} else if ((args.size() == 1) && (args[0] == "startup")) {
+			return CheckStartup(opts);
+		} else if ((args.size() == 1) && (args[0] == "bitrate")) {
+			return CheckBitrateController(opts);
+		} else if ((args.size() == 1) && (args[0] == "scenecut")) {
+			return CheckSceneDetector(opts);
+		} else if ((args.size() == 1) && (args[0] == "framehash")) {
+			return CheckFrameHash(opts);
+		} else if ((args.size() == 1) && (args[0] == "gop")) {
+			return CheckGOPPlanner(opts);
+		} else if ((args.size() == 1) && (args[0] == "hrd")) {
+			return CheckHRDModel(opts);
+		} else if ((args.size() == 1) && (args[0] == "lookahead")) {
+			return CheckLookahead(opts);
+		} else if ((args.size() == 3) && (args[0] == "lookahead")) {
+			return MeasureLookahead(args[1], args[2], opts);
+		} else if ((args.size() == 1) && (args[0] == "temporal")) {
+			return CheckTemporalLayers(opts);
+		} else if ((args.size() == 1) && (args[0] == "ltr")) {
+			return CheckLTRManager(opts);
+		} else if ((args.size() == 1) && (args[0] == "intrarefresh")) {
+			return CheckIntraRefresh(opts);
+		}
+	} catch (const std::exception& ex) {
+		std::cout << ex.what() << std::endl;
+		return 2;
+	}
+
+	Usage();
+	return 2;
+}
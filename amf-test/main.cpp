@@ -17,10 +17,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
  */
 
+#include <chrono>
 #include <iostream>
+#include <string>
 #include "amf-capabilities.hpp"
 #include "amf.hpp"
 #include "api-base.hpp"
+#include "self-test.hpp"
+#include "utility.hpp"
 
 #if defined(_WIN32) || defined(_WIN64)
 extern "C" {
@@ -40,19 +44,47 @@ int main(int argc, char* argv[])
 	SetErrorMode(SEM_NOGPFAULTERRORBOX | SEM_FAILCRITICALERRORS);
 #endif
 
+	// Records are described in self-test.hpp, one per line.
+	auto sanitize = [](std::string text) {
+		for (auto& ch : text) {
+			if ((ch == '\t') || (ch == '\r') || (ch == '\n'))
+				ch = ' ';
+		}
+		return text;
+	};
+
+	std::cout << SELFTEST_RECORD_VERSION "\t" << SELFTEST_PROTOCOL_VERSION << std::endl;
+	auto start = std::chrono::steady_clock::now();
 	try {
 		AMF::Initialize();
 		API::InitializeAPIs();
 		CapabilityManager::Initialize();
+
+		auto cm = CapabilityManager::Instance();
+		for (auto api : API::EnumerateAPIs()) {
+			for (auto adapter : api->EnumerateAdapters()) {
+				for (auto codec : {Codec::AVC, Codec::HEVC}) {
+					std::cout << SELFTEST_RECORD_PROBE "\t" << sanitize(api->GetName()) << "\t"
+							  << sanitize(adapter.Name) << "\t" << Utility::CodecToString(codec) << "\t"
+							  << (cm->IsCodecSupportedByAPIAdapter(codec, api->GetType(), adapter) ? 1 : 0) << "\t"
+							  << (cm->GetProbeTime(codec, api->GetType(), adapter) / 1000) << std::endl;
+				}
+			}
+		}
+
 		CapabilityManager::Finalize();
 		API::FinalizeAPIs();
 		AMF::Finalize();
-		return 0;
 	} catch (std::exception ex) {
-		std::cout << ex.what() << std::endl;
+		std::cout << SELFTEST_RECORD_ERROR "\t" << sanitize(ex.what()) << std::endl;
 		return 1;
 	} catch (...) {
-		std::cout << "Unknown Error" << std::endl;
+		std::cout << SELFTEST_RECORD_ERROR "\tUnknown Error" << std::endl;
 		return 2;
 	}
+
+	std::cout << SELFTEST_RECORD_DONE "\t"
+			  << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()
+			  << std::endl;
+	return 0;
 }
@@ -0,0 +1,77 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+
+// Opt-in accounting of heap allocations and AMF object creation, attributed to the encode stages.
+// Built with ENABLE_ALLOCATION_TRACKING the global new/delete operators are replaced for this module.
+
+namespace Plugin {
+	namespace Allocation {
+		enum class Stage : uint8_t {
+			Unknown,
+			Allocate,
+			Store,
+			Convert,
+			Lookahead,
+			Main,
+			Load,
+			AsyncSend,
+			AsyncRetrieve,
+
+			Count
+		};
+
+		struct Counters {
+			uint64_t allocations;
+			uint64_t bytes;
+			uint64_t amfObjects;
+		};
+
+		class StageScope {
+			public:
+			StageScope(Stage stage);
+			~StageScope();
+
+			private:
+			Stage m_Previous;
+		};
+
+		bool        IsEnabled();
+		const char* StageToString(Stage stage);
+		void        Reset();
+		Counters    Get(Stage stage);
+		/// Sum of all encode stages, excluding Unknown.
+		Counters GetEncodeTotal();
+		/// Sum of all stages, including allocations that were not attributed to any stage.
+		Counters GetTotal();
+		void     CountAMFObject();
+		/// Counters are shared by all encoders in the process, so they are only logged once, on unload.
+		void Log();
+	} // namespace Allocation
+} // namespace Plugin
+
+#ifdef ENABLE_ALLOCATION_TRACKING
+#define ALLOCATION_STAGE(stage) Plugin::Allocation::StageScope allocationStageScope(Plugin::Allocation::Stage::stage)
+#define ALLOCATION_COUNT_AMF_OBJECT() Plugin::Allocation::CountAMFObject()
+#else
+#define ALLOCATION_STAGE(stage)
+#define ALLOCATION_COUNT_AMF_OBJECT()
+#endif
@@ -19,8 +19,12 @@
 
 #pragma once
 #include <cinttypes>
+#include <functional>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <tuple>
 #include <vector>
 #include "amf-encoder-h264.hpp"
@@ -34,13 +38,52 @@
 
 namespace Plugin {
 	namespace AMD {
+		// Everything the Caps* functions of an encoder report, captured once while testing an adapter. Entries that
+		// the driver refused to report stay empty or zero, codec specific entries are only set for that codec.
+		struct CapabilitySnapshot {
+			std::vector<Usage>                                                      usage;
+			std::vector<QualityPreset>                                              qualityPreset;
+			std::pair<std::pair<uint32_t, uint32_t>, std::pair<uint32_t, uint32_t>> resolution;
+			std::vector<Profile>                                                    profile;
+			std::vector<ProfileLevel>                                               profileLevel;
+			std::vector<CodingType>                                                 codingType;
+			std::pair<uint64_t, uint64_t>                                           maximumReferenceFrames;
+			std::pair<uint32_t, uint32_t>                                           maximumLongTermReferenceFrames;
+			std::vector<RateControlMethod>                                          rateControlMethod;
+			std::vector<PrePassMode>                                                prePassMode;
+			std::pair<uint64_t, uint64_t>                                           targetBitrate;
+			std::pair<uint64_t, uint64_t>                                           peakBitrate;
+			std::pair<uint8_t, uint8_t>                                             iFrameQP;
+			std::pair<uint8_t, uint8_t>                                             pFrameQP;
+			std::pair<uint64_t, uint64_t>                                           vbvBufferSize;
+
+			// H264/AVC
+			std::pair<uint8_t, uint8_t>   qpMinimum;
+			std::pair<uint8_t, uint8_t>   qpMaximum;
+			std::pair<uint8_t, uint8_t>   bFrameQP;
+			uint8_t                       bFramePattern = 0;
+			std::pair<uint32_t, uint32_t> intraRefreshNumMBsPerSlot;
+
+			// H265/HEVC
+			std::vector<H265::Tier>       tier;
+			std::vector<H265::GOPType>    gopType;
+			std::pair<uint8_t, uint8_t>   iFrameQPMinimum;
+			std::pair<uint8_t, uint8_t>   iFrameQPMaximum;
+			std::pair<uint8_t, uint8_t>   pFrameQPMinimum;
+			std::pair<uint8_t, uint8_t>   pFrameQPMaximum;
+			std::pair<uint32_t, uint32_t> inputQueueSize;
+		};
+
 		class CapabilityManager {
 #pragma region Singleton
 			public:
 			static void               Initialize();
-			static CapabilityManager* Instance();
+			static CapabilityManager* Instance(); // Tests all adapters on first use.
 			static void               Finalize();
 
+			// Checked before any adapter is tested, returning false leaves everything unsupported.
+			static void SetPrecondition(std::function<bool()> fn);
+
 			private: // Private Initializer & Finalizer
 			CapabilityManager();
 			~CapabilityManager();
@@ -54,8 +97,42 @@ namespace Plugin {
 			bool IsCodecSupportedByAPI(AMD::Codec codec, API::Type api);
 			bool IsCodecSupportedByAPIAdapter(AMD::Codec codec, API::Type api, API::Adapter adapter);
 
+			// Snapshot of the encoder capabilities, nullptr if the codec is not supported there.
+			std::shared_ptr<const CapabilitySnapshot> GetSnapshot(AMD::Codec codec, API::Type api,
+																  API::Adapter adapter);
+
+			// Time in nanoseconds spent testing, 0 if the result came from the cache.
+			uint64_t GetProbeTime(AMD::Codec codec, API::Type api, API::Adapter adapter);
+
+			// Re-test all adapters and replace the on-disk cache.
+			void Refresh();
+
+			// Whether the on-disk cache matches the loaded plugin and AMF runtime.
+			static bool IsCacheValid();
+
+			// Whether the last cache written by this plugin and runtime says no adapter supports the codec, without
+			// loading AMF.
+			static bool IsCodecKnownUnsupported(AMD::Codec codec);
+
 			private:
-			std::map<std::tuple<API::Type, API::Adapter, AMD::Codec>, bool> m_CapabilityMap;
+			typedef std::tuple<API::Type, API::Adapter, AMD::Codec>                    CapabilityKey;
+			typedef std::map<CapabilityKey, bool>                                      CapabilityMap;
+			typedef std::map<CapabilityKey, std::shared_ptr<const CapabilitySnapshot>> SnapshotMap;
+
+			// API, Vendor Id, Device Id, Driver Version, Codec. LUIDs change with every boot, the hardware doesn't.
+			typedef std::tuple<API::Type, uint32_t, uint32_t, uint64_t, AMD::Codec> CacheKey;
+			typedef std::map<CacheKey, bool>                                        CacheMap;
+			typedef std::map<CacheKey, std::shared_ptr<const CapabilitySnapshot>>   CacheSnapshotMap;
+
+			void Probe(bool useCache);
+			bool LoadCache(CacheMap& cache, CacheSnapshotMap& snapshots);
+			void SaveCache();
+
+			std::mutex                        m_MapMutex; // Guards the maps below, Refresh() replaces them.
+			CapabilityMap                     m_CapabilityMap;
+			SnapshotMap                       m_SnapshotMap;
+			std::map<CapabilityKey, uint64_t> m_ProbeTimeMap;
+			std::set<CapabilityKey>           m_FailedSet; // No definite answer, unsupported but never cached.
 		};
 	} // namespace AMD
 } // namespace Plugin
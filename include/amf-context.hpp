@@ -0,0 +1,75 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <memory>
+#include <mutex>
+#include "amf.hpp"
+#include "api-base.hpp"
+#include "plugin.hpp"
+
+#include <core\Compute.h>
+#include <core\Context.h>
+
+namespace Plugin {
+	namespace AMD {
+		/* AMF Context on one adapter, shared by every encoder and converter on it.
+		 *
+		 * Usage across threads:
+		 * - Components and surfaces can be created from any thread, surfaces can be handed to any other component on
+		 *   the same context without copying.
+		 * - The device itself is protected by the API (see Direct3D11), so interop through the context is safe.
+		 * - The OpenCL queue is shared, so everything from queueing work on it until waiting for that work has to
+		 *   hold LockCompute(), otherwise one encoder ends up waiting on (or finishing) the work of another.
+		 */
+		class SharedContext {
+			public:
+			// Returns the context that is already alive for the adapter, or creates one. Contexts are only weakly
+			// referenced, the last user takes it down. APIs that AMF can't work on fall back to the first API.
+			static std::shared_ptr<SharedContext> Get(std::shared_ptr<API::IAPI> api, API::Adapter adapter);
+
+			~SharedContext();
+
+			std::shared_ptr<API::IAPI>     GetAPI();
+			API::Adapter                   GetAdapter();
+			std::shared_ptr<API::Instance> GetDevice();
+
+			amf::AMFContextPtr   GetContext();
+			amf::AMF_MEMORY_TYPE GetMemoryType();
+
+			// Initializes OpenCL on first use, nullptr if it is not available on this adapter.
+			amf::AMFComputePtr           GetCompute();
+			std::unique_lock<std::mutex> LockCompute();
+
+			private:
+			SharedContext(std::shared_ptr<API::IAPI> api, API::Adapter adapter);
+
+			std::shared_ptr<API::IAPI>     m_API;
+			API::Adapter                   m_APIAdapter;
+			std::shared_ptr<API::Instance> m_APIDevice;
+
+			amf::AMFContextPtr   m_AMFContext;
+			amf::AMF_MEMORY_TYPE m_AMFMemoryType;
+
+			std::mutex         m_ComputeMutex; // Guards initialization and use of the queue
+			bool               m_ComputeInitialized;
+			amf::AMFComputePtr m_AMFCompute;
+		};
+	} // namespace AMD
+} // namespace Plugin
@@ -20,6 +20,7 @@
 #pragma once
 #include "amf-encoder.hpp"
 #include "plugin.hpp"
+#include "temporal-layers.hpp"
 
 #include <components/VideoEncoderVCE.h>
 
@@ -37,7 +38,8 @@ namespace Plugin {
 			EncoderH264(std::shared_ptr<API::IAPI> videoAPI, const API::Adapter& videoAdapter,
 						bool useOpenCLSubmission = false, bool useOpenCLConversion = false,
 						ColorFormat colorFormat = ColorFormat::NV12, ColorSpace colorSpace = ColorSpace::BT709,
-						bool fullRangeColor = false, bool useAsyncQueue = false, size_t asyncQueueSize = 0);
+						bool fullRangeColor = false, bool useAsyncQueue = false, size_t asyncQueueSize = 0,
+						Codec codec = Codec::AVC); // AVC or SVC
 			virtual ~EncoderH264();
 
 			// Properties - Initialization
@@ -145,6 +147,7 @@ namespace Plugin {
 			// Properties - Picture Control
 			virtual void     SetIDRPeriod(uint32_t v) override;
 			virtual uint32_t GetIDRPeriod() override;
+			virtual void     SetSegmentDuration(uint32_t v) override;
 
 			void     SetHeaderInsertionSpacing(uint32_t v);
 			uint32_t GetHeaderInsertionSpacing();
@@ -183,16 +186,35 @@ namespace Plugin {
 			void     SetIntraRefreshNumOfStripes(uint32_t v);
 			uint32_t GetIntraRefreshNumOfStripes();
 
+			// Derives the above from resolution and frame rate (set those first), see IntraRefresh. Replaces the
+			// periodic IDR- and I-Frames, scene cuts and segments while active, 0 disables.
+			void     SetIntraRefreshPeriod(uint32_t ms);
+			uint32_t GetIntraRefreshPeriod();
+
+			// Properties - Temporal Layers (SVC only, see TemporalLayers)
+			uint8_t CapsTemporalLayers(); // 1 if not available
+			void    SetTemporalLayers(uint8_t v);
+			uint8_t GetTemporalLayers();
+
+			void     SetTemporalLayerBitrate(uint8_t layer, uint64_t v);
+			uint64_t GetTemporalLayerBitrate(uint8_t layer);
+
+			void    SetTemporalLayerQP(uint8_t layer, uint8_t v); // P-Frames, I-Frames are always on the base layer
+			uint8_t GetTemporalLayerQP(uint8_t layer);
+
 			// Internal
 			virtual void LogProperties() override;
 
 			protected:
 			virtual void        PacketPriorityAndKeyframe(amf::AMFDataPtr& d, struct encoder_packet* p) override;
 			virtual AMF_RESULT  GetExtraDataInternal(amf::AMFVariant* p) override;
-			virtual std::string HandleTypeOverride(amf::AMFSurfacePtr& d, uint64_t index) override;
-
-			AMF_VIDEO_ENCODER_PICTURE_TYPE_ENUM m_FrameSkipType = AMF_VIDEO_ENCODER_PICTURE_TYPE_NONE;
+			virtual const char* HandleTypeOverride(amf::AMFSurfacePtr& d, uint64_t index) override;
+			virtual void        HandleQPOverride(amf::AMFDataPtr& d, int32_t offset) override;
 #endif
+
+			private:
+			uint8_t  m_TemporalLayers;
+			uint32_t m_IntraRefreshPeriod;
 		};
 	} // namespace AMD
 } // namespace Plugin
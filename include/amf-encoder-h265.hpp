@@ -135,6 +135,7 @@ namespace Plugin {
 
 			virtual void     SetIDRPeriod(uint32_t v) override; // Distance in GOPs
 			virtual uint32_t GetIDRPeriod() override;
+			virtual void     SetSegmentDuration(uint32_t v) override;
 
 			void                      SetHeaderInsertionMode(H265::HeaderInsertionMode v);
 			H265::HeaderInsertionMode GetHeaderInsertionMode();
@@ -204,9 +205,8 @@ namespace Plugin {
 			protected:
 			virtual void        PacketPriorityAndKeyframe(amf::AMFDataPtr& d, struct encoder_packet* p) override;
 			virtual AMF_RESULT  GetExtraDataInternal(amf::AMFVariant* p) override;
-			virtual std::string HandleTypeOverride(amf::AMFSurfacePtr& d, uint64_t index) override;
-
-			AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_ENUM m_FrameSkipType = AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_NONE;
+			virtual const char* HandleTypeOverride(amf::AMFSurfacePtr& d, uint64_t index) override;
+			virtual void        HandleQPOverride(amf::AMFDataPtr& d, int32_t offset) override;
 
 			//Remaining Properties
 			// PerformanceCounter (Interface, but which one?)
@@ -0,0 +1,104 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include "amf-encoder.hpp"
+#include "api-base.hpp"
+#include "plugin.hpp"
+
+namespace Plugin {
+	namespace AMD {
+		// Everything an Encoder is constructed with, all other settings can still be changed before Start().
+		struct EncoderParameters {
+			Codec                      codec;
+			std::shared_ptr<API::IAPI> api;
+			API::Adapter               adapter;
+			bool                       openCLSubmission;
+			bool                       openCLConversion;
+			ColorFormat                colorFormat;
+			ColorSpace                 colorSpace;
+			bool                       fullRangeColor;
+			bool                       multiThreading;
+			size_t                     queueSize;
+
+			std::unique_ptr<Encoder> Create() const;
+
+			friend bool operator==(const EncoderParameters& left, const EncoderParameters& right);
+			friend bool operator!=(const EncoderParameters& left, const EncoderParameters& right);
+		};
+
+		// Keeps one created but not yet started encoder per adapter and codec around, so that an output only has to
+		// apply its settings and initialize. Every idle encoder holds on to an encoder session, so this is opt-in.
+		class EncoderPool {
+#pragma region Singleton
+			public:
+			static EncoderPool* Instance();
+			static void         Finalize();
+
+			// Set through the OBS_AMF_ENCODER_POOL environment variable.
+			static bool IsEnabled();
+
+			private: // Private Initializer & Finalizer
+			EncoderPool();
+			~EncoderPool();
+
+			public: // Remove all Copy operators
+			EncoderPool(EncoderPool const&) = delete;
+			void operator=(EncoderPool const&) = delete;
+#pragma endregion Singleton
+
+			// Takes the prepared encoder if it was created with the same parameters, otherwise creates one right away.
+			// Either way another one is prepared in the background for the next caller.
+			std::unique_ptr<Encoder> Acquire(const EncoderParameters& params, bool* pooled = nullptr);
+
+			// Prepares an encoder in the background, replacing any other one for the same adapter and codec.
+			void Prepare(const EncoderParameters& params);
+
+			private:
+			enum class SlotState : uint8_t {
+				Empty,
+				Requested,
+				Creating,
+				Ready,
+				Failed,
+			};
+			struct Slot {
+				EncoderParameters        params = {};
+				SlotState                state  = SlotState::Empty;
+				std::unique_ptr<Encoder> encoder;
+			};
+			typedef std::tuple<API::Type, API::Adapter, Codec> SlotKey;
+
+			static SlotKey MakeKey(const EncoderParameters& params);
+			void           WorkerMain();
+
+			std::mutex              m_Mutex;
+			std::condition_variable m_CondVar;
+			std::map<SlotKey, Slot> m_Slots;
+			bool                    m_Shutdown;
+			std::thread             m_Worker;
+		};
+	} // namespace AMD
+} // namespace Plugin
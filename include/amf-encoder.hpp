@@ -18,6 +18,7 @@
  */
 
 #pragma once
+#include <atomic>
 #include <chrono>
 #include <cinttypes>
 #include <condition_variable>
@@ -25,9 +26,17 @@
 #include <queue>
 #include <thread>
 #include <vector>
+#include "amf-context.hpp"
 #include "amf.hpp"
 #include "api-base.hpp"
+#include "bitrate-controller.hpp"
+#include "frame-hash.hpp"
+#include "gop-planner.hpp"
+#include "hrd-model.hpp"
+#include "lookahead.hpp"
+#include "ltr-manager.hpp"
 #include "plugin.hpp"
+#include "scene-detector.hpp"
 
 #include <components/Component.h>
 
@@ -50,6 +59,11 @@ extern "C" {
 #define AMF_TIMESTAMP_SUBMIT L"TS_Submit"
 #define AMF_TIMESTAMP_QUERY L"TS_Query"
 #define AMF_TIME_MAIN L"T_Main" // Time between Submit and Query
+#define AMF_CPUTIME_ALLOCATE L"C_Allocate"
+#define AMF_CPUTIME_STORE L"C_Store"
+#define AMF_CPUTIME_CONVERT L"C_Convert"
+#define AMF_CPUTIME_MAIN L"C_Main"   // Calling thread, including polling
+#define AMF_CPUTIME_QUERY L"C_Query" // Asynchronous retrieve worker
 
 #define AMF_PRESENT_TIMESTAMP L"PTS"
 
@@ -185,6 +199,16 @@ namespace Plugin {
 			Unknown2,
 			Unknown3,
 		};
+		enum class SceneCutMode : uint8_t {
+			Disabled,
+			IFrame,
+			IDRFrame,
+		};
+		enum class HRDModelMode : uint8_t {
+			Disabled,
+			Monitor,
+			Feedback, // Also reports a draining buffer as congestion to the adaptive bitrate
+		};
 
 		class Encoder {
 			protected:
@@ -301,6 +325,10 @@ namespace Plugin {
 			virtual void SetFrameSkippingBehaviour(bool v);
 			virtual bool GetFrameSkippingBehaviour();
 
+			/// Frames identical to the previous one are skipped without uploading them, at most v in a row. 0 disables.
+			virtual void     SetStaticFrameSkipping(uint32_t v);
+			virtual uint32_t GetStaticFrameSkipping();
+
 			/// Enforce Hypothethical Reference Decoder Restrictions
 			virtual void SetEnforceHRDEnabled(bool v) = 0;
 			virtual bool IsEnforceHRDEnabled()        = 0;
@@ -350,6 +378,18 @@ namespace Plugin {
 			virtual void     SetBFramePeriod(uint32_t v);
 			virtual uint32_t GetBFramePeriod();
 
+			/// Forces a keyframe where the content changes completely, see SceneDetector.
+			virtual void         SetSceneCutMode(SceneCutMode v);
+			virtual SceneCutMode GetSceneCutMode();
+
+			virtual void     SetSceneCutMinimumDistance(uint32_t v);
+			virtual uint32_t GetSceneCutMinimumDistance();
+
+			/// Places an IDR-Frame at the start of every segment of this length (Milliseconds) by timestamp, for
+			/// HLS/DASH packaging. 0 disables, see GOPPlanner. The IDR period is ignored while segments are used.
+			virtual void     SetSegmentDuration(uint32_t v);
+			virtual uint32_t GetSegmentDuration();
+
 			virtual void SetGOPAlignmentEnabled(bool v) = 0;
 			virtual bool IsGOPAlignmentEnabled()        = 0;
 
@@ -374,6 +414,50 @@ namespace Plugin {
 			bool         IsStarted();
 			virtual void LogProperties() = 0;
 
+			// IDR-Frame on the next frame, or on the first frame with at least the given timestamp (same units as
+			// encoder_frame::pts). Can be called from any thread.
+			void RequestKeyframe();
+			void RequestKeyframe(int64_t pts);
+
+			// Long-Term References (see LTRManager), every nth frame is marked, 0 disables. Latched in Start().
+			void     SetLongTermReferencePeriod(uint32_t v);
+			uint32_t GetLongTermReferencePeriod();
+			// For links without feedback: frames count as received after this many frames, 0 = AcknowledgeFrame only.
+			void                   SetLongTermReferenceAcknowledgeDelay(uint32_t v);
+			uint32_t               GetLongTermReferenceAcknowledgeDelay();
+			LTRManager::Statistics GetLongTermReferenceStatistics();
+
+			// Receiver feedback (same units as encoder_frame::pts), can be called from any thread. A loss is recovered
+			// from by referencing the newest acknowledged LTR, or with an IDR-Frame if there is none.
+			void AcknowledgeFrame(int64_t pts);
+			void ReportLoss(int64_t pts);
+
+			// Time to first packet is measured from here (Clock ticks), defaults to construction.
+			void SetStartupTimestamp(uint64_t v);
+
+			// Black frames pushed through converter and encoder by Start(), the output is thrown away.
+			void     SetPreRollFrames(uint32_t v);
+			uint32_t GetPreRollFrames();
+
+			// Frames held back and analyzed before submission to offset the QP per frame, see Lookahead. Only used
+			// with Constant QP, taken over by Start(). Delays the output by as many frames, which are lost at Stop().
+			void     SetLookaheadFrames(uint32_t v);
+			uint32_t GetLookaheadFrames();
+
+			// Lowers target/peak bitrate and VBV size on congestion, see BitrateController. Enabling takes the
+			// currently set values as the upper limit, so call it again after changing them.
+			void SetAdaptiveBitrateEnabled(bool v);
+			bool IsAdaptiveBitrateEnabled();
+			void ReportCongestion(double v);
+			void ReportDroppedFrames(uint64_t dropped, uint64_t total);
+			void ReportBandwidth(uint64_t bitsPerSecond);
+
+			// Follows the decoder buffer with the packets coming out of the encoder, see HRDModel. Takes the currently
+			// set bitrate and VBV values, so call it again after changing them.
+			void                 SetHRDModelMode(HRDModelMode v);
+			HRDModelMode         GetHRDModelMode();
+			HRDModel::Statistics GetHRDModelStatistics();
+
 			bool Encode(struct encoder_frame* f, struct encoder_packet* p, bool* b);
 			void GetVideoInfo(struct video_scale_info* info);
 			bool GetExtraData(uint8_t** extra_data, size_t* size);
@@ -382,17 +466,34 @@ namespace Plugin {
 			protected:
 			void UpdateFrameRateValues();
 
+			// For HandleTypeOverride: whether a requested or LTR recovery keyframe is due, and what to do about LTRs.
+			bool               TakeKeyframeRequest(int64_t pts);
+			bool               NeedsLTRKeyframe();
+			LTRManager::Action NextLTRAction(uint64_t index, bool keyframe);
+
 			private:
 			virtual void        PacketPriorityAndKeyframe(amf::AMFDataPtr& d, struct encoder_packet* p) = 0;
 			virtual AMF_RESULT  GetExtraDataInternal(amf::AMFVariant* p)                                = 0;
-			virtual std::string HandleTypeOverride(amf::AMFSurfacePtr& d, uint64_t index)               = 0;
+			virtual const char* HandleTypeOverride(amf::AMFSurfacePtr& d, uint64_t index)               = 0;
+			virtual void        HandleQPOverride(amf::AMFDataPtr& d, int32_t offset)                    = 0;
+
+			bool PreRoll(); // Whether any frame went through, failures are only logged.
+			void UpdateAdaptiveBitrate();
+			void ConfigureHRDModel();
+			void UpdateHRDModel(uint64_t bits, uint64_t time);
+			bool DetectStaticFrame(struct encoder_frame* frame);
 
 			bool EncodeAllocate(OUT amf::AMFSurfacePtr& surface);
+			bool EncodeUpload(IN amf::AMFSurfacePtr& surface, IN struct encoder_frame* frame);
 			bool EncodeStore(OUT amf::AMFSurfacePtr& surface, IN struct encoder_frame* frame);
 			bool EncodeConvert(IN amf::AMFSurfacePtr& surface, OUT amf::AMFDataPtr& data);
+			bool EncodeLookahead(IN OUT amf::AMFDataPtr& data);
 			bool EncodeMain(IN amf::AMFDataPtr& data, OUT amf::AMFDataPtr& packet);
 			bool EncodeLoad(IN amf::AMFDataPtr& data, OUT struct encoder_packet* packet, OUT bool* received_packet);
 
+			// Oldest frame held back by the lookahead, with its QP offset applied.
+			amf::AMFDataPtr TakeLookahead();
+
 			static int32_t AsyncSendMain(Encoder* obj);
 			int32_t        AsyncSendLocalMain();
 			static int32_t AsyncRetrieveMain(Encoder* obj);
@@ -402,14 +503,15 @@ namespace Plugin {
 
 			protected:
 			// AMF Internals
-			Plugin::AMD::AMF*       m_AMF;
-			amf::AMFFactory*        m_AMFFactory;
-			amf::AMFContextPtr      m_AMFContext;
-			amf::AMFComputePtr      m_AMFCompute;
-			amf::AMFComponentPtr    m_AMFEncoder;
-			amf::AMFComponentPtr    m_AMFConverter;
-			amf::AMF_MEMORY_TYPE    m_AMFMemoryType;
-			amf::AMF_SURFACE_FORMAT m_AMFSurfaceFormat;
+			Plugin::AMD::AMF*              m_AMF;
+			std::shared_ptr<SharedContext> m_SharedContext;
+			amf::AMFFactory*               m_AMFFactory;
+			amf::AMFContextPtr             m_AMFContext;
+			amf::AMFComputePtr             m_AMFCompute;
+			amf::AMFComponentPtr           m_AMFEncoder;
+			amf::AMFComponentPtr           m_AMFConverter;
+			amf::AMF_MEMORY_TYPE           m_AMFMemoryType;
+			amf::AMF_SURFACE_FORMAT        m_AMFSurfaceFormat;
 
 			// API Related
 			std::shared_ptr<API::IAPI>     m_API;
@@ -448,19 +550,73 @@ namespace Plugin {
 			std::chrono::nanoseconds m_SubmitQueryWaitTimer;
 			uint64_t                 m_SubmitQueryAttempts;
 			uint64_t                 m_InitialFrameLatency;
-
-			/// Status
-			uint64_t m_SubmittedFrameCount;
-			bool     m_InitialFramesSent;
-			bool     m_InitialPacketRetrieved;
+			uint64_t                 m_StartupTimestamp; // Cleared once the first packet was reported
+			uint32_t                 m_PreRollFrames;
+
+			/// CPU Time (Nanoseconds)
+			uint64_t m_CPUTimeMainPending; // Spent in EncodeMain since the last retrieved packet
+			// Spent by the send worker, only known once the surface is submitted, so it goes to the next packet.
+			std::atomic<uint64_t> m_CPUTimeSubmitPending;
+			struct CPUTimeStatistics {
+				uint64_t frames;
+				uint64_t latency;
+				uint64_t allocate, store, convert, main, submit, query, load;
+			} m_CPUTimeStatistics;
+
+			/// Status (written by the asynchronous workers too)
+			std::atomic<uint64_t> m_SubmittedFrameCount;
+			std::atomic<bool>     m_InitialFramesSent;
+			bool                  m_InitialPacketRetrieved;
 
 			/// Periods
-			uint32_t m_PeriodIDR;
-			uint32_t m_PeriodIFrame;
-			uint32_t m_PeriodPFrame;
-			uint32_t m_PeriodBFrame;
-			uint32_t m_FrameSkipPeriod;
-			bool     m_FrameSkipKeepOnlyNth; // false = drop every xth frame, true = drop all but every xth frame
+			uint32_t   m_PeriodIDR;
+			uint32_t   m_PeriodIFrame;
+			uint32_t   m_PeriodPFrame;
+			uint32_t   m_PeriodBFrame;
+			uint32_t   m_FrameSkipPeriod;
+			bool       m_FrameSkipKeepOnlyNth; // false = drop every xth frame, true = drop all but every xth frame
+			uint32_t   m_SegmentDuration;
+			GOPPlanner m_GOPPlanner; // Compiled from the above by HandleTypeOverride
+
+			/// Keyframe Requests
+			std::mutex           m_KeyframeRequestMutex;
+			std::vector<int64_t> m_KeyframeRequests;
+
+			/// Long-Term References
+			uint32_t   m_LTRPeriod;
+			uint32_t   m_LTRAcknowledgeDelay;
+			std::mutex m_LTRMutex;
+			LTRManager m_LTRManager;
+
+			/// Scene Cuts
+			SceneDetector m_SceneDetector;
+			SceneCutMode  m_SceneCutMode;
+			bool          m_SceneCut; // Set by EncodeStore for HandleTypeOverride
+
+			/// Static Frames
+			uint32_t           m_StaticSkipMaximum;
+			uint32_t           m_StaticSkipRun;
+			uint64_t           m_StaticHash;
+			amf::AMFSurfacePtr m_StaticSurface; // Last uploaded surface, still holds the content of unchanged frames
+			bool               m_StaticFrame;   // Set by Encode for the following steps
+
+			/// Lookahead
+			uint32_t                     m_LookaheadFrames;
+			uint32_t                     m_LookaheadDepth; // Taken over from the above by Start()
+			Lookahead                    m_Lookahead;
+			Lookahead::Complexity        m_LookaheadComplexity; // Set by EncodeStore for EncodeLookahead
+			std::vector<amf::AMFDataPtr> m_LookaheadQueue;      // Ring in step with the window of m_Lookahead
+			size_t                       m_LookaheadHead;
+
+			/// Adaptive Bitrate
+			std::mutex                         m_BitrateControllerMutex;
+			std::unique_ptr<BitrateController> m_BitrateController;
+
+			/// Decoder Buffer
+			std::mutex   m_HRDModelMutex; // Taken after m_BitrateControllerMutex, never before
+			HRDModelMode m_HRDModelMode;
+			HRDModel     m_HRDModel;
+			uint64_t     m_HRDModelLastWarning; // Stream time, keeps violations from flooding the log
 
 			/// Multi-Threading
 			bool m_MultiThreading;
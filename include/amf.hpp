@@ -38,9 +38,16 @@ namespace Plugin {
 #pragma region Singleton
 			public:
 			static void Initialize();
-			static AMF* Instance();
+			static AMF* Instance(); // Initializes on first use, throws if the runtime is unusable.
 			static void Finalize();
 
+			// Whether the AMF runtime library is installed, without initializing it.
+			static bool IsAvailable();
+
+			// File version of the AMF runtime library, which ships with the driver. Read without running any of its
+			// code, 0 if it is missing.
+			static uint64_t GetRuntimeFileVersion();
+
 			private: // Private Initializer & Finalizer
 			AMF();
 			~AMF();
@@ -20,6 +20,7 @@
 #pragma once
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string.h>
 #include <vector>
 #include "plugin.hpp"
@@ -38,16 +39,31 @@ namespace Plugin {
 			int32_t     idLow, idHigh;
 			std::string Name;
 
-			Adapter() : idLow(0), idHigh(0), Name("Invalid Device") {}
+			// Identify the hardware and driver across reboots, unlike the LUID above. Zero if the API can't tell.
+			uint32_t vendorId, deviceId;
+			uint64_t driverVersion;
+
+			Adapter() : idLow(0), idHigh(0), Name("Invalid Device"), vendorId(0), deviceId(0), driverVersion(0) {}
 			Adapter(const int32_t p_idLow, const int32_t p_idHigh, const std::string& p_Name)
-				: idLow(p_idLow), idHigh(p_idHigh), Name(p_Name)
+				: idLow(p_idLow), idHigh(p_idHigh), Name(p_Name), vendorId(0), deviceId(0), driverVersion(0)
+			{}
+			Adapter(const int32_t p_idLow, const int32_t p_idHigh, const std::string& p_Name, const uint32_t p_vendorId,
+					const uint32_t p_deviceId, const uint64_t p_driverVersion)
+				: idLow(p_idLow), idHigh(p_idHigh), Name(p_Name), vendorId(p_vendorId), deviceId(p_deviceId),
+				  driverVersion(p_driverVersion)
+			{}
+			Adapter(Adapter const& o)
+				: Name(o.Name), idLow(o.idLow), idHigh(o.idHigh), vendorId(o.vendorId), deviceId(o.deviceId),
+				  driverVersion(o.driverVersion)
 			{}
-			Adapter(Adapter const& o) : Name(o.Name), idLow(o.idLow), idHigh(o.idHigh) {}
 			void operator=(Adapter const& o)
 			{
-				idLow  = o.idLow;
-				idHigh = o.idHigh;
-				Name   = o.Name;
+				idLow         = o.idLow;
+				idHigh        = o.idHigh;
+				Name          = o.Name;
+				vendorId      = o.vendorId;
+				deviceId      = o.deviceId;
+				driverVersion = o.driverVersion;
 			}
 
 			friend bool operator<(const Plugin::API::Adapter& left, const Plugin::API::Adapter& right);
@@ -82,7 +98,21 @@ namespace Plugin {
 			Adapter                      GetAdapterById(const int32_t idLow, const int32_t idHigh);
 			Adapter                      GetAdapterByName(const std::string& name);
 
-			virtual std::shared_ptr<Instance> CreateInstance(Adapter adapter) = 0;
+			// Returns the instance for the adapter that is already alive, or creates a new one. Instances are only
+			// weakly referenced here, the device goes away with the last user.
+			std::shared_ptr<Instance> CreateInstance(Adapter adapter);
+
+			protected:
+			virtual std::shared_ptr<Instance> CreateInstanceInternal(Adapter adapter) = 0;
+
+			private:
+			struct InstanceSlot {
+				std::weak_ptr<Instance>     instance;
+				std::shared_ptr<std::mutex> creation;
+			};
+
+			std::mutex                                          m_InstanceMapMutex;
+			std::map<std::pair<int32_t, int32_t>, InstanceSlot> m_InstanceMap;
 		};
 
 		// Static API Stuff
@@ -19,6 +19,7 @@
 
 #pragma once
 #include <atlutil.h>
+#include <d3d10.h>
 #include <d3d11.h>
 #include <dxgi.h>
 #include <map>
@@ -35,15 +36,14 @@ namespace Plugin {
 			Direct3D11();
 			~Direct3D11();
 
-			virtual std::string               GetName() override;
-			virtual Type                      GetType() override;
-			virtual std::vector<Adapter>      EnumerateAdapters() override;
-			virtual std::shared_ptr<Instance> CreateInstance(Adapter adapter) override;
+			virtual std::string          GetName() override;
+			virtual Type                 GetType() override;
+			virtual std::vector<Adapter> EnumerateAdapters() override;
 
 			protected:
+			virtual std::shared_ptr<Instance> CreateInstanceInternal(Adapter adapter) override;
+
 			ATL::CComPtr<IDXGIFactory1> m_DXGIFactory;
-			//std::mutex m_InstanceMapMutex;
-			//std::map<std::pair<int32_t, int32_t>, std::shared_ptr<Instance>> m_InstanceMap;
 
 			private:
 			std::vector<Adapter> m_AdapterList;
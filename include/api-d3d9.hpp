@@ -36,14 +36,14 @@ namespace Plugin {
 			Direct3D9();
 			~Direct3D9();
 
-			virtual std::string               GetName() override;
-			virtual Type                      GetType() override;
-			virtual std::vector<Adapter>      EnumerateAdapters() override;
-			virtual std::shared_ptr<Instance> CreateInstance(Adapter adapter) override;
+			virtual std::string          GetName() override;
+			virtual Type                 GetType() override;
+			virtual std::vector<Adapter> EnumerateAdapters() override;
 
 			protected:
+			virtual std::shared_ptr<Instance> CreateInstanceInternal(Adapter adapter) override;
+
 			IDirect3D9Ex* m_Direct3D9Ex;
-			//std::map<std::pair<int32_t, int32_t>, std::shared_ptr<Instance>> m_InstanceMap;
 
 			private:
 			std::vector<Adapter> m_Adapters;
@@ -24,10 +24,12 @@ namespace Plugin {
 	namespace API {
 		class Host : public IAPI {
 			public:
-			virtual std::string               GetName() override;
-			virtual Type                      GetType() override;
-			virtual std::vector<Adapter>      EnumerateAdapters() override;
-			virtual std::shared_ptr<Instance> CreateInstance(Adapter adapter) override;
+			virtual std::string          GetName() override;
+			virtual Type                 GetType() override;
+			virtual std::vector<Adapter> EnumerateAdapters() override;
+
+			protected:
+			virtual std::shared_ptr<Instance> CreateInstanceInternal(Adapter adapter) override;
 		};
 
 		class HostInstance : public Instance {
@@ -0,0 +1,86 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+
+namespace Plugin {
+	/* Lowers target bitrate, peak bitrate and VBV size while the connection can't keep up and slowly brings them back
+	 * once it can. Only numbers go in and out, times are in nanoseconds, so this runs without an encoder or OBS.
+	 *
+	 * - Above congestionHigh the bitrate is stepped down multiplicatively, at most once per interval.
+	 * - Below congestionLow it is stepped up additively, but only after it stayed low for recoveryDelay.
+	 * - In between nothing changes, so a connection hovering around one threshold does not flap.
+	 */
+	class BitrateController {
+		public:
+		struct Settings {
+			double   minimumFactor     = 0.25;         // Never go below this share of the configured bitrate
+			double   congestionHigh    = 0.25;         // Step down above this
+			double   congestionLow     = 0.05;         // Step up below this
+			double   decreaseStep      = 0.15;         // Share of the current bitrate taken away per step
+			double   increaseStep      = 0.05;         // Share of the configured bitrate added per step
+			double   dropWeight        = 5.0;          // Dropped frame ratio to congestion
+			double   bandwidthHeadroom = 0.85;         // Share of an estimated bandwidth that is used for video
+			uint64_t interval          = 1000000000;   // Minimum time between two decisions
+			uint64_t recoveryDelay     = 10000000000;  // Time without congestion before stepping up
+			uint64_t increaseInterval  = 3000000000;   // Minimum time between two steps up
+		};
+
+		BitrateController();
+		BitrateController(const Settings& settings);
+
+		// Bitrates as set by the user, the controller never goes above them. A reduction that is in effect is kept
+		// and applied to the new values on the next Update().
+		void Configure(uint64_t targetBitrate, uint64_t peakBitrate, uint64_t vbvBufferSize);
+
+		// From 0 (none) to 1 (nothing gets through), the highest value since the last decision counts.
+		void ReportCongestion(double congestion);
+		// Cumulative counters, e.g. from the output.
+		void ReportDroppedFrames(uint64_t dropped, uint64_t total);
+		// Estimated available bandwidth in bits per second, 0 clears the estimate.
+		void ReportBandwidth(uint64_t bitsPerSecond);
+
+		// True if the bitrates changed and have to be applied.
+		bool Update(uint64_t now);
+
+		uint64_t GetTargetBitrate();
+		uint64_t GetPeakBitrate();
+		uint64_t GetVBVBufferSize();
+		double   GetFactor();
+
+		private:
+		Settings m_Settings;
+
+		uint64_t m_TargetBitrate;
+		uint64_t m_PeakBitrate;
+		uint64_t m_VBVBufferSize;
+		double   m_Factor;
+		bool     m_Pending; // Configured while reduced
+
+		double   m_Congestion;
+		uint64_t m_Dropped, m_Total;
+		uint64_t m_Bandwidth;
+
+		bool     m_Running;
+		uint64_t m_LastDecision;
+		uint64_t m_LastChange;
+		uint64_t m_LowSince;
+	};
+} // namespace Plugin
@@ -0,0 +1,61 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <chrono>
+#include <cinttypes>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PLUGIN_CLOCK_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Cheap monotonic clock for hot-path timestamps. Uses the invariant TSC when the CPU has one and falls back to
+// std::chrono::steady_clock otherwise. Values are in ticks, convert them only when reporting.
+
+namespace Plugin {
+	namespace Clock {
+		namespace Internal {
+			extern bool   UseTSC;
+			extern double NanosecondsPerTick;
+		} // namespace Internal
+
+		/// Detects and calibrates the TSC against steady_clock, takes a few milliseconds.
+		void Initialize();
+		bool IsTSC();
+
+		inline uint64_t Now()
+		{
+#ifdef PLUGIN_CLOCK_TSC
+			if (Internal::UseTSC)
+				return __rdtsc();
+#endif
+			return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+		}
+
+		inline uint64_t ToNanoseconds(uint64_t ticks)
+		{
+			return (uint64_t)((double)ticks * Internal::NanosecondsPerTick);
+		}
+	} // namespace Clock
+} // namespace Plugin
@@ -32,6 +32,9 @@ namespace Plugin {
 
 			static bool properties_modified(obs_properties_t* props, obs_property_t*, obs_data_t* data);
 
+			// Has an encoder with the default settings created in the background, see AMD::EncoderPool.
+			static void prepare();
+
 			static void* create(obs_data_t* settings, obs_encoder_t* encoder);
 			static void  destroy(void* ptr);
 			static bool  update(void* ptr, obs_data_t* data);
@@ -58,6 +61,7 @@ namespace Plugin {
 			private:
 			std::unique_ptr<Plugin::AMD::EncoderH265> m_VideoEncoder;
 			obs_encoder_t*                            m_Encoder;
+			uint64_t                                  m_CongestionQueryTimestamp;
 		};
 	} // namespace Interface
 } // namespace Plugin
@@ -0,0 +1,32 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+
+namespace Plugin {
+	namespace FrameHash {
+		/* Fast 64-bit hash to tell whether a frame is identical to the previous one, in the style of XXH3: every
+		 * 8 bytes are multiplied with themselves after mixing in a key, and the accumulators are scrambled every KiB.
+		 * Uses SSE2 where available, only meant for comparing within the same process.
+		 */
+		uint64_t Compute(const void* data, size_t size, uint64_t seed = 0);
+	} // namespace FrameHash
+} // namespace Plugin
@@ -0,0 +1,95 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+namespace Plugin {
+	// Same order as AMF uses for both H264 and H265, lower values win over higher ones (except None).
+	enum class PictureType : uint8_t {
+		None,
+		Skip,
+		IDR,
+		I,
+		P,
+		B,
+	};
+
+	/* Decides which picture type to force for every frame. The periods are compiled into a table covering one full
+	 * cycle (the least common multiple of all periods), so a frame only needs a single lookup. Types that fall on a
+	 * skipped frame, as well as requested keyframes, carry over to the next frame that is not skipped. Segment
+	 * boundaries are the exception, they are placed by timestamp and always get an IDR-Frame.
+	 */
+	class GOPPlanner {
+		public:
+		struct Periods {
+			uint64_t idr;         // Only upgrades frames that already have a type, the encoder places IDRs itself.
+			uint32_t iframe;
+			uint32_t pframe;
+			uint32_t bframe;
+			uint32_t skip;
+			bool     keepOnlyNth; // false = skip every nth frame, true = skip all but every nth frame
+
+			bool operator==(const Periods& other) const;
+			bool operator!=(const Periods& other) const;
+		};
+
+		GOPPlanner();
+
+		// Compiles the schedule, does nothing if the periods did not change.
+		void           Configure(const Periods& periods);
+		const Periods& GetPeriods();
+		// Length of the compiled cycle, 0 if it was too long to compile and frames are evaluated on the fly.
+		size_t GetCycleLength();
+
+		// Places an IDR-Frame on the first frame of every segment of the given length, with the index being the
+		// timestamp in 1/framerate units. Dropped frames and long runs never shift the boundaries. 0 disables.
+		void     SetSegmentDuration(uint32_t milliseconds, uint32_t fpsNumerator, uint32_t fpsDenominator);
+		uint32_t GetSegmentDuration();
+
+		// Forgets carried over types and requests, the next frame starts a segment.
+		void Reset();
+
+		// Forces at least the given type on the next frame that is not skipped.
+		void Request(PictureType type);
+
+		// Picture type for the frame, keyframe is set if the encoder will produce an I- or IDR-Frame.
+		PictureType Next(uint64_t index, bool& keyframe);
+
+		private:
+		struct Slot {
+			PictureType type;
+			bool        skip;
+			bool        idr; // Falls on the IDR period
+		};
+
+		Slot Evaluate(uint64_t index);
+
+		Periods           m_Periods;
+		std::vector<Slot> m_Schedule;
+		PictureType       m_Pending;
+
+		uint32_t m_SegmentDuration; // Milliseconds
+		uint32_t m_SegmentFPSNumerator, m_SegmentFPSDenominator;
+		uint64_t m_Segment; // Of the last frame
+		bool     m_HasSegment;
+	};
+} // namespace Plugin
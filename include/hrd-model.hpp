@@ -0,0 +1,66 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+
+namespace Plugin {
+	/* Leaky bucket model of the decoder buffer (CPB/VBV) a stream is sent into. The buffer fills at the bitrate and
+	 * every frame is removed in one piece at its decode time. Removing a frame that is not completely in the buffer
+	 * is an underflow. For CBR the buffer must also never run full, since the encoder should have spent those bits
+	 * (filler data), which is an overflow. Times are in nanoseconds, so this runs without an encoder.
+	 */
+	class HRDModel {
+		public:
+		struct Statistics {
+			uint64_t frames;
+			uint64_t underflows;
+			uint64_t overflows;
+			double   minimumFullness; // 0 (empty) to 1 (full)
+			double   maximumFullness;
+		};
+
+		HRDModel();
+
+		// Keeps the current fullness (clamped to the new size) and the statistics.
+		void Configure(uint64_t bitrate, uint64_t bufferSize, double initialFullness, bool constantBitrate);
+
+		// Starts over at the initial fullness and clears the statistics.
+		void Reset();
+
+		// Removes a frame of the given size at its decode time, returns false if that violated the buffer.
+		bool AddFrame(uint64_t bits, uint64_t time);
+
+		double GetFullness();
+		// How close the buffer is to an underflow, from 0 (at least a quarter full) to 1 (empty).
+		double            GetPressure();
+		const Statistics& GetStatistics();
+
+		private:
+		uint64_t m_Bitrate;
+		uint64_t m_BufferSize;
+		double   m_InitialFullness;
+		bool     m_ConstantBitrate;
+
+		double     m_Fullness; // In bits
+		bool       m_Running;
+		uint64_t   m_LastTime;
+		Statistics m_Statistics;
+	};
+} // namespace Plugin
@@ -0,0 +1,40 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+
+namespace Plugin {
+	namespace IntraRefresh {
+		/* Instead of IDR-Frames, every frame refreshes a stripe of the picture with intra-coded macroblocks, until
+		 * the whole picture was refreshed once per period. No single frame is much larger than the others, so the
+		 * VBV buffer can be kept small without the quality dips that IDR-Frames cause in it.
+		 */
+		struct Layout {
+			uint32_t mbsPerSlot; // Intra-coded macroblocks per frame, 0 = disabled
+			uint32_t stripes;    // Frames it takes to refresh the whole picture
+		};
+
+		// Layout that refreshes the picture within periodMs, in whole macroblock rows where possible. The encoder
+		// limits the macroblocks per frame, which can make the actual period (stripes) longer or shorter. A maximum
+		// of 0 is how the encoder reports that it can't do intra-refresh, the layout is disabled then.
+		Layout Plan(uint32_t width, uint32_t height, uint32_t fpsNumerator, uint32_t fpsDenominator, uint32_t periodMs,
+					uint32_t minimumMBs, uint32_t maximumMBs);
+	} // namespace IntraRefresh
+} // namespace Plugin
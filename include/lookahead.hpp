@@ -0,0 +1,69 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+namespace Plugin {
+	/* Estimates how much of a frame the following frames reuse, so that frames which are referenced a lot can get a
+	 * lower QP and frames nobody refers back to a higher one (a very small macroblock tree). Luma is reduced to the
+	 * averages of 8x8 blocks: the gradient between blocks stands in for the intra cost, the difference to the same
+	 * block in the previous frame for the inter cost. Costs about as much as scene detection and never allocates
+	 * once the resolution and depth are known.
+	 */
+	class Lookahead {
+		public:
+		struct Complexity {
+			double intra;
+			double inter; // Never more than intra, the encoder would code the block intra instead
+		};
+
+		Lookahead();
+
+		// Frames analyzed after the one that is taken next, sizes the window.
+		void     SetDepth(uint32_t v);
+		uint32_t GetDepth();
+
+		void Reset();
+
+		// Luma of the next frame, step is the distance between two luma samples in bytes (e.g. 2 for YUY2).
+		Complexity Analyze(const uint8_t* data, size_t linesize, uint32_t width, uint32_t height, uint32_t step = 1);
+
+		// Adds an analyzed frame to the window, Next() has to be called once more than depth frames are waiting.
+		void   Push(const Complexity& v);
+		size_t GetCount();
+
+		// QP offset for the oldest frame in the window, which is removed. Offsets average out to zero.
+		int32_t Next();
+
+		private:
+		uint32_t m_Depth;
+
+		uint32_t             m_Width, m_Height, m_Columns, m_Rows;
+		std::vector<uint8_t> m_Blocks, m_PreviousBlocks;
+		bool                 m_HasPrevious;
+
+		std::vector<Complexity> m_Window; // Ring of depth + 1 frames
+		size_t                  m_WindowHead, m_WindowCount;
+		double                  m_AverageReuse;
+		bool                    m_HasAverage;
+	};
+} // namespace Plugin
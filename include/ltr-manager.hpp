@@ -0,0 +1,81 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+#include <vector>
+
+namespace Plugin {
+	/* Keeps track of long-term reference frames for recovering from packet loss without an IDR-Frame. Every nth
+	 * frame is marked into one of the LTR slots. Once the receiver acknowledged a marked frame, a reported loss only
+	 * costs one frame that references that LTR instead of the lost chain of short-term references. Indices are
+	 * timestamps in 1/framerate units, as for the GOPPlanner.
+	 */
+	class LTRManager {
+		public:
+		struct Action {
+			int32_t mark;      // Slot to store this frame in, -1 for none
+			int64_t reference; // Bitfield of the only slots this frame may reference, 0 for normal prediction
+		};
+		struct Statistics {
+			uint64_t marked;
+			uint64_t losses;
+			uint64_t recovered; // Through an LTR
+			uint64_t keyframes; // Nothing usable was acknowledged, needed a keyframe
+		};
+
+		LTRManager();
+
+		// Without feedback from the receiver, frames count as acknowledged once acknowledgeDelay frames have passed
+		// (0 = only through Acknowledge). Changing anything forgets all marked frames.
+		void Configure(uint32_t slots, uint32_t period, uint32_t acknowledgeDelay);
+		void Reset();
+
+		// The receiver has everything up to and including this frame.
+		void Acknowledge(uint64_t index);
+		// The receiver is missing this frame, the next one has to recover from it.
+		void ReportLoss(uint64_t index);
+
+		// True if a loss is pending that no acknowledged LTR can recover from, the next frame has to be a keyframe.
+		bool NeedsKeyframe();
+
+		// Decides for the frame, keyframe is set for I- and IDR-Frames (which are treated as dropping all LTRs).
+		Action Next(uint64_t index, bool keyframe);
+
+		const Statistics& GetStatistics();
+
+		private:
+		struct Slot {
+			bool     used;
+			bool     acknowledged;
+			uint64_t index;
+		};
+
+		int32_t FindRecovery();
+
+		std::vector<Slot> m_Slots;
+		uint32_t          m_Period;
+		uint32_t          m_AcknowledgeDelay;
+		bool              m_HasMark;
+		uint64_t          m_LastMark;
+		bool              m_Loss;
+		uint64_t          m_LossIndex;
+		Statistics        m_Statistics;
+	};
+} // namespace Plugin
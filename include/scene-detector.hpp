@@ -0,0 +1,65 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+namespace Plugin {
+	/* Finds scene cuts in the luma of consecutive frames. Every 16th row is reduced to averages of 8 pixels and the
+	 * resulting thumbnail is compared with the one of the previous frame. A cut needs both a difference well above
+	 * the recent average (so fast motion doesn't count) and a changed brightness histogram (so panning doesn't).
+	 * Costs a few dozen microseconds at 1080p and never allocates once the resolution is known.
+	 */
+	class SceneDetector {
+		public:
+		SceneDetector();
+
+		// Frames that have to pass after any keyframe before a cut is reported again.
+		void     SetMinimumDistance(uint32_t v);
+		uint32_t GetMinimumDistance();
+
+		void Reset();
+
+		// Luma of the next frame, step is the distance between two luma samples in bytes (e.g. 2 for YUY2).
+		// Returns true if the frame starts a new scene.
+		bool Analyze(const uint8_t* data, size_t linesize, uint32_t width, uint32_t height, uint32_t step = 1);
+
+		// A keyframe was placed for another reason, the minimum distance starts over.
+		void NotifyKeyframe();
+
+		// Mean absolute difference (0 - 255) and histogram distance (0 - 1) of the last analyzed frame.
+		double GetLastDifference();
+		double GetLastHistogramDistance();
+
+		private:
+		uint32_t m_MinimumDistance;
+		uint32_t m_Distance;
+
+		uint32_t             m_Width, m_Height, m_Columns, m_Rows;
+		std::vector<uint8_t> m_Thumbnail, m_PreviousThumbnail;
+		uint32_t             m_Histogram[32], m_PreviousHistogram[32];
+		bool                 m_HasPrevious;
+
+		double m_AverageDifference;
+		double m_LastDifference;
+		double m_LastHistogramDistance;
+	};
+} // namespace Plugin
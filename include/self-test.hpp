@@ -0,0 +1,76 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+// enc-amf-test reports to the plugin over stdout, one tab separated record per line:
+//   version <protocol>
+//   probe   <api> <adapter> <codec> <supported> <microseconds>
+//   error   <message>
+//   done    <microseconds>
+#define SELFTEST_PROTOCOL_VERSION 1
+#define SELFTEST_RECORD_VERSION "version"
+#define SELFTEST_RECORD_PROBE "probe"
+#define SELFTEST_RECORD_ERROR "error"
+#define SELFTEST_RECORD_DONE "done"
+
+// Milliseconds module load waits for the test when it has to gate on the result.
+#define SELFTEST_TIMEOUT 15000
+
+namespace Plugin {
+	namespace SelfTest {
+		enum class Status : uint8_t {
+			Pending,
+			Passed,
+			Failed,
+			Crashed,
+		};
+
+		struct Probe {
+			std::string api;
+			std::string adapter;
+			std::string codec;
+			bool        supported;
+			uint64_t    time; // Microseconds
+		};
+
+		struct Result {
+			Status                   status   = Status::Pending;
+			int64_t                  exitCode = -1;
+			std::vector<Probe>       probes;
+			std::vector<std::string> errors;
+			uint64_t                 duration = 0; // Microseconds, as reported by the test.
+			uint64_t                 wallTime = 0; // Microseconds, from launch until exit.
+		};
+
+		// Launches the test in the background, returns false if the process could not be started.
+		bool Start();
+
+		// Waits up to timeout milliseconds, the status is Pending if the test is still running.
+		Result Wait(uint32_t timeout);
+
+		// Kills the test if it is still running and releases all resources.
+		void Finalize();
+
+		const char* StatusToString(Status v);
+	} // namespace SelfTest
+} // namespace Plugin
@@ -60,6 +60,9 @@
 #define P_CODINGTYPE_CABAC "CodingType.CABAC"
 #define P_CODINGTYPE_CAVLC "CodingType.CAVLC"
 #define P_MAXIMUMREFERENCEFRAMES "MaximumReferenceFrames"
+#define P_TEMPORALLAYERS "TemporalLayers"                     // H264
+#define P_TEMPORALLAYERS_QPDELTA "TemporalLayers.QPDelta"     // H264
+#define P_TEMPORALLAYERS_BASESHARE "TemporalLayers.BaseShare" // H264
 
 // Rate Control
 #define P_RATECONTROLMETHOD "RateControlMethod"
@@ -82,14 +85,20 @@
 #define P_QP_PFRAME_MINIMUM "QP.PFrame.Minimum" // H265
 #define P_QP_PFRAME_MAXIMUM "QP.PFrame.Maximum" // H265
 #define P_QP_BFRAME "QP.BFrame"                 // H264
+#define P_LOOKAHEAD "Lookahead"
 #define P_FILLERDATA "FillerData"
 #define P_FRAMESKIPPING "FrameSkipping"
 #define P_FRAMESKIPPING_PERIOD "FrameSkipping.Period"
 #define P_FRAMESKIPPING_BEHAVIOUR "FrameSkipping.Behaviour"
 #define P_FRAMESKIPPING_SKIPNTH "FrameSkipping.SkipNth"
 #define P_FRAMESKIPPING_KEEPNTH "FrameSkipping.KeepNth"
+#define P_FRAMESKIPPING_STATIC "FrameSkipping.Static"
 #define P_VBAQ "VBAQ"
 #define P_ENFORCEHRD "EnforceHRD"
+#define P_ADAPTIVEBITRATE "AdaptiveBitrate"
+#define P_HRDMODEL "HRDModel"
+#define P_HRDMODEL_MONITOR "HRDModel.Monitor"
+#define P_HRDMODEL_FEEDBACK "HRDModel.Feedback"
 
 // VBV Buffer
 #define P_VBVBUFFER "VBVBuffer"
@@ -101,12 +110,18 @@
 #define P_INTERVAL_KEYFRAME "Interval.Keyframe"
 #define P_PERIOD_IDR_H264 "Period.IDR.H264" // H264
 #define P_PERIOD_IDR_H265 "Period.IDR.H265" // H265
+#define P_INTERVAL_SEGMENT "Interval.Segment"
+#define P_INTRAREFRESH "IntraRefresh" // H264
 #define P_INTERVAL_IFRAME "Interval.IFrame"
 #define P_PERIOD_IFRAME "Period.IFrame"
 #define P_INTERVAL_PFRAME "Interval.PFrame"
 #define P_PERIOD_PFRAME "Period.PFrame"
 #define P_INTERVAL_BFRAME "Interval.BFrame"
 #define P_PERIOD_BFRAME "Period.BFrame"
+#define P_SCENECUT "SceneCut"
+#define P_SCENECUT_IFRAME "SceneCut.IFrame"
+#define P_SCENECUT_IDRFRAME "SceneCut.IDRFrame"
+#define P_SCENECUT_DISTANCE "SceneCut.Distance"
 #define P_GOP_TYPE "GOP.Type"                               // H265
 #define P_GOP_TYPE_FIXED "GOP.Type.Fixed"                   // H265
 #define P_GOP_TYPE_VARIABLE "GOP.Type.Variable"             // H265
@@ -131,6 +146,7 @@
 #define P_OPENCL_CONVERSION "OpenCL.Conversion"
 #define P_MULTITHREADING "MultiThreading"
 #define P_QUEUESIZE "QueueSize"
+#define P_PREROLL "PreRoll"
 #define P_DEBUG "Debug"
 
 #define P_VIEW "View"
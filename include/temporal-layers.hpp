@@ -0,0 +1,48 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+
+namespace Plugin {
+	namespace TemporalLayers {
+		/* Dyadic temporal scalability as H264/SVC (Annex G) does it: the base layer holds every 2^(n-1)th frame and
+		 * every layer above doubles the frame rate. A layer is only ever referenced by the layers above it, so
+		 * dropping from the top down never breaks decoding of what is left.
+		 */
+		const uint8_t MAXIMUM = 4;
+
+		// Layer of an Annex B access unit, from the temporal_id of the first NAL unit with an SVC header extension.
+		// Streams without one fall back to nal_ref_idc: non-reference pictures are on the top layer, the rest on the
+		// base layer.
+		uint8_t Find(const uint8_t* data, size_t size, uint8_t layers);
+
+		// OBS packet priority (not for keyframes): the base layer is kept as long as any P-Frame is, the layers above
+		// it go first and the top layer, which nothing references, is disposable.
+		int Priority(uint8_t layer, uint8_t layers);
+
+		// Share of all frames that fall on the layer.
+		double FrameShare(uint8_t layer, uint8_t layers);
+
+		// Bitrate of the layer alone. The base layer gets baseShare (0 to 1) of the total, the layers above split the
+		// remainder by the frames they carry.
+		uint64_t Bitrate(uint8_t layer, uint8_t layers, uint64_t bitrate, double baseShare);
+	} // namespace TemporalLayers
+} // namespace Plugin
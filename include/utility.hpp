@@ -31,6 +31,12 @@ namespace Utility {
 	uint64_t    GetUniqueIdentifier();
 	const char* obs_module_text_multi(const char* val, uint8_t depth = (uint8_t)1);
 
+#ifndef LITE_OBS
+	// Congestion and frame counters of the active output that uses the encoder, false if there is none. With more than
+	// one output the highest congestion is reported, and the frame counters of the one dropping the most.
+	bool GetOutputCongestion(obs_encoder_t* encoder, double& congestion, uint64_t& dropped, uint64_t& total);
+#endif
+
 	// Codec
 	const char*    CodecToString(Plugin::AMD::Codec v);
 	const wchar_t* CodecToAMF(Plugin::AMD::Codec v);
@@ -97,6 +103,11 @@ namespace Utility {
 	const char* SliceModeToString(Plugin::AMD::H264::SliceMode v);
 	const char* SliceControlModeToString(Plugin::AMD::SliceControlMode v);
 
+	// Scene Cuts
+	const char* SceneCutModeToString(Plugin::AMD::SceneCutMode v);
+	const char* HRDModelModeToString(Plugin::AMD::HRDModelMode v);
+	const char* PictureTypeToString(Plugin::PictureType v);
+
 	Plugin::AMD::ProfileLevel H264ProfileLevel(std::pair<uint32_t, uint32_t> resolution,
 											   std::pair<uint32_t, uint32_t> frameRate);
 	Plugin::AMD::ProfileLevel H265ProfileLevel(std::pair<uint32_t, uint32_t> resolution,
@@ -114,4 +125,7 @@ namespace Utility {
 	void SetThreadName(std::thread* pthread, const char* threadName);
 	void SetThreadName(const char* threadName);
 #endif
+
+	/// CPU time consumed by the calling thread in nanoseconds.
+	uint64_t GetThreadCPUTime();
 } // namespace Utility
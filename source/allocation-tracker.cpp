@@ -0,0 +1,203 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "allocation-tracker.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "plugin.hpp"
+
+#define STAGE_COUNT ((size_t)Plugin::Allocation::Stage::Count)
+
+static std::atomic<uint64_t>                  g_Allocations[STAGE_COUNT];
+static std::atomic<uint64_t>                  g_Bytes[STAGE_COUNT];
+static std::atomic<uint64_t>                  g_AMFObjects[STAGE_COUNT];
+static thread_local Plugin::Allocation::Stage t_Stage = Plugin::Allocation::Stage::Unknown;
+
+Plugin::Allocation::StageScope::StageScope(Stage stage)
+{
+	m_Previous = t_Stage;
+	t_Stage    = stage;
+}
+
+Plugin::Allocation::StageScope::~StageScope()
+{
+	t_Stage = m_Previous;
+}
+
+bool Plugin::Allocation::IsEnabled()
+{
+#ifdef ENABLE_ALLOCATION_TRACKING
+	return true;
+#else
+	return false;
+#endif
+}
+
+const char* Plugin::Allocation::StageToString(Stage stage)
+{
+	switch (stage) {
+	case Stage::Unknown:
+		return "Unknown";
+	case Stage::Allocate:
+		return "Allocate";
+	case Stage::Store:
+		return "Store";
+	case Stage::Convert:
+		return "Convert";
+	case Stage::Lookahead:
+		return "Lookahead";
+	case Stage::Main:
+		return "Main";
+	case Stage::Load:
+		return "Load";
+	case Stage::AsyncSend:
+		return "AsyncSend";
+	case Stage::AsyncRetrieve:
+		return "AsyncRetrieve";
+	case Stage::Count:
+		break;
+	}
+	return "Invalid";
+}
+
+void Plugin::Allocation::Reset()
+{
+	for (size_t idx = 0; idx < STAGE_COUNT; idx++) {
+		g_Allocations[idx] = 0;
+		g_Bytes[idx]       = 0;
+		g_AMFObjects[idx]  = 0;
+	}
+}
+
+Plugin::Allocation::Counters Plugin::Allocation::Get(Stage stage)
+{
+	size_t   idx = (size_t)stage;
+	Counters cnt;
+	cnt.allocations = g_Allocations[idx].load(std::memory_order_relaxed);
+	cnt.bytes       = g_Bytes[idx].load(std::memory_order_relaxed);
+	cnt.amfObjects  = g_AMFObjects[idx].load(std::memory_order_relaxed);
+	return cnt;
+}
+
+Plugin::Allocation::Counters Plugin::Allocation::GetEncodeTotal()
+{
+	Counters total = {0, 0, 0};
+	for (size_t idx = (size_t)Stage::Unknown + 1; idx < STAGE_COUNT; idx++) {
+		Counters cnt = Get((Stage)idx);
+		total.allocations += cnt.allocations;
+		total.bytes += cnt.bytes;
+		total.amfObjects += cnt.amfObjects;
+	}
+	return total;
+}
+
+Plugin::Allocation::Counters Plugin::Allocation::GetTotal()
+{
+	Counters total   = GetEncodeTotal();
+	Counters unknown = Get(Stage::Unknown);
+	total.allocations += unknown.allocations;
+	total.bytes += unknown.bytes;
+	total.amfObjects += unknown.amfObjects;
+	return total;
+}
+
+void Plugin::Allocation::CountAMFObject()
+{
+	g_AMFObjects[(size_t)t_Stage].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Plugin::Allocation::Log()
+{
+	if (!IsEnabled())
+		return;
+
+	PLOG_INFO("Allocations per Stage (all encoders):");
+	for (size_t idx = 0; idx < STAGE_COUNT; idx++) {
+		Counters cnt = Get((Stage)idx);
+		PLOG_INFO("  %-13s %12" PRIu64 " allocations %16" PRIu64 " bytes %12" PRIu64 " AMF objects",
+				  StageToString((Stage)idx), cnt.allocations, cnt.bytes, cnt.amfObjects);
+	}
+}
+
+#ifdef ENABLE_ALLOCATION_TRACKING
+static inline void* TrackedAllocate(size_t size) noexcept
+{
+	size_t idx = (size_t)t_Stage;
+	g_Allocations[idx].fetch_add(1, std::memory_order_relaxed);
+	g_Bytes[idx].fetch_add(size, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new(size_t size)
+{
+	void* ptr = TrackedAllocate(size);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	void* ptr = TrackedAllocate(size);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+#endif
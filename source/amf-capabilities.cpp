@@ -17,7 +17,17 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
  */
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 #include "amf-capabilities.hpp"
+#include "amf-context.hpp"
 #include "utility.hpp"
 
 using namespace Plugin;
@@ -25,9 +35,16 @@ using namespace Plugin::AMD;
 
 #pragma region Singleton
 
-static CapabilityManager* __instance;
-static std::mutex         __instance_mutex;
-void                      Plugin::AMD::CapabilityManager::Initialize()
+static CapabilityManager*    __instance;
+static std::mutex           __instance_mutex;
+static std::function<bool()> __precondition;
+
+// Workers that were still stuck in a driver call when their test timed out. They run code from the AMF runtime, so
+// they have to be gone before it is unloaded.
+static std::vector<std::thread> s_AbandonedProbes;
+static std::mutex               s_AbandonedProbesMutex;
+
+void Plugin::AMD::CapabilityManager::Initialize()
 {
 	const std::lock_guard<std::mutex> lock(__instance_mutex);
 	if (!__instance)
@@ -36,12 +53,32 @@ void                      Plugin::AMD::CapabilityManager::Initialize()
 
 CapabilityManager* Plugin::AMD::CapabilityManager::Instance()
 {
+	// Tests run on first use, concurrent callers wait for the same result.
 	const std::lock_guard<std::mutex> lock(__instance_mutex);
+	if (!__instance)
+		__instance = new CapabilityManager();
 	return __instance;
 }
 
+void Plugin::AMD::CapabilityManager::SetPrecondition(std::function<bool()> fn)
+{
+	const std::lock_guard<std::mutex> lock(__instance_mutex);
+	__precondition = fn;
+}
+
 void Plugin::AMD::CapabilityManager::Finalize()
 {
+	std::vector<std::thread> abandoned;
+	{
+		const std::lock_guard<std::mutex> lock(s_AbandonedProbesMutex);
+		abandoned.swap(s_AbandonedProbes);
+	}
+	if (abandoned.size() > 0) {
+		PLOG_WARNING("[Capability Manager] Waiting for %" PRIuPTR " timed out tests to return...", abandoned.size());
+		for (auto& thread : abandoned)
+			thread.join();
+	}
+
 	const std::lock_guard<std::mutex> lock(__instance_mutex);
 	if (__instance)
 		delete __instance;
@@ -49,59 +86,817 @@ void Plugin::AMD::CapabilityManager::Finalize()
 }
 #pragma endregion Singleton
 
+// Bump whenever the layout or meaning of the cache file changes.
+#define CAPABILITY_CACHE_VERSION 4
+#define CAPABILITY_CACHE_FILE "capabilities.json"
+#define CAPABILITY_CACHE_REFRESH_ENV "OBS_AMF_CAPABILITY_REFRESH"
+// Upper bound on concurrent encoder creations, drivers serialize most of the work anyway.
+#define CAPABILITY_PROBE_THREADS 4
+// Milliseconds a single probe may take before it is abandoned and treated as unsupported.
+#define CAPABILITY_PROBE_TIMEOUT 10000
+
 Plugin::AMD::CapabilityManager::CapabilityManager()
 {
-	// Potential fix for unintended crashes by AMD including asserts in release builds.
-	AMD::AMF::Instance()->EnableDebugTrace(false);
+	// Without a usable runtime nothing is supported, which the UI and encoders already handle.
+	try {
+		// Potential fix for unintended crashes by AMD including asserts in release builds.
+		AMD::AMF::Instance()->EnableDebugTrace(false);
+	} catch (const std::exception& e) {
+		PLOG_ERROR("[Capability Manager] AMF is not available, reason: %s", e.what());
+#ifdef LITE_OBS
+		e;
+#endif
+		return;
+	}
+	if (__precondition && !__precondition()) {
+		PLOG_ERROR("[Capability Manager] Refusing to test adapters, all encoders are disabled.");
+		return;
+	}
+
+	bool useCache = true;
+	if (std::getenv(CAPABILITY_CACHE_REFRESH_ENV) != nullptr) {
+		PLOG_INFO("[Capability Manager] Refresh requested through environment, ignoring cache.");
+		useCache = false;
+	}
+	Probe(useCache);
+}
+
+Plugin::AMD::CapabilityManager::~CapabilityManager() {}
+
+void Plugin::AMD::CapabilityManager::Refresh()
+{
+	Probe(false);
+}
+
+#ifndef LITE_OBS
+template<typename T, typename F>
+static void CaptureCaps(T& out, F fn)
+{
+	try {
+		out = fn();
+	} catch (...) {
+		// Not reported by this driver, leave it empty.
+	}
+}
+
+static std::shared_ptr<const CapabilitySnapshot> CaptureSnapshot(AMD::Encoder* enc)
+{
+	auto caps = std::make_shared<CapabilitySnapshot>();
+	CaptureCaps(caps->usage, [enc] { return enc->CapsUsage(); });
+	CaptureCaps(caps->qualityPreset, [enc] { return enc->CapsQualityPreset(); });
+	CaptureCaps(caps->resolution, [enc] { return enc->CapsResolution(); });
+	CaptureCaps(caps->profile, [enc] { return enc->CapsProfile(); });
+	CaptureCaps(caps->profileLevel, [enc] { return enc->CapsProfileLevel(); });
+	CaptureCaps(caps->codingType, [enc] { return enc->CapsCodingType(); });
+	CaptureCaps(caps->maximumReferenceFrames, [enc] { return enc->CapsMaximumReferenceFrames(); });
+	CaptureCaps(caps->maximumLongTermReferenceFrames, [enc] { return enc->CapsMaximumLongTermReferenceFrames(); });
+	CaptureCaps(caps->rateControlMethod, [enc] { return enc->CapsRateControlMethod(); });
+	CaptureCaps(caps->prePassMode, [enc] { return enc->CapsPrePassMode(); });
+	CaptureCaps(caps->targetBitrate, [enc] { return enc->CapsTargetBitrate(); });
+	CaptureCaps(caps->peakBitrate, [enc] { return enc->CapsPeakBitrate(); });
+	CaptureCaps(caps->iFrameQP, [enc] { return enc->CapsIFrameQP(); });
+	CaptureCaps(caps->pFrameQP, [enc] { return enc->CapsPFrameQP(); });
+	CaptureCaps(caps->vbvBufferSize, [enc] { return enc->CapsVBVBufferSize(); });
+
+	if (auto h264 = dynamic_cast<AMD::EncoderH264*>(enc)) {
+		CaptureCaps(caps->qpMinimum, [h264] { return h264->CapsQPMinimum(); });
+		CaptureCaps(caps->qpMaximum, [h264] { return h264->CapsQPMaximum(); });
+		CaptureCaps(caps->bFrameQP, [h264] { return h264->CapsBFrameQP(); });
+		CaptureCaps(caps->bFramePattern, [h264] { return h264->CapsBFramePattern(); });
+		CaptureCaps(caps->intraRefreshNumMBsPerSlot, [h264] { return h264->CapsIntraRefreshNumMBsPerSlot(); });
+	} else if (auto h265 = dynamic_cast<AMD::EncoderH265*>(enc)) {
+		CaptureCaps(caps->tier, [h265] { return h265->CapsTier(); });
+		CaptureCaps(caps->gopType, [h265] { return h265->CapsGOPType(); });
+		CaptureCaps(caps->iFrameQPMinimum, [h265] { return h265->CapsIFrameQPMinimum(); });
+		CaptureCaps(caps->iFrameQPMaximum, [h265] { return h265->CapsIFrameQPMaximum(); });
+		CaptureCaps(caps->pFrameQPMinimum, [h265] { return h265->CapsPFrameQPMinimum(); });
+		CaptureCaps(caps->pFrameQPMaximum, [h265] { return h265->CapsPFrameQPMaximum(); });
+		CaptureCaps(caps->inputQueueSize, [h265] { return h265->CapsInputQueueSize(); });
+	}
+	return caps;
+}
+#endif
+
+#ifndef LITE_OBS
+template<typename T, typename F>
+static void QueryList(amf::AMFComponent* component, const wchar_t* name, std::vector<T>& out, F convert)
+{
+	const amf::AMFPropertyInfo* var;
+	if ((component->GetPropertyInfo(name, &var) != AMF_OK) || (var->pEnumDescription == nullptr))
+		return;
+	for (const amf::AMFEnumDescriptionEntry* enm = var->pEnumDescription; enm->name != nullptr; enm++) {
+		out.push_back(convert(enm->value));
+	}
+}
+
+template<typename T>
+static void QueryRange(amf::AMFComponent* component, const wchar_t* name, std::pair<T, T>& out)
+{
+	const amf::AMFPropertyInfo* var;
+	if (component->GetPropertyInfo(name, &var) != AMF_OK)
+		return;
+	out = std::make_pair((T)var->minValue.int64Value, (T)var->maxValue.int64Value);
+}
+
+// Same answers as the Caps* functions of EncoderH264, read straight from the component.
+static void QueryComponentH264(amf::AMFComponent* c, CapabilitySnapshot& caps)
+{
+	QueryList(c, AMF_VIDEO_ENCODER_USAGE, caps.usage,
+			  [](int64_t v) { return Utility::UsageFromAMFH264((AMF_VIDEO_ENCODER_USAGE_ENUM)v); });
+	QueryList(c, AMF_VIDEO_ENCODER_QUALITY_PRESET, caps.qualityPreset, [](int64_t v) {
+		return Utility::QualityPresetFromAMFH264((AMF_VIDEO_ENCODER_QUALITY_PRESET_ENUM)v);
+	});
+	QueryList(c, AMF_VIDEO_ENCODER_PROFILE, caps.profile,
+			  [](int64_t v) { return Utility::ProfileFromAMFH264((AMF_VIDEO_ENCODER_PROFILE_ENUM)v); });
+	QueryList(c, AMF_VIDEO_ENCODER_PROFILE_LEVEL, caps.profileLevel, [](int64_t v) { return (ProfileLevel)v; });
+	QueryList(c, AMF_VIDEO_ENCODER_CABAC_ENABLE, caps.codingType,
+			  [](int64_t v) { return Utility::CodingTypeFromAMFH264((AMF_VIDEO_ENCODER_CODING_ENUM)v); });
+	QueryRange(c, AMF_VIDEO_ENCODER_MAX_NUM_REFRAMES, caps.maximumReferenceFrames);
+	QueryRange(c, AMF_VIDEO_ENCODER_MAX_LTR_FRAMES, caps.maximumLongTermReferenceFrames);
+	QueryList(c, AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD, caps.rateControlMethod, [](int64_t v) {
+		return Utility::RateControlMethodFromAMFH264((AMF_VIDEO_ENCODER_RATE_CONTROL_METHOD_ENUM)v);
+	});
+	QueryList(c, AMF_VIDEO_ENCODER_RATE_CONTROL_PREANALYSIS_ENABLE, caps.prePassMode, [](int64_t v) {
+		return Utility::PrePassModeFromAMFH264((AMF_VIDEO_ENCODER_PREENCODE_MODE_ENUM)v);
+	});
+	QueryRange(c, AMF_VIDEO_ENCODER_TARGET_BITRATE, caps.targetBitrate);
+	QueryRange(c, AMF_VIDEO_ENCODER_PEAK_BITRATE, caps.peakBitrate);
+	QueryRange(c, AMF_VIDEO_ENCODER_QP_I, caps.iFrameQP);
+	QueryRange(c, AMF_VIDEO_ENCODER_QP_P, caps.pFrameQP);
+	QueryRange(c, AMF_VIDEO_ENCODER_VBV_BUFFER_SIZE, caps.vbvBufferSize);
+	QueryRange(c, AMF_VIDEO_ENCODER_MIN_QP, caps.qpMinimum);
+	QueryRange(c, AMF_VIDEO_ENCODER_MAX_QP, caps.qpMaximum);
+	QueryRange(c, AMF_VIDEO_ENCODER_QP_B, caps.bFrameQP);
+	QueryRange(c, AMF_VIDEO_ENCODER_INTRA_REFRESH_NUM_MBS_PER_SLOT, caps.intraRefreshNumMBsPerSlot);
+
+	const amf::AMFPropertyInfo* var;
+	if (c->GetPropertyInfo(AMF_VIDEO_ENCODER_B_PIC_PATTERN, &var) == AMF_OK)
+		caps.bFramePattern = (uint8_t)var->maxValue.int64Value;
+}
+
+// Same answers as the Caps* functions of EncoderH265, read straight from the component.
+static void QueryComponentH265(amf::AMFComponent* c, CapabilitySnapshot& caps)
+{
+	QueryList(c, AMF_VIDEO_ENCODER_HEVC_USAGE, caps.usage,
+			  [](int64_t v) { return Utility::UsageFromAMFH265((AMF_VIDEO_ENCODER_HEVC_USAGE_ENUM)v); });
+	QueryList(c, AMF_VIDEO_ENCODER_HEVC_QUALITY_PRESET, caps.qualityPreset, [](int64_t v) {
+		return Utility::QualityPresetFromAMFH265((AMF_VIDEO_ENCODER_HEVC_QUALITY_PRESET_ENUM)v);
+	});
+	QueryList(c, AMF_VIDEO_ENCODER_HEVC_PROFILE, caps.profile,
+			  [](int64_t v) { return Utility::ProfileFromAMFH265((AMF_VIDEO_ENCODER_HEVC_PROFILE_ENUM)v); });
+	QueryList(c, AMF_VIDEO_ENCODER_HEVC_PROFILE_LEVEL, caps.profileLevel,
+			  [](int64_t v) { return (ProfileLevel)(v / 3); });
+	QueryList(c, AMF_VIDEO_ENCODER_CABAC_ENABLE, caps.codingType,
+			  [](int64_t v) { return Utility::CodingTypeFromAMFH265(v); });
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_MAX_NUM_REFRAMES, caps.maximumReferenceFrames);
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_MAX_LTR_FRAMES, caps.maximumLongTermReferenceFrames);
+	QueryList(c, AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD, caps.rateControlMethod, [](int64_t v) {
+		return Utility::RateControlMethodFromAMFH265((AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_METHOD_ENUM)v);
+	});
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_TARGET_BITRATE, caps.targetBitrate);
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_PEAK_BITRATE, caps.peakBitrate);
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_QP_I, caps.iFrameQP);
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_QP_P, caps.pFrameQP);
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_VBV_BUFFER_SIZE, caps.vbvBufferSize);
+	QueryList(c, AMF_VIDEO_ENCODER_HEVC_TIER, caps.tier,
+			  [](int64_t v) { return Utility::TierFromAMFH265((AMF_VIDEO_ENCODER_HEVC_TIER_ENUM)v); });
+	QueryList(c, L"GOPType", caps.gopType, [](int64_t v) { return Utility::GOPTypeFromAMFH265(v); });
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_MIN_QP_I, caps.iFrameQPMinimum);
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_MAX_QP_I, caps.iFrameQPMaximum);
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_MIN_QP_P, caps.pFrameQPMinimum);
+	QueryRange(c, AMF_VIDEO_ENCODER_HEVC_MAX_QP_P, caps.pFrameQPMaximum);
+	QueryRange(c, L"HevcInputQueueSize", caps.inputQueueSize);
+
+	// Older runtimes only have an on/off switch here.
+	const amf::AMFPropertyInfo* var;
+	if ((c->GetPropertyInfo(AMF_VIDEO_ENCODER_HEVC_RATE_CONTROL_PREANALYSIS_ENABLE, &var) == AMF_OK)
+		&& (var->type == amf::AMF_VARIANT_BOOL))
+		caps.prePassMode = {PrePassMode::Disabled, PrePassMode::Enabled};
+}
+#endif
+
+enum class ProbeResult {
+	Supported,
+	Unsupported,
+	Failed, // No definite answer, which may be a transient driver problem.
+};
+
+// Creates only the encoder component on the shared context of the adapter, no converter and no encoder state, and
+// asks it and its AMFCaps.
+static ProbeResult ProbeComponent(std::shared_ptr<API::IAPI> api, API::Adapter adapter, AMD::Codec codec,
+								  std::shared_ptr<const CapabilitySnapshot>& snapshot)
+{
+	try {
+		auto                 amf     = AMD::AMF::Instance();
+		auto                 context = AMD::SharedContext::Get(api, adapter);
+		amf::AMFComponentPtr component;
+		AMF_RESULT           res =
+			amf->GetFactory()->CreateComponent(context->GetContext(), Utility::CodecToAMF(codec), &component);
+		if ((res == AMF_NOT_SUPPORTED) || (res == AMF_CODEC_NOT_SUPPORTED) || (res == AMF_NO_DEVICE))
+			return ProbeResult::Unsupported;
+		if (res != AMF_OK)
+			return ProbeResult::Failed;
+
+		amf::AMFCapsPtr amfCaps;
+		if ((component->GetCaps(&amfCaps) != AMF_OK) || !amfCaps) {
+			component->Terminate();
+			return ProbeResult::Failed;
+		}
+		if (amfCaps->GetAccelerationType() == amf::AMF_ACCEL_NOT_SUPPORTED) {
+			component->Terminate();
+			return ProbeResult::Unsupported;
+		}
+
+#ifndef LITE_OBS
+		bool hevc = (codec == Codec::HEVC);
+
+		// The encoder sets this in its constructor and the reported ranges depend on it.
+		if (hevc) {
+			component->SetProperty(AMF_VIDEO_ENCODER_HEVC_USAGE, AMF_VIDEO_ENCODER_HEVC_USAGE_TRANSCONDING);
+		} else {
+			component->SetProperty(AMF_VIDEO_ENCODER_USAGE, AMF_VIDEO_ENCODER_USAGE_TRANSCONDING);
+		}
+
+		auto caps = std::make_shared<CapabilitySnapshot>();
+		if (hevc) {
+			QueryComponentH265(component, *caps);
+		} else {
+			QueryComponentH264(component, *caps);
+		}
+
+		const amf::AMFPropertyInfo* var;
+		if (component->GetPropertyInfo(hevc ? AMF_VIDEO_ENCODER_HEVC_FRAMESIZE : AMF_VIDEO_ENCODER_FRAMESIZE, &var)
+			== AMF_OK) {
+			caps->resolution =
+				std::make_pair(std::make_pair(var->minValue.sizeValue.width, var->maxValue.sizeValue.width),
+							   std::make_pair(var->minValue.sizeValue.height, var->maxValue.sizeValue.height));
+		} else {
+			amf::AMFIOCapsPtr input;
+			amf_int32         minWidth = 0, maxWidth = 0, minHeight = 0, maxHeight = 0;
+			if (amfCaps->GetInputCaps(&input) == AMF_OK) {
+				input->GetWidthRange(&minWidth, &maxWidth);
+				input->GetHeightRange(&minHeight, &maxHeight);
+			}
+			caps->resolution = std::make_pair(std::make_pair((uint32_t)minWidth, (uint32_t)maxWidth),
+											  std::make_pair((uint32_t)minHeight, (uint32_t)maxHeight));
+		}
+
+		// The property ranges are what the interface accepts, the caps what this adapter can actually do.
+		int64_t maxBitrate = 0, maxLevel = 0;
+		if ((amfCaps->GetProperty(hevc ? AMF_VIDEO_ENCODER_HEVC_CAP_MAX_BITRATE : AMF_VIDEO_ENCODER_CAP_MAX_BITRATE,
+								  &maxBitrate)
+			 == AMF_OK)
+			&& (maxBitrate > 0)) {
+			caps->targetBitrate.second = min(caps->targetBitrate.second, (uint64_t)maxBitrate);
+			caps->peakBitrate.second   = min(caps->peakBitrate.second, (uint64_t)maxBitrate);
+		}
+		if ((amfCaps->GetProperty(hevc ? AMF_VIDEO_ENCODER_HEVC_CAP_MAX_LEVEL : AMF_VIDEO_ENCODER_CAP_MAX_LEVEL,
+								  &maxLevel)
+			 == AMF_OK)
+			&& (maxLevel > 0)) {
+			if (hevc)
+				maxLevel /= 3;
+			caps->profileLevel.erase(std::remove_if(caps->profileLevel.begin(), caps->profileLevel.end(),
+													[maxLevel](ProfileLevel v) { return (int64_t)v > maxLevel; }),
+									 caps->profileLevel.end());
+		}
+		snapshot = caps;
+#else
+		snapshot = std::make_shared<const CapabilitySnapshot>();
+#endif
+
+		component->Terminate();
+		return ProbeResult::Supported;
+	} catch (const std::exception& e) {
+		PLOG_DEBUG("[Capability Manager] Querying %s Adapter '%s' for codec %s failed, reason: %s",
+				   api->GetName().c_str(), adapter.Name.c_str(), Utility::CodecToString(codec), e.what());
+#ifdef LITE_OBS
+		e;
+#endif
+	}
+	return ProbeResult::Failed;
+}
+
+// Fills in the capabilities of the encoder if it is supported there.
+static ProbeResult ProbeEncoder(std::shared_ptr<API::IAPI> api, API::Adapter adapter, AMD::Codec codec,
+								std::shared_ptr<const CapabilitySnapshot>& snapshot)
+{
+	ProbeResult result = ProbeComponent(api, adapter, codec, snapshot);
+	if (result != ProbeResult::Failed)
+		return result;
+
+	// Fall back to what this used to do, construct a full encoder and see if that throws.
+	try {
+		std::unique_ptr<AMD::Encoder> enc;
+
+		if (codec == Codec::AVC || codec == Codec::SVC) {
+			enc = std::make_unique<AMD::EncoderH264>(api, adapter, false, false, ColorFormat::NV12, ColorSpace::BT709,
+													 false, false, 0, codec);
+		} else if (codec == Codec::HEVC) {
+			enc = std::make_unique<AMD::EncoderH265>(api, adapter);
+		}
+
+		if (enc != nullptr) {
+#ifndef LITE_OBS
+			snapshot = CaptureSnapshot(enc.get());
+#else
+			snapshot = std::make_shared<const CapabilitySnapshot>();
+#endif
+			return ProbeResult::Supported;
+		}
+	} catch (const std::exception& e) {
+		PLOG_DEBUG("[Capability Manager] Testing %s Adapter '%s' with codec %s failed, reason: %s",
+				   api->GetName().c_str(), adapter.Name.c_str(), Utility::CodecToString(codec), e.what());
+#ifdef LITE_OBS
+		e;
+#endif
+	}
+	return ProbeResult::Failed;
+}
+
+// Shared between the loader and the probe workers. Workers hold a reference so that a worker stuck in a
+// driver call past its timeout can never touch freed memory once the loader has moved on.
+struct ProbeState {
+	struct Task {
+		enum class Status {
+			Pending,
+			Running,
+			Done,
+			TimedOut,
+		};
+
+		std::shared_ptr<API::IAPI>                api;
+		API::Adapter                              adapter;
+		AMD::Codec                                codec;
+		std::shared_ptr<const CapabilitySnapshot> snapshot;
+		ProbeResult                               result = ProbeResult::Failed;
+		Status                                    status = Status::Pending;
+		std::chrono::steady_clock::time_point     started;
+		std::chrono::nanoseconds                  duration = std::chrono::nanoseconds(0);
+		std::thread::id                           worker;
+	};
+
+	std::mutex              lock;
+	std::condition_variable cv;
+	std::vector<Task>       tasks;
+	size_t                  next     = 0;
+	size_t                  finished = 0;
+};
+
+static void ProbeWorker(std::shared_ptr<ProbeState> state)
+{
+	std::unique_lock<std::mutex> lock(state->lock);
+	while (state->next < state->tasks.size()) {
+		size_t idx = state->next++;
+		auto&  task = state->tasks[idx];
+		task.status  = ProbeState::Task::Status::Running;
+		task.started = std::chrono::steady_clock::now();
+		task.worker  = std::this_thread::get_id();
+		auto api     = task.api;
+		auto adapter = task.adapter;
+		auto codec   = task.codec;
+		lock.unlock();
+
+		std::shared_ptr<const CapabilitySnapshot> snapshot;
+		ProbeResult                               result = ProbeEncoder(api, adapter, codec, snapshot);
+
+		lock.lock();
+		// The loader may have given up on this probe already, in which case the result is dropped.
+		auto& done = state->tasks[idx];
+		if (done.status == ProbeState::Task::Status::Running) {
+			done.snapshot = snapshot;
+			done.result   = result;
+			done.status   = ProbeState::Task::Status::Done;
+			done.duration = std::chrono::steady_clock::now() - done.started;
+			state->finished++;
+			state->cv.notify_all();
+		}
+	}
+}
+
+void Plugin::AMD::CapabilityManager::Probe(bool useCache)
+{
+	CacheMap         cache;
+	CacheSnapshotMap cacheSnapshots;
+	bool             cached = useCache && LoadCache(cache, cacheSnapshots);
+
+	// Filled in on the side, readers keep seeing the previous results until they are swapped in below.
+	CapabilityMap                     capabilities;
+	SnapshotMap                       snapshots;
+	std::map<CapabilityKey, uint64_t> probeTimes;
+	std::set<CapabilityKey>           failed;
 
 	// Key order: API, Adapter, Codec
+	const AMD::Codec codecs[] = {Codec::AVC, Codec::SVC, Codec::HEVC};
+	std::vector<std::tuple<std::shared_ptr<API::IAPI>, API::Adapter, bool>> adapters;
+	auto                                                                    state = std::make_shared<ProbeState>();
 	for (auto api : API::EnumerateAPIs()) {
-		PLOG_DEBUG("[Capability Manager] Testing %s API...", api->GetName().c_str());
 		for (auto adapter : api->EnumerateAdapters()) {
-			std::pair<Codec, bool> test_codecs[] = {
-				std::make_pair(Codec::AVC, false),
-				std::make_pair(Codec::HEVC, false),
-			};
-
-			for (auto& codec : test_codecs) {
-				try {
-					std::unique_ptr<AMD::Encoder> enc;
-
-					if (codec.first == Codec::AVC || codec.first == Codec::SVC) {
-						enc = std::make_unique<AMD::EncoderH264>(api, adapter);
-					} else if (codec.first == Codec::HEVC) {
-						enc = std::make_unique<AMD::EncoderH265>(api, adapter);
-					}
-
-					if (enc != nullptr) {
-						codec.second = true;
-					}
-				} catch (const std::exception& e) {
-					PLOG_DEBUG("[Capability Manager] Testing %s Adapter '%s' with codec %s failed, reason: %s",
-							   api->GetName().c_str(), adapter.Name.c_str(), Utility::CodecToString(codec.first),
-							   e.what());
-#ifdef LITE_OBS
-					e;
-#endif
+			// Codecs the cache has no definite answer for on this hardware and driver are tested again.
+			bool fromCache = true;
+			for (auto codec : codecs) {
+				auto key   = std::make_tuple(api->GetType(), adapter, codec);
+				auto entry = cache.find(
+					std::make_tuple(api->GetType(), adapter.vendorId, adapter.deviceId, adapter.driverVersion, codec));
+				if (entry != cache.end()) {
+					capabilities[key] = entry->second;
+					if (entry->second)
+						snapshots[key] = cacheSnapshots[entry->first];
+					continue;
 				}
 
-				std::tuple<API::Type, API::Adapter, AMD::Codec> key =
-					std::make_tuple(api->GetType(), adapter, codec.first);
-				m_CapabilityMap[key] = codec.second;
+				ProbeState::Task task;
+				task.api     = api;
+				task.adapter = adapter;
+				task.codec   = codec;
+				state->tasks.push_back(task);
+				fromCache = false;
+			}
+			adapters.push_back(std::make_tuple(api, adapter, fromCache));
+		}
+	}
+
+	if (state->tasks.size() > 0) {
+		size_t workers =
+			clamp((size_t)std::thread::hardware_concurrency(), (size_t)1, (size_t)CAPABILITY_PROBE_THREADS);
+		workers = min(workers, state->tasks.size());
+		PLOG_DEBUG("[Capability Manager] Testing %" PRIuPTR " combinations on %" PRIuPTR " threads...",
+				   state->tasks.size(), workers);
+		std::vector<std::thread> threads;
+		for (size_t idx = 0; idx < workers; idx++)
+			threads.emplace_back(ProbeWorker, state);
+
+		std::set<std::thread::id>    stuck;
+		std::unique_lock<std::mutex> lock(state->lock);
+		while (state->finished < state->tasks.size()) {
+			state->cv.wait_for(lock, std::chrono::milliseconds(100));
+
+			auto now = std::chrono::steady_clock::now();
+			for (auto& task : state->tasks) {
+				if ((task.status != ProbeState::Task::Status::Running)
+					|| ((now - task.started) < std::chrono::milliseconds(CAPABILITY_PROBE_TIMEOUT)))
+					continue;
+
+				PLOG_WARNING("[Capability Manager] Testing %s Adapter '%s' with codec %s timed out after %d ms.",
+							 task.api->GetName().c_str(), task.adapter.Name.c_str(),
+							 Utility::CodecToString(task.codec), CAPABILITY_PROBE_TIMEOUT);
+				// The result stays Failed, unsupported for now but tested again next time.
+				task.status   = ProbeState::Task::Status::TimedOut;
+				task.duration = now - task.started;
+				state->finished++;
+				stuck.insert(task.worker);
+
+				// The stuck worker is abandoned, replace it so the remaining probes keep going.
+				if (state->next < state->tasks.size())
+					threads.emplace_back(ProbeWorker, state);
 			}
+		}
+
+		for (auto& task : state->tasks) {
+			auto key          = std::make_tuple(task.api->GetType(), task.adapter, task.codec);
+			capabilities[key] = (task.result == ProbeResult::Supported) && (task.snapshot != nullptr);
+			probeTimes[key]   = (uint64_t)task.duration.count();
+			if (capabilities[key])
+				snapshots[key] = task.snapshot;
+			if (task.result == ProbeResult::Failed)
+				failed.insert(key);
+		}
+		lock.unlock();
 
-			PLOG_INFO(
-				"[Capability Manager] Testing %s Adapter '%s':\n"
-				"  %s: %s\n"
-				"  %s: %s\n",
-				api->GetName().c_str(), adapter.Name.c_str(), Utility::CodecToString(test_codecs[0].first),
-				test_codecs[0].second ? "Supported" : "Not Supported", Utility::CodecToString(test_codecs[1].first),
-				test_codecs[1].second ? "Supported" : "Not Supported");
+		// Every other worker runs out of tasks and exits, the stuck ones are joined before AMF goes away.
+		for (auto& thread : threads) {
+			if (stuck.count(thread.get_id()) == 0) {
+				thread.join();
+				continue;
+			}
+			const std::lock_guard<std::mutex> abandonedLock(s_AbandonedProbesMutex);
+			s_AbandonedProbes.push_back(std::move(thread));
 		}
 	}
+
+	for (auto& entry : adapters) {
+		auto api       = std::get<0>(entry);
+		auto adapter   = std::get<1>(entry);
+		bool fromCache = std::get<2>(entry);
+		bool avc       = capabilities[std::make_tuple(api->GetType(), adapter, Codec::AVC)];
+		bool svc       = capabilities[std::make_tuple(api->GetType(), adapter, Codec::SVC)];
+		bool hevc      = capabilities[std::make_tuple(api->GetType(), adapter, Codec::HEVC)];
+
+		PLOG_INFO(
+			"[Capability Manager] Testing %s Adapter '%s'%s:\n"
+			"  %s: %s\n"
+			"  %s: %s\n"
+			"  %s: %s\n",
+			api->GetName().c_str(), adapter.Name.c_str(), fromCache ? " (cached)" : "",
+			Utility::CodecToString(Codec::AVC), avc ? "Supported" : "Not Supported",
+			Utility::CodecToString(Codec::SVC), svc ? "Supported" : "Not Supported",
+			Utility::CodecToString(Codec::HEVC), hevc ? "Supported" : "Not Supported");
+#ifdef LITE_OBS
+		avc, svc, hevc, fromCache;
+#endif
+	}
+
+	{
+		const std::lock_guard<std::mutex> lock(m_MapMutex);
+		m_CapabilityMap.swap(capabilities);
+		m_SnapshotMap.swap(snapshots);
+		m_ProbeTimeMap.swap(probeTimes);
+		m_FailedSet.swap(failed);
+	}
+
+	if (!cached || (state->tasks.size() > 0))
+		SaveCache();
 }
 
-Plugin::AMD::CapabilityManager::~CapabilityManager() {}
+#ifndef LITE_OBS
+// Returns the cache root if it exists and, if requested, matches the current plugin and runtime.
+static obs_data_t* OpenCache(bool validate = true)
+{
+	char* path = obs_module_config_path(CAPABILITY_CACHE_FILE);
+	if (!path)
+		return nullptr;
+	obs_data_t* root = obs_data_create_from_json_file(path);
+	bfree(path);
+	if (!root || !validate)
+		return root;
+
+	// Anything that can change the outcome of a test invalidates the whole cache.
+	QUICK_FORMAT_MESSAGE(pluginVersion, "%d.%d.%d", PLUGIN_VERSION_MAJOR, PLUGIN_VERSION_MINOR, PLUGIN_VERSION_PATCH);
+	bool valid = (obs_data_get_int(root, "version") == CAPABILITY_CACHE_VERSION)
+				 && (pluginVersion == obs_data_get_string(root, "plugin_version"))
+				 && ((uint64_t)obs_data_get_int(root, "runtime_version") == AMF::Instance()->GetRuntimeVersion());
+	if (!valid) {
+		obs_data_release(root);
+		return nullptr;
+	}
+	return root;
+}
+
+template<typename T>
+static void SaveList(obs_data_t* data, const char* name, const std::vector<T>& list)
+{
+	obs_data_array_t* array = obs_data_array_create();
+	for (auto value : list) {
+		obs_data_t* item = obs_data_create();
+		obs_data_set_int(item, "value", (long long)value);
+		obs_data_array_push_back(array, item);
+		obs_data_release(item);
+	}
+	obs_data_set_array(data, name, array);
+	obs_data_array_release(array);
+}
+
+template<typename T>
+static std::vector<T> LoadList(obs_data_t* data, const char* name)
+{
+	std::vector<T>    list;
+	obs_data_array_t* array = obs_data_get_array(data, name);
+	size_t            count = array ? obs_data_array_count(array) : 0;
+	for (size_t idx = 0; idx < count; idx++) {
+		obs_data_t* item = obs_data_array_item(array, idx);
+		list.push_back(static_cast<T>(obs_data_get_int(item, "value")));
+		obs_data_release(item);
+	}
+	obs_data_array_release(array);
+	return list;
+}
+
+template<typename T>
+static void SaveRange(obs_data_t* data, const char* name, const std::pair<T, T>& range)
+{
+	obs_data_t* item = obs_data_create();
+	obs_data_set_int(item, "min", (long long)range.first);
+	obs_data_set_int(item, "max", (long long)range.second);
+	obs_data_set_obj(data, name, item);
+	obs_data_release(item);
+}
+
+template<typename T>
+static std::pair<T, T> LoadRange(obs_data_t* data, const char* name)
+{
+	std::pair<T, T> range(0, 0);
+	obs_data_t*     item = obs_data_get_obj(data, name);
+	if (item) {
+		range.first  = static_cast<T>(obs_data_get_int(item, "min"));
+		range.second = static_cast<T>(obs_data_get_int(item, "max"));
+		obs_data_release(item);
+	}
+	return range;
+}
+
+static void SaveSnapshot(obs_data_t* data, const CapabilitySnapshot& caps)
+{
+	SaveList(data, "usage", caps.usage);
+	SaveList(data, "quality_preset", caps.qualityPreset);
+	SaveRange(data, "resolution_width", caps.resolution.first);
+	SaveRange(data, "resolution_height", caps.resolution.second);
+	SaveList(data, "profile", caps.profile);
+	SaveList(data, "profile_level", caps.profileLevel);
+	SaveList(data, "coding_type", caps.codingType);
+	SaveRange(data, "maximum_reference_frames", caps.maximumReferenceFrames);
+	SaveRange(data, "maximum_ltr_frames", caps.maximumLongTermReferenceFrames);
+	SaveList(data, "rate_control_method", caps.rateControlMethod);
+	SaveList(data, "prepass_mode", caps.prePassMode);
+	SaveRange(data, "target_bitrate", caps.targetBitrate);
+	SaveRange(data, "peak_bitrate", caps.peakBitrate);
+	SaveRange(data, "iframe_qp", caps.iFrameQP);
+	SaveRange(data, "pframe_qp", caps.pFrameQP);
+	SaveRange(data, "vbv_buffer_size", caps.vbvBufferSize);
+	SaveRange(data, "qp_minimum", caps.qpMinimum);
+	SaveRange(data, "qp_maximum", caps.qpMaximum);
+	SaveRange(data, "bframe_qp", caps.bFrameQP);
+	obs_data_set_int(data, "bframe_pattern", caps.bFramePattern);
+	SaveRange(data, "intra_refresh_mbs_per_slot", caps.intraRefreshNumMBsPerSlot);
+	SaveList(data, "tier", caps.tier);
+	SaveList(data, "gop_type", caps.gopType);
+	SaveRange(data, "iframe_qp_minimum", caps.iFrameQPMinimum);
+	SaveRange(data, "iframe_qp_maximum", caps.iFrameQPMaximum);
+	SaveRange(data, "pframe_qp_minimum", caps.pFrameQPMinimum);
+	SaveRange(data, "pframe_qp_maximum", caps.pFrameQPMaximum);
+	SaveRange(data, "input_queue_size", caps.inputQueueSize);
+}
+
+static std::shared_ptr<const CapabilitySnapshot> LoadSnapshot(obs_data_t* data)
+{
+	auto caps                            = std::make_shared<CapabilitySnapshot>();
+	caps->usage                          = LoadList<Usage>(data, "usage");
+	caps->qualityPreset                  = LoadList<QualityPreset>(data, "quality_preset");
+	caps->resolution.first               = LoadRange<uint32_t>(data, "resolution_width");
+	caps->resolution.second              = LoadRange<uint32_t>(data, "resolution_height");
+	caps->profile                        = LoadList<Profile>(data, "profile");
+	caps->profileLevel                   = LoadList<ProfileLevel>(data, "profile_level");
+	caps->codingType                     = LoadList<CodingType>(data, "coding_type");
+	caps->maximumReferenceFrames         = LoadRange<uint64_t>(data, "maximum_reference_frames");
+	caps->maximumLongTermReferenceFrames = LoadRange<uint32_t>(data, "maximum_ltr_frames");
+	caps->rateControlMethod              = LoadList<RateControlMethod>(data, "rate_control_method");
+	caps->prePassMode                    = LoadList<PrePassMode>(data, "prepass_mode");
+	caps->targetBitrate                  = LoadRange<uint64_t>(data, "target_bitrate");
+	caps->peakBitrate                    = LoadRange<uint64_t>(data, "peak_bitrate");
+	caps->iFrameQP                       = LoadRange<uint8_t>(data, "iframe_qp");
+	caps->pFrameQP                       = LoadRange<uint8_t>(data, "pframe_qp");
+	caps->vbvBufferSize                  = LoadRange<uint64_t>(data, "vbv_buffer_size");
+	caps->qpMinimum                      = LoadRange<uint8_t>(data, "qp_minimum");
+	caps->qpMaximum                      = LoadRange<uint8_t>(data, "qp_maximum");
+	caps->bFrameQP                       = LoadRange<uint8_t>(data, "bframe_qp");
+	caps->bFramePattern                  = (uint8_t)obs_data_get_int(data, "bframe_pattern");
+	caps->intraRefreshNumMBsPerSlot      = LoadRange<uint32_t>(data, "intra_refresh_mbs_per_slot");
+	caps->tier                           = LoadList<H265::Tier>(data, "tier");
+	caps->gopType                        = LoadList<H265::GOPType>(data, "gop_type");
+	caps->iFrameQPMinimum                = LoadRange<uint8_t>(data, "iframe_qp_minimum");
+	caps->iFrameQPMaximum                = LoadRange<uint8_t>(data, "iframe_qp_maximum");
+	caps->pFrameQPMinimum                = LoadRange<uint8_t>(data, "pframe_qp_minimum");
+	caps->pFrameQPMaximum                = LoadRange<uint8_t>(data, "pframe_qp_maximum");
+	caps->inputQueueSize                 = LoadRange<uint32_t>(data, "input_queue_size");
+	return caps;
+}
+#endif
+
+bool Plugin::AMD::CapabilityManager::IsCacheValid()
+{
+#ifndef LITE_OBS
+	obs_data_t* root = OpenCache();
+	if (!root)
+		return false;
+	obs_data_release(root);
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool Plugin::AMD::CapabilityManager::IsCodecKnownUnsupported(AMD::Codec codec)
+{
+#ifndef LITE_OBS
+	// The runtime version needs AMF loaded and this must stay cheap, so compare the file version of the runtime
+	// instead. It ships with the driver, a different driver may well support the codec.
+	obs_data_t* root = OpenCache(false);
+	if (!root)
+		return false;
+
+	QUICK_FORMAT_MESSAGE(pluginVersion, "%d.%d.%d", PLUGIN_VERSION_MAJOR, PLUGIN_VERSION_MINOR, PLUGIN_VERSION_PATCH);
+	uint64_t fileVersion = AMF::GetRuntimeFileVersion();
+	if ((obs_data_get_int(root, "version") != CAPABILITY_CACHE_VERSION)
+		|| (pluginVersion != obs_data_get_string(root, "plugin_version")) || (fileVersion == 0)
+		|| ((uint64_t)obs_data_get_int(root, "runtime_file_version") != fileVersion)) {
+		obs_data_release(root);
+		return false;
+	}
+
+	bool              known     = false;
+	bool              supported = false;
+	obs_data_array_t* entries   = obs_data_get_array(root, "entries");
+	size_t            count     = entries ? obs_data_array_count(entries) : 0;
+	for (size_t idx = 0; idx < count; idx++) {
+		obs_data_t* entry = obs_data_array_item(entries, idx);
+		if ((AMD::Codec)obs_data_get_int(entry, "codec") == codec) {
+			known = true;
+			supported |= obs_data_get_bool(entry, "supported");
+		}
+		obs_data_release(entry);
+	}
+	obs_data_array_release(entries);
+	obs_data_release(root);
+	return known && !supported;
+#else
+	codec;
+	return false;
+#endif
+}
+
+bool Plugin::AMD::CapabilityManager::LoadCache(CacheMap& cache, CacheSnapshotMap& snapshots)
+{
+#ifndef LITE_OBS
+	obs_data_t* root = OpenCache();
+	if (!root) {
+		PLOG_INFO("[Capability Manager] Cache is missing or outdated, testing all adapters.");
+		return false;
+	}
+
+	obs_data_array_t* entries = obs_data_get_array(root, "entries");
+	size_t            count   = entries ? obs_data_array_count(entries) : 0;
+	for (size_t idx = 0; idx < count; idx++) {
+		obs_data_t* entry = obs_data_array_item(entries, idx);
+		CacheKey    key((API::Type)obs_data_get_int(entry, "api"), (uint32_t)obs_data_get_int(entry, "vendor_id"),
+						(uint32_t)obs_data_get_int(entry, "device_id"),
+						(uint64_t)obs_data_get_int(entry, "driver_version"),
+						(AMD::Codec)obs_data_get_int(entry, "codec"));
+		cache[key] = obs_data_get_bool(entry, "supported");
+		if (cache[key]) {
+			obs_data_t* caps = obs_data_get_obj(entry, "caps");
+			if (caps) {
+				snapshots[key] = LoadSnapshot(caps);
+				obs_data_release(caps);
+			} else {
+				// A supported entry without capabilities is useless, test the adapter again.
+				cache.erase(key);
+			}
+		}
+		obs_data_release(entry);
+	}
+	obs_data_array_release(entries);
+	obs_data_release(root);
+	return true;
+#else
+	cache, snapshots;
+	return false;
+#endif
+}
+
+void Plugin::AMD::CapabilityManager::SaveCache()
+{
+#ifndef LITE_OBS
+	char* path = obs_module_config_path(CAPABILITY_CACHE_FILE);
+	if (!path)
+		return;
+	char* dir = obs_module_config_path("");
+	if (dir) {
+		os_mkdirs(dir);
+		bfree(dir);
+	}
+
+	QUICK_FORMAT_MESSAGE(pluginVersion, "%d.%d.%d", PLUGIN_VERSION_MAJOR, PLUGIN_VERSION_MINOR, PLUGIN_VERSION_PATCH);
+	obs_data_t* root = obs_data_create();
+	obs_data_set_int(root, "version", CAPABILITY_CACHE_VERSION);
+	obs_data_set_string(root, "plugin_version", pluginVersion.c_str());
+	obs_data_set_int(root, "runtime_version", (long long)AMF::Instance()->GetRuntimeVersion());
+	obs_data_set_int(root, "runtime_file_version", (long long)AMF::GetRuntimeFileVersion());
+
+	obs_data_array_t*            entries = obs_data_array_create();
+	std::unique_lock<std::mutex> lock(m_MapMutex);
+	for (auto& kv : m_CapabilityMap) {
+		// A failed test says nothing about the hardware, caching it would hide the encoder until the next refresh.
+		if (m_FailedSet.count(kv.first) > 0)
+			continue;
+
+		const API::Adapter& adapter = std::get<1>(kv.first);
+		obs_data_t*         entry   = obs_data_create();
+		obs_data_set_int(entry, "api", (long long)std::get<0>(kv.first));
+		obs_data_set_int(entry, "vendor_id", adapter.vendorId);
+		obs_data_set_int(entry, "device_id", adapter.deviceId);
+		obs_data_set_int(entry, "driver_version", (long long)adapter.driverVersion);
+		obs_data_set_string(entry, "name", adapter.Name.c_str());
+		obs_data_set_int(entry, "codec", (long long)std::get<2>(kv.first));
+		obs_data_set_bool(entry, "supported", kv.second);
+		auto snapshot = m_SnapshotMap.find(kv.first);
+		if (snapshot != m_SnapshotMap.end()) {
+			obs_data_t* caps = obs_data_create();
+			SaveSnapshot(caps, *snapshot->second);
+			obs_data_set_obj(entry, "caps", caps);
+			obs_data_release(caps);
+		}
+		obs_data_array_push_back(entries, entry);
+		obs_data_release(entry);
+	}
+	lock.unlock();
+	obs_data_set_array(root, "entries", entries);
+	obs_data_array_release(entries);
+
+	if (!obs_data_save_json_safe(root, path, "tmp", "bak"))
+		PLOG_WARNING("[Capability Manager] Unable to write cache to '%s'.", path);
+	obs_data_release(root);
+	bfree(path);
+#endif
+}
 
 bool Plugin::AMD::CapabilityManager::IsCodecSupported(AMD::Codec codec)
 {
@@ -124,5 +919,29 @@ bool Plugin::AMD::CapabilityManager::IsCodecSupportedByAPI(AMD::Codec codec, API
 
 bool Plugin::AMD::CapabilityManager::IsCodecSupportedByAPIAdapter(AMD::Codec codec, API::Type api, API::Adapter adapter)
 {
-	return m_CapabilityMap[std::make_tuple(api, adapter, codec)];
+	const std::lock_guard<std::mutex> lock(m_MapMutex);
+	auto                              entry = m_CapabilityMap.find(std::make_tuple(api, adapter, codec));
+	if (entry == m_CapabilityMap.end())
+		return false;
+	return entry->second;
+}
+
+std::shared_ptr<const CapabilitySnapshot> Plugin::AMD::CapabilityManager::GetSnapshot(AMD::Codec   codec,
+																						API::Type    api,
+																						API::Adapter adapter)
+{
+	const std::lock_guard<std::mutex> lock(m_MapMutex);
+	auto                              entry = m_SnapshotMap.find(std::make_tuple(api, adapter, codec));
+	if (entry == m_SnapshotMap.end())
+		return nullptr;
+	return entry->second;
+}
+
+uint64_t Plugin::AMD::CapabilityManager::GetProbeTime(AMD::Codec codec, API::Type api, API::Adapter adapter)
+{
+	const std::lock_guard<std::mutex> lock(m_MapMutex);
+	auto                              entry = m_ProbeTimeMap.find(std::make_tuple(api, adapter, codec));
+	if (entry == m_ProbeTimeMap.end())
+		return 0;
+	return entry->second;
 }
@@ -0,0 +1,178 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "amf-context.hpp"
+#include <map>
+#include <tuple>
+
+using namespace Plugin;
+using namespace Plugin::AMD;
+
+struct ContextSlot {
+	std::weak_ptr<SharedContext> context;
+	std::shared_ptr<std::mutex>  creation;
+};
+typedef std::tuple<API::Type, int32_t, int32_t> ContextKey;
+
+static std::mutex                        s_ContextMapMutex;
+static std::map<ContextKey, ContextSlot> s_ContextMap;
+
+std::shared_ptr<SharedContext> Plugin::AMD::SharedContext::Get(std::shared_ptr<API::IAPI> api, API::Adapter adapter)
+{
+	// AMF only works on Direct3D devices, anything else runs on the first adapter of the first API.
+	switch (api->GetType()) {
+	case API::Type::Direct3D11:
+	case API::Type::Direct3D9:
+		break;
+	default:
+		api     = API::GetAPI(0);
+		adapter = api->EnumerateAdapters()[0];
+		break;
+	}
+
+	ContextKey                  key = std::make_tuple(api->GetType(), adapter.idLow, adapter.idHigh);
+	std::shared_ptr<std::mutex> creation;
+	{
+		std::lock_guard<std::mutex> lock(s_ContextMapMutex);
+		auto&                       slot = s_ContextMap[key];
+		if (auto ctx = slot.context.lock())
+			return ctx;
+		if (!slot.creation)
+			slot.creation = std::make_shared<std::mutex>();
+		creation = slot.creation;
+	}
+
+	// Same as with the devices, only callers that want the same adapter wait for each other.
+	std::lock_guard<std::mutex> creationLock(*creation);
+	{
+		std::lock_guard<std::mutex> lock(s_ContextMapMutex);
+		if (auto ctx = s_ContextMap[key].context.lock())
+			return ctx;
+	}
+
+	std::shared_ptr<SharedContext> ctx(new SharedContext(api, adapter));
+	{
+		std::lock_guard<std::mutex> lock(s_ContextMapMutex);
+		s_ContextMap[key].context = ctx;
+	}
+	return ctx;
+}
+
+Plugin::AMD::SharedContext::SharedContext(std::shared_ptr<API::IAPI> api, API::Adapter adapter)
+{
+	m_API                = api;
+	m_APIAdapter         = adapter;
+	m_APIDevice          = m_API->CreateInstance(m_APIAdapter);
+	m_AMFMemoryType      = amf::AMF_MEMORY_UNKNOWN;
+	m_ComputeInitialized = false;
+
+	AMF*       amf = AMF::Instance();
+	AMF_RESULT res = amf->GetFactory()->CreateContext(&m_AMFContext);
+	if (res != AMF_OK) {
+		QUICK_FORMAT_MESSAGE(errMsg, "Creating a AMF Context failed, error %ls (code %d).",
+							 amf->GetTrace()->GetResultText(res), res);
+		throw std::exception(errMsg.c_str());
+	}
+
+	switch (m_API->GetType()) {
+	case API::Type::Direct3D9:
+		m_AMFMemoryType = amf::AMF_MEMORY_DX9;
+		res             = m_AMFContext->InitDX9(m_APIDevice->GetContext());
+		break;
+	case API::Type::Direct3D11:
+		m_AMFMemoryType = amf::AMF_MEMORY_DX11;
+		res             = m_AMFContext->InitDX11(m_APIDevice->GetContext());
+		break;
+	}
+	if (res != AMF_OK) {
+		m_AMFContext->Terminate();
+		QUICK_FORMAT_MESSAGE(errMsg, "Initializing %s API with Adapter '%s' failed, error %ls (code %d).",
+							 m_API->GetName().c_str(), m_APIAdapter.Name.c_str(), amf->GetTrace()->GetResultText(res),
+							 res);
+		throw std::exception(errMsg.c_str());
+	}
+
+	PLOG_DEBUG("Created shared context for %s Adapter '%s'.", m_API->GetName().c_str(), m_APIAdapter.Name.c_str());
+}
+
+Plugin::AMD::SharedContext::~SharedContext()
+{
+	m_AMFCompute = nullptr;
+	if (m_AMFContext) {
+		m_AMFContext->Terminate();
+		m_AMFContext = nullptr;
+	}
+	m_APIDevice = nullptr;
+
+	PLOG_DEBUG("Destroyed shared context for %s Adapter '%s'.", m_API->GetName().c_str(), m_APIAdapter.Name.c_str());
+}
+
+std::shared_ptr<API::IAPI> Plugin::AMD::SharedContext::GetAPI()
+{
+	return m_API;
+}
+
+API::Adapter Plugin::AMD::SharedContext::GetAdapter()
+{
+	return m_APIAdapter;
+}
+
+std::shared_ptr<API::Instance> Plugin::AMD::SharedContext::GetDevice()
+{
+	return m_APIDevice;
+}
+
+amf::AMFContextPtr Plugin::AMD::SharedContext::GetContext()
+{
+	return m_AMFContext;
+}
+
+amf::AMF_MEMORY_TYPE Plugin::AMD::SharedContext::GetMemoryType()
+{
+	return m_AMFMemoryType;
+}
+
+amf::AMFComputePtr Plugin::AMD::SharedContext::GetCompute()
+{
+	std::lock_guard<std::mutex> lock(m_ComputeMutex);
+	if (m_ComputeInitialized)
+		return m_AMFCompute;
+	m_ComputeInitialized = true;
+
+	AMF*       amf = AMF::Instance();
+	AMF_RESULT res = m_AMFContext->InitOpenCL();
+	if (res != AMF_OK) {
+		PLOG_WARNING("Initialising OpenCL on Adapter '%s' failed, error %ls (code %d)", m_APIAdapter.Name.c_str(),
+					 amf->GetTrace()->GetResultText(res), res);
+		return nullptr;
+	}
+
+	res = m_AMFContext->GetCompute(amf::AMF_MEMORY_OPENCL, &m_AMFCompute);
+	if (res != AMF_OK) {
+		m_AMFCompute = nullptr;
+		PLOG_WARNING("Retrieving Compute object on Adapter '%s' failed, error %ls (code %d)",
+					 m_APIAdapter.Name.c_str(), amf->GetTrace()->GetResultText(res), res);
+	}
+	return m_AMFCompute;
+}
+
+std::unique_lock<std::mutex> Plugin::AMD::SharedContext::LockCompute()
+{
+	return std::unique_lock<std::mutex>(m_ComputeMutex);
+}
@@ -19,10 +19,18 @@
 
 #include "amf-encoder-h264.hpp"
 #include <cinttypes>
+#include <string>
+#include "intra-refresh.hpp"
 #include "utility.hpp"
 
 #define PREFIX "[H264]<Id: %lld> "
 
+// SVC takes rate control parameters per temporal and quality layer, with the layers prefixed to the name.
+static std::wstring LayerProperty(uint8_t layer, const wchar_t* name)
+{
+	return L"TL" + std::to_wstring(layer) + L".QL0." + name;
+}
+
 using namespace Plugin;
 using namespace Plugin::AMD;
 using namespace Utility;
@@ -30,11 +38,17 @@ using namespace Utility;
 Plugin::AMD::EncoderH264::EncoderH264(std::shared_ptr<API::IAPI> videoAPI, const API::Adapter& videoAdapter,
 									  bool useOpenCLSubmission, bool useOpenCLConversion, ColorFormat colorFormat,
 									  ColorSpace colorSpace, bool fullRangeColor, bool useAsyncQueue,
-									  size_t asyncQueueSize)
-	: Encoder(Codec::AVC, videoAPI, videoAdapter, useOpenCLSubmission, useOpenCLConversion, colorFormat, colorSpace,
+									  size_t asyncQueueSize, Codec codec)
+	: Encoder(codec, videoAPI, videoAdapter, useOpenCLSubmission, useOpenCLConversion, colorFormat, colorSpace,
 			  fullRangeColor, useAsyncQueue, asyncQueueSize)
 {
 	AMFTRACECALL;
+	if ((codec != Codec::AVC) && (codec != Codec::SVC)) {
+		QUICK_FORMAT_MESSAGE(errMsg, PREFIX "Codec %s is not H264.", m_UniqueId, Utility::CodecToString(codec));
+		throw std::exception(errMsg.c_str());
+	}
+	m_TemporalLayers     = 1;
+	m_IntraRefreshPeriod = 0;
 	this->SetUsage(Usage::Transcoding);
 
 	if (m_AMF->GetRuntimeVersion() < AMF_MAKE_FULL_VERSION(1, 4, 0, 0)) {
@@ -1106,7 +1120,9 @@ void Plugin::AMD::EncoderH264::SetIDRPeriod(uint32_t v)
 {
 	AMFTRACECALL;
 
-	AMF_RESULT res = m_AMFEncoder->SetProperty(AMF_VIDEO_ENCODER_IDR_PERIOD, (int64_t)clamp(v, 1, 1000000));
+	// With Intra-Refresh or segments the encoder must not place any IDR-Frames past the first one.
+	uint32_t   period = ((m_IntraRefreshPeriod > 0) || (m_SegmentDuration > 0)) ? 1000000 : v;
+	AMF_RESULT res    = m_AMFEncoder->SetProperty(AMF_VIDEO_ENCODER_IDR_PERIOD, (int64_t)clamp(period, 1, 1000000));
 	if (res != AMF_OK) {
 		QUICK_FORMAT_MESSAGE(errMsg, PREFIX "<" __FUNCTION_NAME__ "> Failed to set to %ld, error %ls (code %d)",
 							 m_UniqueId, v, m_AMF->GetTrace()->GetResultText(res), res);
@@ -1119,6 +1135,10 @@ uint32_t Plugin::AMD::EncoderH264::GetIDRPeriod()
 {
 	AMFTRACECALL;
 
+	// The encoder only holds the placeholder from SetIDRPeriod.
+	if ((m_IntraRefreshPeriod > 0) || (m_SegmentDuration > 0))
+		return m_PeriodIDR;
+
 	int64_t e;
 
 	AMF_RESULT res = m_AMFEncoder->GetProperty(AMF_VIDEO_ENCODER_IDR_PERIOD, &e);
@@ -1131,6 +1151,17 @@ uint32_t Plugin::AMD::EncoderH264::GetIDRPeriod()
 	return m_PeriodIDR;
 }
 
+void Plugin::AMD::EncoderH264::SetSegmentDuration(uint32_t v)
+{
+	AMFTRACECALL;
+
+	// Segments place their own IDR-Frames, the period would add more in the middle of one.
+	bool changed = ((v > 0) != (m_SegmentDuration > 0));
+	Encoder::SetSegmentDuration(v);
+	if (changed && ((v > 0) || (m_PeriodIDR > 0)))
+		SetIDRPeriod(m_PeriodIDR);
+}
+
 void Plugin::AMD::EncoderH264::SetHeaderInsertionSpacing(uint32_t v)
 {
 	AMFTRACECALL;
@@ -1459,6 +1490,160 @@ uint32_t Plugin::AMD::EncoderH264::GetIntraRefreshNumOfStripes()
 	return (uint32_t)e;
 }
 
+void Plugin::AMD::EncoderH264::SetIntraRefreshPeriod(uint32_t ms)
+{
+	AMFTRACECALL;
+
+	IntraRefresh::Layout layout = {0, 0};
+	if (ms > 0) {
+		auto caps = CapsIntraRefreshNumMBsPerSlot();
+		if (caps.second == 0) {
+			QUICK_FORMAT_MESSAGE(errMsg, PREFIX "<" __FUNCTION_NAME__ "> Not supported by the encoder.", m_UniqueId);
+			throw std::exception(errMsg.c_str());
+		}
+		layout = IntraRefresh::Plan(m_Resolution.first, m_Resolution.second, m_FrameRate.first, m_FrameRate.second,
+									ms, caps.first, caps.second);
+		if (layout.mbsPerSlot == 0) {
+			QUICK_FORMAT_MESSAGE(errMsg, PREFIX "<" __FUNCTION_NAME__ "> Unable to refresh within %" PRIu32 " ms.",
+								 m_UniqueId, ms);
+			throw std::exception(errMsg.c_str());
+		}
+	} else if (m_IntraRefreshPeriod == 0) {
+		return;
+	}
+	// Half of a layout refreshes the picture in a pattern nobody asked for, so go back to the previous one on failure.
+	uint32_t mbsPerSlot = GetIntraRefreshNumMBsPerSlot();
+	SetIntraRefreshNumMBsPerSlot(layout.mbsPerSlot);
+	try {
+		SetIntraRefreshNumOfStripes(layout.stripes);
+	} catch (...) {
+		try {
+			SetIntraRefreshNumMBsPerSlot(mbsPerSlot);
+		} catch (...) {
+		}
+		throw;
+	}
+	m_IntraRefreshPeriod = ms;
+	if ((ms > 0) || (m_PeriodIDR > 0))
+		SetIDRPeriod(m_PeriodIDR);
+}
+
+uint32_t Plugin::AMD::EncoderH264::GetIntraRefreshPeriod()
+{
+	return m_IntraRefreshPeriod;
+}
+
+// Properties - Temporal Layers
+uint8_t Plugin::AMD::EncoderH264::CapsTemporalLayers()
+{
+	AMFTRACECALL;
+
+	if (m_Codec != Codec::SVC)
+		return 1;
+
+	const amf::AMFPropertyInfo* var;
+	AMF_RESULT                  res =
+		m_AMFEncoder->GetPropertyInfo(AMF_VIDEO_ENCODER_NUM_TEMPORAL_ENHANCMENT_LAYERS, &var);
+	if (res != AMF_OK) {
+		QUICK_FORMAT_MESSAGE(errMsg, PREFIX "<" __FUNCTION_NAME__ "> Querying capabilities failed, error %ls (code %d)",
+							 m_UniqueId, m_AMF->GetTrace()->GetResultText(res), res);
+		throw std::exception(errMsg.c_str());
+	}
+
+	int64_t layers = var->maxValue.int64Value + 1;
+	return (uint8_t)((layers > TemporalLayers::MAXIMUM) ? TemporalLayers::MAXIMUM : layers);
+}
+
+void Plugin::AMD::EncoderH264::SetTemporalLayers(uint8_t v)
+{
+	AMFTRACECALL;
+
+	if (v < 1)
+		v = 1;
+	if (m_Codec != Codec::SVC) {
+		if (v > 1) {
+			QUICK_FORMAT_MESSAGE(errMsg, PREFIX "<" __FUNCTION_NAME__ "> Temporal layers require %s.", m_UniqueId,
+								 Utility::CodecToString(Codec::SVC));
+			throw std::exception(errMsg.c_str());
+		}
+		return;
+	}
+
+	AMF_RESULT res = m_AMFEncoder->SetProperty(AMF_VIDEO_ENCODER_NUM_TEMPORAL_ENHANCMENT_LAYERS, (int64_t)(v - 1));
+	if (res != AMF_OK) {
+		QUICK_FORMAT_MESSAGE(errMsg, PREFIX "<" __FUNCTION_NAME__ "> Failed to set to %" PRIu8 ", error %ls (code %d)",
+							 m_UniqueId, v, m_AMF->GetTrace()->GetResultText(res), res);
+		throw std::exception(errMsg.c_str());
+	}
+	m_TemporalLayers = v;
+}
+
+uint8_t Plugin::AMD::EncoderH264::GetTemporalLayers()
+{
+	return m_TemporalLayers;
+}
+
+void Plugin::AMD::EncoderH264::SetTemporalLayerBitrate(uint8_t layer, uint64_t v)
+{
+	AMFTRACECALL;
+
+	AMF_RESULT res =
+		m_AMFEncoder->SetProperty(LayerProperty(layer, AMF_VIDEO_ENCODER_TARGET_BITRATE).c_str(), (int64_t)v);
+	if (res != AMF_OK) {
+		QUICK_FORMAT_MESSAGE(errMsg,
+							 PREFIX "<" __FUNCTION_NAME__ "> Failed to set layer %" PRIu8 " to %" PRIu64
+									", error %ls (code %d)",
+							 m_UniqueId, layer, v, m_AMF->GetTrace()->GetResultText(res), res);
+		throw std::exception(errMsg.c_str());
+	}
+}
+
+uint64_t Plugin::AMD::EncoderH264::GetTemporalLayerBitrate(uint8_t layer)
+{
+	AMFTRACECALL;
+
+	int64_t    e;
+	AMF_RESULT res = m_AMFEncoder->GetProperty(LayerProperty(layer, AMF_VIDEO_ENCODER_TARGET_BITRATE).c_str(), &e);
+	if (res != AMF_OK) {
+		QUICK_FORMAT_MESSAGE(errMsg,
+							 PREFIX "<" __FUNCTION_NAME__ "> Failed to retrieve value of layer %" PRIu8
+									", error %ls (code %d)",
+							 m_UniqueId, layer, m_AMF->GetTrace()->GetResultText(res), res);
+		throw std::exception(errMsg.c_str());
+	}
+	return (uint64_t)e;
+}
+
+void Plugin::AMD::EncoderH264::SetTemporalLayerQP(uint8_t layer, uint8_t v)
+{
+	AMFTRACECALL;
+
+	AMF_RESULT res = m_AMFEncoder->SetProperty(LayerProperty(layer, AMF_VIDEO_ENCODER_QP_P).c_str(), (int64_t)v);
+	if (res != AMF_OK) {
+		QUICK_FORMAT_MESSAGE(errMsg,
+							 PREFIX "<" __FUNCTION_NAME__ "> Failed to set layer %" PRIu8 " to %" PRIu8
+									", error %ls (code %d)",
+							 m_UniqueId, layer, v, m_AMF->GetTrace()->GetResultText(res), res);
+		throw std::exception(errMsg.c_str());
+	}
+}
+
+uint8_t Plugin::AMD::EncoderH264::GetTemporalLayerQP(uint8_t layer)
+{
+	AMFTRACECALL;
+
+	int64_t    e;
+	AMF_RESULT res = m_AMFEncoder->GetProperty(LayerProperty(layer, AMF_VIDEO_ENCODER_QP_P).c_str(), &e);
+	if (res != AMF_OK) {
+		QUICK_FORMAT_MESSAGE(errMsg,
+							 PREFIX "<" __FUNCTION_NAME__ "> Failed to retrieve value of layer %" PRIu8
+									", error %ls (code %d)",
+							 m_UniqueId, layer, m_AMF->GetTrace()->GetResultText(res), res);
+		throw std::exception(errMsg.c_str());
+	}
+	return (uint8_t)e;
+}
+
 // Internal
 void Plugin::AMD::EncoderH264::PacketPriorityAndKeyframe(amf::AMFDataPtr& pData, struct encoder_packet* packet)
 {
@@ -1478,6 +1663,14 @@ void Plugin::AMD::EncoderH264::PacketPriorityAndKeyframe(amf::AMFDataPtr& pData,
 		packet->priority = 0;
 		break;
 	}
+
+	// Enhancement layers can be dropped without hurting the layers below, so OBS should drop them first.
+	if ((m_TemporalLayers > 1) && (packet->priority == 2)) {
+		amf::AMFBufferPtr buffer = amf::AMFBufferPtr(pData);
+		uint8_t           layer =
+			TemporalLayers::Find(static_cast<const uint8_t*>(buffer->GetNative()), buffer->GetSize(), m_TemporalLayers);
+		packet->priority = TemporalLayers::Priority(layer, m_TemporalLayers);
+	}
 }
 
 AMF_RESULT Plugin::AMD::EncoderH264::GetExtraDataInternal(amf::AMFVariant* p)
@@ -1486,58 +1679,53 @@ AMF_RESULT Plugin::AMD::EncoderH264::GetExtraDataInternal(amf::AMFVariant* p)
 	return m_AMFEncoder->GetProperty(AMF_VIDEO_ENCODER_EXTRADATA, p);
 }
 
-std::string Plugin::AMD::EncoderH264::HandleTypeOverride(amf::AMFSurfacePtr& d, uint64_t index)
-{
-	AMF_VIDEO_ENCODER_PICTURE_TYPE_ENUM type = AMF_VIDEO_ENCODER_PICTURE_TYPE_NONE;
-
-	if ((m_PeriodBFrame > 0) && ((index % m_PeriodBFrame) == 0)) {
-		type = AMF_VIDEO_ENCODER_PICTURE_TYPE_B;
-	}
-	if ((m_PeriodPFrame > 0) && ((index % m_PeriodPFrame) == 0)) {
-		type = AMF_VIDEO_ENCODER_PICTURE_TYPE_P;
-	}
-	if ((m_PeriodIFrame > 0) && ((index % m_PeriodIFrame) == 0)) {
-		type = AMF_VIDEO_ENCODER_PICTURE_TYPE_I;
-	}
-	if ((type != AMF_VIDEO_ENCODER_PICTURE_TYPE_NONE) && (m_PeriodIDR > 0) && ((index % m_PeriodIDR) == 0)) {
-		type = AMF_VIDEO_ENCODER_PICTURE_TYPE_IDR;
+const char* Plugin::AMD::EncoderH264::HandleTypeOverride(amf::AMFSurfacePtr& d, uint64_t index)
+{
+	// Intra-Refresh keeps frame sizes flat, so only keyframes that were asked for (or a loss needs) are placed.
+	bool refresh = (m_IntraRefreshPeriod > 0);
+	m_GOPPlanner.Configure({(refresh || (m_SegmentDuration > 0)) ? 0 : m_PeriodIDR, refresh ? 0 : m_PeriodIFrame,
+							m_PeriodPFrame, m_PeriodBFrame, m_FrameSkipPeriod, m_FrameSkipKeepOnlyNth});
+	m_GOPPlanner.SetSegmentDuration(refresh ? 0 : m_SegmentDuration, m_FrameRate.first, m_FrameRate.second);
+	if (m_SceneCut && !refresh)
+		m_GOPPlanner.Request((m_SceneCutMode == SceneCutMode::IDRFrame) ? PictureType::IDR : PictureType::I);
+	if (TakeKeyframeRequest((int64_t)index) || NeedsLTRKeyframe())
+		m_GOPPlanner.Request(PictureType::IDR);
+
+	bool        keyframe = false;
+	PictureType type     = m_GOPPlanner.Next(index, keyframe);
+	if (keyframe)
+		m_SceneDetector.NotifyKeyframe();
+
+	// Long-Term References, a frame that is marked or recovers from a loss must not turn into a skipped one.
+	LTRManager::Action ltr = {-1, 0};
+	if (type != PictureType::Skip)
+		ltr = NextLTRAction(index, keyframe);
+	if (ltr.mark >= 0)
+		d->SetProperty(AMF_VIDEO_ENCODER_MARK_CURRENT_WITH_LTR_INDEX, (int64_t)ltr.mark);
+	if (ltr.reference != 0)
+		d->SetProperty(AMF_VIDEO_ENCODER_FORCE_LTR_REFERENCE_BITFIELD, ltr.reference);
+
+	if (m_StaticFrame && (type == PictureType::None) && (ltr.mark < 0) && (ltr.reference == 0)) {
+		type = PictureType::Skip;
+		m_StaticSkipRun++;
+	} else {
+		m_StaticSkipRun = 0;
 	}
-	if (m_FrameSkipPeriod > 0) {
-		bool shouldSkip = m_FrameSkipKeepOnlyNth ? (index % m_FrameSkipPeriod) != 0 : (index % m_FrameSkipPeriod) == 0;
+	if (type != PictureType::None)
+		d->SetProperty(AMF_VIDEO_ENCODER_FORCE_PICTURE_TYPE, static_cast<AMF_VIDEO_ENCODER_PICTURE_TYPE_ENUM>(type));
 
-		if (shouldSkip) {
-			if ((m_FrameSkipType <= AMF_VIDEO_ENCODER_PICTURE_TYPE_SKIP) || (type < m_FrameSkipType))
-				m_FrameSkipType = type;
-			type = AMF_VIDEO_ENCODER_PICTURE_TYPE_SKIP;
-		} else if (m_FrameSkipType != AMF_VIDEO_ENCODER_PICTURE_TYPE_NONE) {
-			type            = m_FrameSkipType; // Hopefully fixes the crash.
-			m_FrameSkipType = AMF_VIDEO_ENCODER_PICTURE_TYPE_NONE;
-		}
-	}
-	if (type != AMF_VIDEO_ENCODER_PICTURE_TYPE_NONE)
-		d->SetProperty(AMF_VIDEO_ENCODER_FORCE_PICTURE_TYPE, type);
+	return Utility::PictureTypeToString(type);
+}
 
-	switch (type) {
-	case AMF_VIDEO_ENCODER_PICTURE_TYPE_NONE:
-		return "Automatic";
-		break;
-	case AMF_VIDEO_ENCODER_PICTURE_TYPE_SKIP:
-		return "Skip";
-		break;
-	case AMF_VIDEO_ENCODER_PICTURE_TYPE_IDR:
-		return "IDR";
-		break;
-	case AMF_VIDEO_ENCODER_PICTURE_TYPE_I:
-		return "I";
-		break;
-	case AMF_VIDEO_ENCODER_PICTURE_TYPE_P:
-		return "P";
-		break;
-	case AMF_VIDEO_ENCODER_PICTURE_TYPE_B:
-		return "B";
-		break;
+void Plugin::AMD::EncoderH264::HandleQPOverride(amf::AMFDataPtr& d, int32_t offset)
+{
+	// Rate control properties set on a surface only apply to that frame. Runs per frame, so nothing may throw.
+	static const wchar_t* names[] = {AMF_VIDEO_ENCODER_QP_I, AMF_VIDEO_ENCODER_QP_P, AMF_VIDEO_ENCODER_QP_B};
+	for (const wchar_t* name : names) {
+		int64_t qp = 0;
+		if (m_AMFEncoder->GetProperty(name, &qp) == AMF_OK)
+			d->SetProperty(name, (int64_t)clamp(qp + offset, 0, 51));
 	}
-	return "Unknown";
 }
 
 void Plugin::AMD::EncoderH264::LogProperties()
@@ -1590,6 +1778,7 @@ void Plugin::AMD::EncoderH264::LogProperties()
 	} catch (...) {
 		PLOG_INFO(PREFIX "      B-Frame: N/A", m_UniqueId);
 	}
+	PLOG_INFO(PREFIX "      Lookahead: %" PRIu32 " Frames", m_UniqueId, GetLookaheadFrames());
 #pragma endregion QP
 #pragma region    Bitrate
     PLOG_INFO(PREFIX "    Bitrate:", m_UniqueId);
@@ -1603,6 +1792,7 @@ void Plugin::AMD::EncoderH264::LogProperties()
     PLOG_INFO(PREFIX "        Period: %" PRIu32 " Frames", m_UniqueId, GetFrameSkippingPeriod());
     PLOG_INFO(PREFIX "        Behaviour: %s", m_UniqueId,
               GetFrameSkippingBehaviour() ? "Keep every Nth frame" : "Skip every Nth frame");
+    PLOG_INFO(PREFIX "        Unchanged Frames: %" PRIu32 " in a row", m_UniqueId, GetStaticFrameSkipping());
     PLOG_INFO(PREFIX "      Variance Based Adaptive Quantization: %s", m_UniqueId,
               IsVarianceBasedAdaptiveQuantizationEnabled() ? "Enabled" : "Disabled");
     PLOG_INFO(PREFIX "      Enforce Hypothetical Reference Decoder: %s", m_UniqueId,
@@ -1613,6 +1803,7 @@ void Plugin::AMD::EncoderH264::LogProperties()
 	PLOG_INFO(PREFIX "      Buffer Size: %" PRIu64 " bits", m_UniqueId, GetVBVBufferSize());
 	PLOG_INFO(PREFIX "      Initial Fullness: %" PRIu64 " %%", m_UniqueId,
 			  (uint64_t)round(GetInitialVBVBufferFullness() * 100.0));
+	PLOG_INFO(PREFIX "      Decoder Buffer Model: %s", m_UniqueId, Utility::HRDModelModeToString(GetHRDModelMode()));
 #pragma endregion Video Buffering Verifier
 	PLOG_INFO(PREFIX "    Max. Access Unit Size: %" PRIu32, m_UniqueId, GetMaximumAccessUnitSize());
 #pragma endregion Rate Control
@@ -1624,6 +1815,11 @@ void Plugin::AMD::EncoderH264::LogProperties()
 	PLOG_INFO(PREFIX "      I: %" PRIu32 " Frames", m_UniqueId, GetIFramePeriod());
 	PLOG_INFO(PREFIX "      P: %" PRIu32 " Frames", m_UniqueId, GetPFramePeriod());
 	PLOG_INFO(PREFIX "      B: %" PRIu32 " Frames", m_UniqueId, GetBFramePeriod());
+	PLOG_INFO(PREFIX "    Scene Cuts: %s", m_UniqueId, Utility::SceneCutModeToString(GetSceneCutMode()));
+	PLOG_INFO(PREFIX "      Minimum Distance: %" PRIu32 " Frames", m_UniqueId, GetSceneCutMinimumDistance());
+	PLOG_INFO(PREFIX "    Segment Duration: %" PRIu32 " ms", m_UniqueId, GetSegmentDuration());
+	PLOG_INFO(PREFIX "    Long-Term References: every %" PRIu32 " Frames, acknowledged after %" PRIu32 " Frames",
+			  m_UniqueId, GetLongTermReferencePeriod(), GetLongTermReferenceAcknowledgeDelay());
 	PLOG_INFO(PREFIX "    Header Insertion Spacing: %" PRIu32, m_UniqueId, GetHeaderInsertionSpacing());
 	PLOG_INFO(PREFIX "    GOP Alignment: %s", m_UniqueId, IsGOPAlignmentEnabled() ? "Enabled" : "Disabled");
 	PLOG_INFO(PREFIX "    Deblocking Filter: %s", m_UniqueId, IsDeblockingFilterEnabled() ? "Enabled" : "Disabled");
@@ -1656,8 +1852,21 @@ void Plugin::AMD::EncoderH264::LogProperties()
 
 #pragma region Intra - Refresh
 	PLOG_INFO(PREFIX "  Intra-Refresh:", m_UniqueId);
+	PLOG_INFO(PREFIX "    Period: %" PRIu32 " ms", m_UniqueId, GetIntraRefreshPeriod());
 	PLOG_INFO(PREFIX "    Number of Macroblocks Per Slot: %" PRIu32, m_UniqueId, GetIntraRefreshNumMBsPerSlot());
 	PLOG_INFO(PREFIX "    Number of Stripes: %" PRIu32, m_UniqueId, GetIntraRefreshNumOfStripes());
 #pragma endregion Intra - Refresh
+
+#pragma region Temporal Layers
+	PLOG_INFO(PREFIX "  Temporal Layers: %" PRIu8, m_UniqueId, GetTemporalLayers());
+	for (uint8_t layer = 0; (GetTemporalLayers() > 1) && (layer < GetTemporalLayers()); layer++) {
+		if (GetRateControlMethod() == RateControlMethod::ConstantQP) {
+			PLOG_INFO(PREFIX "    Layer %" PRIu8 ": QP %" PRIu8, m_UniqueId, layer, GetTemporalLayerQP(layer));
+		} else {
+			PLOG_INFO(PREFIX "    Layer %" PRIu8 ": %" PRIu64 " bit/s", m_UniqueId, layer,
+					  GetTemporalLayerBitrate(layer));
+		}
+	}
+#pragma endregion Temporal Layers
 }
 #endif
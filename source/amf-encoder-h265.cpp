@@ -914,7 +914,9 @@ void Plugin::AMD::EncoderH265::SetIDRPeriod(uint32_t v)
 {
 	AMFTRACECALL;
 
-	AMF_RESULT res = m_AMFEncoder->SetProperty(AMF_VIDEO_ENCODER_HEVC_NUM_GOPS_PER_IDR, (int64_t)v);
+	// With segments only the first picture may be an IDR-Frame on the encoder's own, which is what 0 means here.
+	uint32_t   period = (m_SegmentDuration > 0) ? 0 : v;
+	AMF_RESULT res    = m_AMFEncoder->SetProperty(AMF_VIDEO_ENCODER_HEVC_NUM_GOPS_PER_IDR, (int64_t)period);
 	if (res != AMF_OK) {
 		QUICK_FORMAT_MESSAGE(errMsg, "<Id: %lld> <" __FUNCTION_NAME__ "> Failed to set to %ld, error %ls (code %d)",
 							 m_UniqueId, v, m_AMF->GetTrace()->GetResultText(res), res);
@@ -927,6 +929,10 @@ uint32_t Plugin::AMD::EncoderH265::GetIDRPeriod()
 {
 	AMFTRACECALL;
 
+	// The encoder only holds the placeholder from SetIDRPeriod.
+	if (m_SegmentDuration > 0)
+		return m_PeriodIDR;
+
 	int64_t    e;
 	AMF_RESULT res = m_AMFEncoder->GetProperty(AMF_VIDEO_ENCODER_HEVC_NUM_GOPS_PER_IDR, &e);
 	if (res != AMF_OK) {
@@ -938,6 +944,17 @@ uint32_t Plugin::AMD::EncoderH265::GetIDRPeriod()
 	return (uint32_t)e;
 }
 
+void Plugin::AMD::EncoderH265::SetSegmentDuration(uint32_t v)
+{
+	AMFTRACECALL;
+
+	// Segments place their own IDR-Frames, the period would add more in the middle of one.
+	bool changed = ((v > 0) != (m_SegmentDuration > 0));
+	Encoder::SetSegmentDuration(v);
+	if (changed && ((v > 0) || (m_PeriodIDR > 0)))
+		SetIDRPeriod(m_PeriodIDR);
+}
+
 void Plugin::AMD::EncoderH265::SetHeaderInsertionMode(H265::HeaderInsertionMode v)
 {
 	AMFTRACECALL;
@@ -1567,56 +1584,52 @@ AMF_RESULT Plugin::AMD::EncoderH265::GetExtraDataInternal(amf::AMFVariant* p)
 	return m_AMFEncoder->GetProperty(AMF_VIDEO_ENCODER_HEVC_EXTRADATA, p);
 }
 
-std::string Plugin::AMD::EncoderH265::HandleTypeOverride(amf::AMFSurfacePtr& d, uint64_t index)
-{
-	AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_ENUM type = AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_NONE;
-
-	if ((m_PeriodPFrame > 0) && ((index % m_PeriodPFrame) == 0)) {
-		type = AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_P;
-	}
-	if ((m_PeriodIFrame > 0) && ((index % m_PeriodIFrame) == 0)) {
-		type = AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_I;
-	}
-	uint64_t realIPeriod = m_PeriodIDR * GetGOPSize();
-	if ((type != AMF_VIDEO_ENCODER_PICTURE_TYPE_NONE) && (realIPeriod > 0) && ((index % realIPeriod) == 0)) {
-		type = AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_IDR;
+const char* Plugin::AMD::EncoderH265::HandleTypeOverride(amf::AMFSurfacePtr& d, uint64_t index)
+{
+	uint64_t periodIDR = (m_SegmentDuration > 0) ? 0 : (uint64_t)m_PeriodIDR * GetGOPSize();
+	m_GOPPlanner.Configure({periodIDR, m_PeriodIFrame, m_PeriodPFrame, 0, m_FrameSkipPeriod, m_FrameSkipKeepOnlyNth});
+	m_GOPPlanner.SetSegmentDuration(m_SegmentDuration, m_FrameRate.first, m_FrameRate.second);
+	if (m_SceneCut)
+		m_GOPPlanner.Request((m_SceneCutMode == SceneCutMode::IDRFrame) ? PictureType::IDR : PictureType::I);
+	if (TakeKeyframeRequest((int64_t)index) || NeedsLTRKeyframe())
+		m_GOPPlanner.Request(PictureType::IDR);
+
+	bool        keyframe = false;
+	PictureType type     = m_GOPPlanner.Next(index, keyframe);
+	if (keyframe)
+		m_SceneDetector.NotifyKeyframe();
+
+	// Long-Term References, a frame that is marked or recovers from a loss must not turn into a skipped one.
+	LTRManager::Action ltr = {-1, 0};
+	if (type != PictureType::Skip)
+		ltr = NextLTRAction(index, keyframe);
+	if (ltr.mark >= 0)
+		d->SetProperty(AMF_VIDEO_ENCODER_HEVC_MARK_CURRENT_WITH_LTR_INDEX, (int64_t)ltr.mark);
+	if (ltr.reference != 0)
+		d->SetProperty(AMF_VIDEO_ENCODER_HEVC_FORCE_LTR_REFERENCE_BITFIELD, ltr.reference);
+
+	if (m_StaticFrame && (type == PictureType::None) && (ltr.mark < 0) && (ltr.reference == 0)) {
+		type = PictureType::Skip;
+		m_StaticSkipRun++;
+	} else {
+		m_StaticSkipRun = 0;
 	}
-	if (m_FrameSkipPeriod > 0) {
-		bool shouldSkip = m_FrameSkipKeepOnlyNth ? (index % m_FrameSkipPeriod) != 0 : (index % m_FrameSkipPeriod) == 0;
+	if (type != PictureType::None)
+		d->SetProperty(AMF_VIDEO_ENCODER_HEVC_FORCE_PICTURE_TYPE,
+					   static_cast<AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_ENUM>(type));
 
-		if (shouldSkip) {
-			if ((m_FrameSkipType <= AMF_VIDEO_ENCODER_PICTURE_TYPE_SKIP) || (type < m_FrameSkipType))
-				m_FrameSkipType = type;
-			type = AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_SKIP;
-		} else if (m_FrameSkipType != AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_NONE) {
-			type            = m_FrameSkipType; // Hopefully fixes the crash.
-			m_FrameSkipType = AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_NONE;
-		}
-	}
-	if (type != AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_NONE)
-		d->SetProperty(AMF_VIDEO_ENCODER_FORCE_PICTURE_TYPE, type);
+	return Utility::PictureTypeToString(type);
+}
 
-	switch (type) {
-	case AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_NONE:
-		return "Automatic";
-		break;
-	case AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_SKIP:
-		return "Skip";
-		break;
-	case AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_IDR:
-		return "IDR";
-		break;
-	case AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_I:
-		return "I";
-		break;
-	case AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_P:
-		return "P";
-		break;
-		//case AMF_VIDEO_ENCODER_HEVC_PICTURE_TYPE_B:
-		//	return "B";
-		//	break;
+void Plugin::AMD::EncoderH265::HandleQPOverride(amf::AMFDataPtr& d, int32_t offset)
+{
+	// Rate control properties set on a surface only apply to that frame. Runs per frame, so nothing may throw.
+	static const wchar_t* names[] = {AMF_VIDEO_ENCODER_HEVC_QP_I, AMF_VIDEO_ENCODER_HEVC_QP_P};
+	for (const wchar_t* name : names) {
+		int64_t qp = 0;
+		if (m_AMFEncoder->GetProperty(name, &qp) == AMF_OK)
+			d->SetProperty(name, (int64_t)clamp(qp + offset, 0, 51));
 	}
-	return "Unknown";
 }
 
 void Plugin::AMD::EncoderH265::LogProperties()
@@ -1668,6 +1681,7 @@ void Plugin::AMD::EncoderH265::LogProperties()
 	PLOG_INFO(PREFIX "      Fixed:", m_UniqueId);
 	PLOG_INFO(PREFIX "        I-Frame: %" PRIu8, m_UniqueId, GetIFrameQP());
 	PLOG_INFO(PREFIX "        P-Frame: %" PRIu8, m_UniqueId, GetPFrameQP());
+	PLOG_INFO(PREFIX "      Lookahead: %" PRIu32 " Frames", m_UniqueId, GetLookaheadFrames());
 #pragma endregion QP
 #pragma region    Bitrate
     PLOG_INFO(PREFIX "    Bitrate:", m_UniqueId);
@@ -1681,6 +1695,7 @@ void Plugin::AMD::EncoderH265::LogProperties()
     PLOG_INFO(PREFIX "        Period: %" PRIu32 " Frames", m_UniqueId, GetFrameSkippingPeriod());
     PLOG_INFO(PREFIX "        Behaviour: %s", m_UniqueId,
               GetFrameSkippingBehaviour() ? "Keep every Nth frame" : "Skip every Nth frame");
+    PLOG_INFO(PREFIX "        Unchanged Frames: %" PRIu32 " in a row", m_UniqueId, GetStaticFrameSkipping());
     PLOG_INFO(PREFIX "      Variance Based Adaptive Quantization: %s", m_UniqueId,
               IsVarianceBasedAdaptiveQuantizationEnabled() ? "Enabled" : "Disabled");
     PLOG_INFO(PREFIX "      Enforce Hypothetical Reference Decoder: %s", m_UniqueId,
@@ -1691,6 +1706,7 @@ void Plugin::AMD::EncoderH265::LogProperties()
 	PLOG_INFO(PREFIX "      Buffer Size: %" PRIu64 " bits", m_UniqueId, GetVBVBufferSize());
 	PLOG_INFO(PREFIX "      Initial Fullness: %" PRIu64 " %%", m_UniqueId,
 			  (uint64_t)round(GetInitialVBVBufferFullness() * 100.0));
+	PLOG_INFO(PREFIX "      Decoder Buffer Model: %s", m_UniqueId, Utility::HRDModelModeToString(GetHRDModelMode()));
 #pragma endregion Video Buffering Verifier
 	PLOG_INFO(PREFIX "    Max. Access Unit Size: %" PRIu32, m_UniqueId, GetMaximumAccessUnitSize());
 #pragma endregion Rate Control
@@ -1702,6 +1718,11 @@ void Plugin::AMD::EncoderH265::LogProperties()
 	PLOG_INFO(PREFIX "      I: %" PRIu32 " Frames", m_UniqueId, GetIFramePeriod());
 	PLOG_INFO(PREFIX "      P: %" PRIu32 " Frames", m_UniqueId, GetPFramePeriod());
 	PLOG_INFO(PREFIX "      B: %" PRIu32 " Frames", m_UniqueId, GetBFramePeriod());
+	PLOG_INFO(PREFIX "    Scene Cuts: %s", m_UniqueId, Utility::SceneCutModeToString(GetSceneCutMode()));
+	PLOG_INFO(PREFIX "      Minimum Distance: %" PRIu32 " Frames", m_UniqueId, GetSceneCutMinimumDistance());
+	PLOG_INFO(PREFIX "    Segment Duration: %" PRIu32 " ms", m_UniqueId, GetSegmentDuration());
+	PLOG_INFO(PREFIX "    Long-Term References: every %" PRIu32 " Frames, acknowledged after %" PRIu32 " Frames",
+			  m_UniqueId, GetLongTermReferencePeriod(), GetLongTermReferenceAcknowledgeDelay());
 	PLOG_INFO(PREFIX "    GOP:", m_UniqueId);
 	PLOG_INFO(PREFIX "      Type: %s", m_UniqueId, Utility::GOPTypeToString(GetGOPType()));
 	PLOG_INFO(PREFIX "      Size: %" PRIu32, m_UniqueId, GetGOPSize());
@@ -0,0 +1,197 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "amf-encoder-pool.hpp"
+#include <cstdlib>
+#include <cstring>
+#include "amf-encoder-h264.hpp"
+#include "amf-encoder-h265.hpp"
+#include "utility.hpp"
+
+#define ENCODER_POOL_ENV "OBS_AMF_ENCODER_POOL"
+
+using namespace Plugin;
+using namespace Plugin::AMD;
+
+std::unique_ptr<Encoder> Plugin::AMD::EncoderParameters::Create() const
+{
+	if (codec == Codec::HEVC) {
+		return std::make_unique<EncoderH265>(api, adapter, openCLSubmission, openCLConversion, colorFormat,
+											 colorSpace, fullRangeColor, multiThreading, queueSize);
+	} else {
+		return std::make_unique<EncoderH264>(api, adapter, openCLSubmission, openCLConversion, colorFormat,
+											 colorSpace, fullRangeColor, multiThreading, queueSize, codec);
+	}
+}
+
+bool Plugin::AMD::operator==(const EncoderParameters& left, const EncoderParameters& right)
+{
+	return (left.codec == right.codec) && (left.api == right.api) && (left.adapter == right.adapter)
+		   && (left.openCLSubmission == right.openCLSubmission) && (left.openCLConversion == right.openCLConversion)
+		   && (left.colorFormat == right.colorFormat) && (left.colorSpace == right.colorSpace)
+		   && (left.fullRangeColor == right.fullRangeColor) && (left.multiThreading == right.multiThreading)
+		   && (left.queueSize == right.queueSize);
+}
+
+bool Plugin::AMD::operator!=(const EncoderParameters& left, const EncoderParameters& right)
+{
+	return !(left == right);
+}
+
+#pragma region Singleton
+
+static EncoderPool* __instance;
+static std::mutex   __instance_mutex;
+
+EncoderPool* Plugin::AMD::EncoderPool::Instance()
+{
+	const std::lock_guard<std::mutex> lock(__instance_mutex);
+	if (!__instance)
+		__instance = new EncoderPool();
+	return __instance;
+}
+
+void Plugin::AMD::EncoderPool::Finalize()
+{
+	const std::lock_guard<std::mutex> lock(__instance_mutex);
+	if (__instance)
+		delete __instance;
+	__instance = nullptr;
+}
+
+bool Plugin::AMD::EncoderPool::IsEnabled()
+{
+	const char* env = std::getenv(ENCODER_POOL_ENV);
+	return (env != nullptr) && (strcmp(env, "") != 0) && (strcmp(env, "0") != 0);
+}
+
+#pragma endregion Singleton
+
+Plugin::AMD::EncoderPool::EncoderPool()
+{
+	m_Shutdown = false;
+	m_Worker   = std::thread(&EncoderPool::WorkerMain, this);
+	Utility::SetThreadName(&m_Worker, "AMF Encoder Pool");
+}
+
+Plugin::AMD::EncoderPool::~EncoderPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Shutdown = true;
+		m_CondVar.notify_all();
+	}
+	if (m_Worker.joinable())
+		m_Worker.join();
+
+	// Prepared encoders have to go before AMF and the APIs do.
+	m_Slots.clear();
+}
+
+std::unique_ptr<Encoder> Plugin::AMD::EncoderPool::Acquire(const EncoderParameters& params, bool* pooled)
+{
+	std::unique_ptr<Encoder> encoder, stale;
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		Slot&                        slot = m_Slots[MakeKey(params)];
+		if (slot.params == params) {
+			// Already half way there, waiting is faster than starting over.
+			m_CondVar.wait(lock, [&slot, this]() { return m_Shutdown || (slot.state != SlotState::Creating); });
+			if (slot.state == SlotState::Ready)
+				encoder = std::move(slot.encoder);
+		}
+
+		stale       = std::move(slot.encoder);
+		slot.params = params;
+		slot.state  = SlotState::Requested;
+		m_CondVar.notify_all();
+	}
+
+	if (pooled)
+		*pooled = !!encoder;
+	if (!encoder)
+		encoder = params.Create();
+	return encoder;
+}
+
+void Plugin::AMD::EncoderPool::Prepare(const EncoderParameters& params)
+{
+	std::unique_ptr<Encoder> stale;
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		Slot&                        slot = m_Slots[MakeKey(params)];
+		if ((slot.params == params) && (slot.state != SlotState::Empty) && (slot.state != SlotState::Failed))
+			return;
+
+		stale       = std::move(slot.encoder);
+		slot.params = params;
+		slot.state  = SlotState::Requested;
+		m_CondVar.notify_all();
+	}
+}
+
+Plugin::AMD::EncoderPool::SlotKey Plugin::AMD::EncoderPool::MakeKey(const EncoderParameters& params)
+{
+	return std::make_tuple(params.api->GetType(), params.adapter, params.codec);
+}
+
+void Plugin::AMD::EncoderPool::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (!m_Shutdown) {
+		auto slot = m_Slots.begin();
+		for (; slot != m_Slots.end(); slot++) {
+			if (slot->second.state == SlotState::Requested)
+				break;
+		}
+		if (slot == m_Slots.end()) {
+			m_CondVar.wait(lock);
+			continue;
+		}
+
+		EncoderParameters params = slot->second.params;
+		slot->second.state       = SlotState::Creating;
+		lock.unlock();
+
+		std::unique_ptr<Encoder> encoder;
+		try {
+			encoder = params.Create();
+		} catch (const std::exception& ex) {
+			PLOG_WARNING("Unable to prepare %s encoder on adapter '%s': %s", Utility::CodecToString(params.codec),
+						 params.adapter.Name.c_str(), ex.what());
+		} catch (...) {
+			PLOG_WARNING("Unable to prepare %s encoder on adapter '%s'.", Utility::CodecToString(params.codec),
+						 params.adapter.Name.c_str());
+		}
+
+		lock.lock();
+		// Somebody may have asked for different parameters in the meantime, then this one is of no use.
+		if ((slot->second.state == SlotState::Creating) && (slot->second.params == params)) {
+			slot->second.state   = encoder ? SlotState::Ready : SlotState::Failed;
+			slot->second.encoder = std::move(encoder);
+		}
+		m_CondVar.notify_all();
+
+		if (encoder) {
+			lock.unlock();
+			encoder = nullptr;
+			lock.lock();
+		}
+	}
+}
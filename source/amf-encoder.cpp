@@ -19,7 +19,10 @@
 
 #include "amf-encoder.hpp"
 #include <cinttypes>
+#include <cstdint>
 #include <thread>
+#include "allocation-tracker.hpp"
+#include "clock.hpp"
 #include "utility.hpp"
 
 #include <components/VideoConverter.h>
@@ -34,6 +37,7 @@ Plugin::AMD::Encoder::Encoder(Codec codec, std::shared_ptr<API::IAPI> videoAPI,
 							  ColorSpace colorSpace, bool fullRangeColor, bool multiThreading, size_t queueSize)
 {
 	m_UniqueId = Utility::GetUniqueIdentifier();
+	Clock::Initialize();
 
 #pragma region Null Values
 	/// AMF Internals
@@ -71,6 +75,13 @@ Plugin::AMD::Encoder::Encoder(Codec codec, std::shared_ptr<API::IAPI> videoAPI,
 	m_SubmitQueryWaitTimer = std::chrono::milliseconds(1);
 	m_SubmitQueryAttempts  = 16;
 	m_InitialFrameLatency  = 0;
+	m_StartupTimestamp     = Clock::Now();
+	m_PreRollFrames        = 0;
+
+	/// CPU Time
+	m_CPUTimeMainPending   = 0;
+	m_CPUTimeSubmitPending = 0;
+	std::memset(&m_CPUTimeStatistics, 0, sizeof(m_CPUTimeStatistics));
 
 	/// Status
 	m_SubmittedFrameCount    = 0;
@@ -84,6 +95,31 @@ Plugin::AMD::Encoder::Encoder(Codec codec, std::shared_ptr<API::IAPI> videoAPI,
 	m_PeriodBFrame         = 0;
 	m_FrameSkipPeriod      = 0;
 	m_FrameSkipKeepOnlyNth = false;
+	m_SegmentDuration      = 0;
+
+	/// Long-Term References
+	m_LTRPeriod           = 0;
+	m_LTRAcknowledgeDelay = 0;
+
+	/// Static Frames
+	m_StaticSkipMaximum = 0;
+	m_StaticSkipRun     = 0;
+	m_StaticHash        = 0;
+	m_StaticFrame       = false;
+
+	/// Scene Cuts
+	m_SceneCutMode = SceneCutMode::Disabled;
+	m_SceneCut     = false;
+
+	/// Lookahead
+	m_LookaheadFrames     = 0;
+	m_LookaheadDepth      = 0;
+	m_LookaheadComplexity = {0, 0};
+	m_LookaheadHead       = 0;
+
+	/// Decoder Buffer
+	m_HRDModelMode        = HRDModelMode::Disabled;
+	m_HRDModelLastWarning = 0;
 
 	/// Multi-Threading
 	m_MultiThreading = multiThreading;
@@ -99,86 +135,32 @@ Plugin::AMD::Encoder::Encoder(Codec codec, std::shared_ptr<API::IAPI> videoAPI,
 	m_OpenCLSubmission = useOpenCLSubmission;
 	m_OpenCLConversion = useOpenCLConversion;
 
-	// Initialize selected API on Video Adapter
-	m_API        = videoAPI;
-	m_APIAdapter = videoAdapter;
-	m_APIDevice  = m_API->CreateInstance(m_APIAdapter);
-
 	// Initialize Advanced Media Framework
 	m_AMF = AMF::Instance();
 	m_AMF->EnableDebugTrace(m_Debug);
 	m_AMFFactory = m_AMF->GetFactory();
 
-	// Create Context for Conversion and Encoding
-	AMF_RESULT res = m_AMFFactory->CreateContext(&m_AMFContext);
-	if (res != AMF_OK) {
-		QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> Creating a AMF Context failed, error %ls (code %d).", m_UniqueId,
-							 m_AMF->GetTrace()->GetResultText(res), res);
-		throw std::exception(errMsg.c_str());
-	}
-	/// Initialize Context using selected API
-	switch (m_API->GetType()) {
-	case API::Type::Direct3D11:
-	case API::Type::Direct3D9:
-		break;
-	default:
-		m_API = API::GetAPI(0);
-		switch (m_API->GetType()) {
-		case API::Type::Direct3D9:
-			m_APIAdapter = m_API->EnumerateAdapters()[0];
-			m_APIDevice  = m_API->CreateInstance(m_APIAdapter);
-			break;
-		case API::Type::Direct3D11:
-			m_APIAdapter = m_API->EnumerateAdapters()[0];
-			m_APIDevice  = m_API->CreateInstance(m_APIAdapter);
-			break;
-		}
-	}
-	switch (m_API->GetType()) {
-	case API::Type::Direct3D9:
-		m_AMFMemoryType = amf::AMF_MEMORY_DX9;
-		res             = m_AMFContext->InitDX9(m_APIDevice->GetContext());
-		break;
-	case API::Type::Direct3D11:
-		m_AMFMemoryType = amf::AMF_MEMORY_DX11;
-		res             = m_AMFContext->InitDX11(m_APIDevice->GetContext());
-		break;
-	}
-	if (res != AMF_OK) {
-		QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> Initializing %s API with Adapter '%s' failed, error %ls (code %d).",
-							 m_UniqueId, m_API->GetName().c_str(), m_APIAdapter.Name.c_str(),
-							 m_AMF->GetTrace()->GetResultText(res), res);
-		throw std::exception(errMsg.c_str());
-	}
+	// Context for Conversion and Encoding, shared with everything else on the same adapter.
+	m_SharedContext = SharedContext::Get(videoAPI, videoAdapter);
+	m_API           = m_SharedContext->GetAPI();
+	m_APIAdapter    = m_SharedContext->GetAdapter();
+	m_APIDevice     = m_SharedContext->GetDevice();
+	m_AMFContext    = m_SharedContext->GetContext();
+	m_AMFMemoryType = m_SharedContext->GetMemoryType();
 
 	// Initialize OpenCL (if possible)
 	if (m_OpenCLSubmission || m_OpenCLConversion) {
-		res = m_AMFContext->InitOpenCL();
-		if (res == AMF_OK) {
-			m_OpenCL = true;
-
-			res = m_AMFContext->GetCompute(amf::AMF_MEMORY_OPENCL, &m_AMFCompute);
-			if (res != AMF_OK) {
-				m_OpenCLSubmission = false;
-				m_OpenCLConversion = false;
-
-				QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> Retrieving Compute object failed, error %ls (code %d)",
-									 m_UniqueId, m_AMF->GetTrace()->GetResultText(res), res);
-				PLOG_WARNING("%s", errMsg.data());
-			}
-		} else {
-			m_OpenCL           = false;
+		m_AMFCompute = m_SharedContext->GetCompute();
+		m_OpenCL     = !!m_AMFCompute;
+		if (!m_OpenCL) {
 			m_OpenCLSubmission = false;
 			m_OpenCLConversion = false;
-
-			QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> Initialising OpenCL failed, error %ls (code %d)", m_UniqueId,
-								 m_AMF->GetTrace()->GetResultText(res), res);
-			PLOG_WARNING("%s", errMsg.data());
+			PLOG_WARNING("<Id: %llu> OpenCL is not available, using the regular path.", m_UniqueId);
 		}
 	}
 
 	// Create Converter
-	res = m_AMFFactory->CreateComponent(m_AMFContext, AMFVideoConverter, &m_AMFConverter);
+	AMF_RESULT res = m_AMFFactory->CreateComponent(m_AMFContext, AMFVideoConverter, &m_AMFConverter);
 	if (res != AMF_OK) {
 		QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> Creating frame converter component failed, error %ls (code %d)",
 							 m_UniqueId, m_AMF->GetTrace()->GetResultText(res), res);
@@ -219,6 +201,9 @@ Plugin::AMD::Encoder::Encoder(Codec codec, std::shared_ptr<API::IAPI> videoAPI,
 
 Plugin::AMD::Encoder::~Encoder()
 {
+	m_StaticSurface = nullptr;
+	m_LookaheadQueue.clear();
+
 	// Destroy AMF Encoder
 	if (m_AMFEncoder) {
 		m_AMFEncoder->Terminate();
@@ -231,17 +216,12 @@ Plugin::AMD::Encoder::~Encoder()
 		m_AMFConverter = nullptr;
 	}
 
-	// Destroy AMF Context
-	if (m_AMFContext) {
-		m_AMFContext->Terminate();
-		m_AMFContext = nullptr;
-	}
-
-	// Destroy API
-	if (m_API) {
-		m_APIDevice = nullptr;
-		m_API       = nullptr;
-	}
+	// Release AMF Context, the last encoder on the adapter destroys it.
+	m_AMFCompute    = nullptr;
+	m_AMFContext    = nullptr;
+	m_APIDevice     = nullptr;
+	m_API           = nullptr;
+	m_SharedContext = nullptr;
 
 	m_AMF = nullptr;
 
@@ -397,6 +377,36 @@ uint32_t Plugin::AMD::Encoder::GetBFramePeriod()
 	return m_PeriodBFrame;
 }
 
+void Plugin::AMD::Encoder::SetSceneCutMode(SceneCutMode v)
+{
+	m_SceneCutMode = v;
+}
+
+Plugin::AMD::SceneCutMode Plugin::AMD::Encoder::GetSceneCutMode()
+{
+	return m_SceneCutMode;
+}
+
+void Plugin::AMD::Encoder::SetSceneCutMinimumDistance(uint32_t v)
+{
+	m_SceneDetector.SetMinimumDistance(v);
+}
+
+uint32_t Plugin::AMD::Encoder::GetSceneCutMinimumDistance()
+{
+	return m_SceneDetector.GetMinimumDistance();
+}
+
+void Plugin::AMD::Encoder::SetSegmentDuration(uint32_t v)
+{
+	m_SegmentDuration = v;
+}
+
+uint32_t Plugin::AMD::Encoder::GetSegmentDuration()
+{
+	return m_SegmentDuration;
+}
+
 void Plugin::AMD::Encoder::SetFrameSkippingPeriod(uint32_t v)
 {
 	m_FrameSkipPeriod = v;
@@ -417,6 +427,16 @@ bool Plugin::AMD::Encoder::GetFrameSkippingBehaviour()
 	return m_FrameSkipKeepOnlyNth;
 }
 
+void Plugin::AMD::Encoder::SetStaticFrameSkipping(uint32_t v)
+{
+	m_StaticSkipMaximum = v;
+}
+
+uint32_t Plugin::AMD::Encoder::GetStaticFrameSkipping()
+{
+	return m_StaticSkipMaximum;
+}
+
 void Plugin::AMD::Encoder::Start()
 {
 	AMFTRACECALL;
@@ -430,6 +450,22 @@ void Plugin::AMD::Encoder::Start()
 		throw std::exception(errMsg.c_str());
 	}
 
+	// Recovering needs a slot that was acknowledged while the next one is being marked.
+	uint32_t ltrSlots = 0;
+	if (m_LTRPeriod > 0) {
+		try {
+			ltrSlots = GetMaximumLongTermReferenceFrames();
+			if (ltrSlots < 2) {
+				uint32_t maximum = CapsMaximumLongTermReferenceFrames().second;
+				ltrSlots         = (maximum < 2) ? maximum : 2;
+				SetMaximumLongTermReferenceFrames(ltrSlots);
+			}
+		} catch (const std::exception& ex) {
+			PLOG_WARNING("<Id: %" PRIu64 "> Long-Term References are not available: %s", m_UniqueId, ex.what());
+			ltrSlots = 0;
+		}
+	}
+
 	res = m_AMFEncoder->Init(amf::AMF_SURFACE_NV12, m_Resolution.first, m_Resolution.second);
 	if (res != AMF_OK) {
 		QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> Failed to initialize encoder, error %ls (code %d)", m_UniqueId,
@@ -437,11 +473,49 @@ void Plugin::AMD::Encoder::Start()
 		throw std::exception(errMsg.c_str());
 	}
 
+	bool preRolled = (m_PreRollFrames > 0) && PreRoll();
+
+	// Status
+	m_SubmittedFrameCount    = 0;
+	m_InitialFramesSent      = false;
+	m_InitialPacketRetrieved = false;
+	m_InitialFrameLatency    = 0;
+	m_CPUTimeMainPending     = 0;
+	m_CPUTimeSubmitPending   = 0;
+	m_SceneCut               = false;
+	m_StaticSkipRun          = 0;
+	m_StaticSurface          = nullptr;
+	m_StaticFrame            = false;
+	m_SceneDetector.Reset();
+	m_GOPPlanner.Reset();
+	{
+		// The encoder was only flushed after the pre-roll, the stream still has to open with an IDR.
+		std::lock_guard<std::mutex> lock(m_KeyframeRequestMutex);
+		m_KeyframeRequests.clear();
+		if (preRolled)
+			m_KeyframeRequests.push_back(INT64_MIN);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_LTRMutex);
+		m_LTRManager.Configure(ltrSlots, m_LTRPeriod, m_LTRAcknowledgeDelay);
+		m_LTRManager.Reset();
+	}
+	m_LookaheadDepth = (GetRateControlMethod() == RateControlMethod::ConstantQP) ? m_LookaheadFrames : 0;
+	m_Lookahead.SetDepth(m_LookaheadDepth);
+	m_LookaheadQueue.assign(m_LookaheadDepth + 1, nullptr);
+	m_LookaheadHead = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_HRDModelMutex);
+		m_HRDModel.Reset();
+		m_HRDModelLastWarning = 0;
+	}
+	std::memset(&m_CPUTimeStatistics, 0, sizeof(m_CPUTimeStatistics));
+
 	// Threading
 	if (m_MultiThreading) {
 		m_AsyncSend                  = new EncoderThreadingData;
 		m_AsyncSend->shutdown        = false;
-		m_AsyncSend->wakeupcount     = 0; // 2 ^ 32;
+		m_AsyncSend->wakeupcount     = 0;
 		m_AsyncSend->data            = nullptr;
 		m_AsyncSend->worker          = std::thread(AsyncSendMain, this);
 		m_AsyncRetrieve              = new EncoderThreadingData;
@@ -454,6 +528,128 @@ void Plugin::AMD::Encoder::Start()
 	m_Started = true;
 }
 
+bool Plugin::AMD::Encoder::PreRoll()
+{
+	AMFTRACECALL;
+
+	AMF_RESULT         res;
+	uint64_t           clk_start = Clock::Now();
+	uint32_t           submitted = 0, discarded = 0;
+	amf::AMFSurfacePtr black;
+
+	res = m_AMFContext->AllocSurface(amf::AMF_MEMORY_HOST, m_AMFSurfaceFormat, m_Resolution.first,
+									 m_Resolution.second, &black);
+	if (res != AMF_OK) {
+		PLOG_WARNING("<Id: %" PRIu64 "> [PreRoll] Unable to allocate Surface, error %ls (code %d)", m_UniqueId,
+					 m_AMF->GetTrace()->GetResultText(res), res);
+		return false;
+	}
+
+	// Black in whatever format the frames will arrive in, so the converter runs the same shaders.
+	uint8_t luma = m_FullColorRange ? 0 : 16;
+	for (size_t i = 0; i < black->GetPlanesCount(); i++) {
+		amf::AMFPlanePtr plane = black->GetPlaneAt(i);
+		uint8_t          pattern[4];
+		switch (m_ColorFormat) {
+		case ColorFormat::YUY2:
+			pattern[0] = pattern[2] = luma;
+			pattern[1] = pattern[3] = 128;
+			break;
+		case ColorFormat::BGRA:
+		case ColorFormat::RGBA:
+			pattern[0] = pattern[1] = pattern[2] = 0;
+			pattern[3]                           = 255;
+			break;
+		default:
+			std::memset(pattern, (i == 0) ? luma : 128, sizeof(pattern));
+			break;
+		}
+
+		uint8_t* plane_nat = static_cast<uint8_t*>(plane->GetNative());
+		size_t   rowSize   = (size_t)plane->GetWidth() * plane->GetPixelSizeInBytes();
+		for (int32_t py = 0; py < plane->GetHeight(); py++) {
+			uint8_t* row = plane_nat + (size_t)py * plane->GetHPitch();
+			for (size_t px = 0; px < rowSize; px++)
+				row[px] = pattern[px & 3];
+		}
+	}
+	res = black->Convert(m_AMFMemoryType);
+	if (res != AMF_OK) {
+		PLOG_WARNING("<Id: %" PRIu64 "> [PreRoll] Conversion of Surface failed, error %ls (code %d)", m_UniqueId,
+					 m_AMF->GetTrace()->GetResultText(res), res);
+		return false;
+	}
+
+	for (uint32_t frame = 0; frame < m_PreRollFrames; frame++) {
+		amf::AMFDataPtr data, packet;
+		black->SetPts(frame * m_TimestampStepRounded);
+		black->SetDuration(m_TimestampStepRounded);
+		if (m_OpenCLConversion && (black->Convert(amf::AMF_MEMORY_OPENCL) != AMF_OK))
+			break;
+		if ((m_AMFConverter->SubmitInput(black) != AMF_OK) || (m_AMFConverter->QueryOutput(&data) != AMF_OK)
+			|| !data)
+			break;
+		if (m_OpenCLConversion && (black->Convert(m_AMFMemoryType) != AMF_OK))
+			break;
+
+		for (uint64_t attempt = 0; attempt < m_SubmitQueryAttempts; attempt++) {
+			res = m_AMFEncoder->SubmitInput(data);
+			if (res != AMF_INPUT_FULL)
+				break;
+			if (m_AMFEncoder->QueryOutput(&packet) == AMF_OK)
+				discarded++;
+			packet = nullptr;
+			std::this_thread::sleep_for(m_SubmitQueryWaitTimer);
+		}
+		if (res != AMF_OK)
+			break;
+		submitted++;
+	}
+	if (submitted < m_PreRollFrames)
+		PLOG_WARNING("<Id: %" PRIu64 "> [PreRoll] Stopped after %" PRIu32 " of %" PRIu32 " frames.", m_UniqueId,
+					 submitted, m_PreRollFrames);
+	if (submitted == 0) {
+		m_AMFConverter->Flush();
+		m_AMFEncoder->Flush();
+		return false;
+	}
+
+	// Wait for everything to come out, otherwise the first real packets would be these.
+	m_AMFEncoder->Drain();
+	for (uint64_t attempt = 0; attempt < (m_SubmitQueryAttempts * (submitted + 1)); attempt++) {
+		amf::AMFDataPtr packet;
+		res = m_AMFEncoder->QueryOutput(&packet);
+		if (res == AMF_OK) {
+			discarded++;
+		} else if (res == AMF_REPEAT) {
+			std::this_thread::sleep_for(m_SubmitQueryWaitTimer);
+		} else {
+			break;
+		}
+	}
+
+	// Flushing keeps what was just allocated, ReInit would throw part of it away again. Start() forces an IDR on the
+	// first real frame instead.
+	m_AMFConverter->Flush();
+	res = m_AMFEncoder->Flush();
+	if (res != AMF_OK) {
+		PLOG_WARNING("<Id: %" PRIu64 "> [PreRoll] Flushing the encoder failed, error %ls (code %d), re-initializing.",
+					 m_UniqueId, m_AMF->GetTrace()->GetResultText(res), res);
+		// Not Restart(), which throws, the pre-roll is optional and must not fail Start().
+		res = m_AMFEncoder->ReInit(m_Resolution.first, m_Resolution.second);
+		if (res != AMF_OK) {
+			PLOG_WARNING("<Id: %" PRIu64 "> [PreRoll] Re-initializing the encoder failed, error %ls (code %d).",
+						 m_UniqueId, m_AMF->GetTrace()->GetResultText(res), res);
+			return false;
+		}
+	}
+
+	PLOG_INFO("<Id: %" PRIu64 "> Pre-roll of %" PRIu32 " frames (%" PRIu32 " packets) took %" PRIu64
+			  " milliseconds.",
+			  m_UniqueId, submitted, discarded, Clock::ToNanoseconds(Clock::Now() - clk_start) / 1000000);
+	return true;
+}
+
 void Plugin::AMD::Encoder::Restart()
 {
 	AMFTRACECALL;
@@ -477,13 +673,16 @@ void Plugin::AMD::Encoder::Stop()
 	m_AMFConverter->Flush();
 	m_AMFEncoder->Drain();
 	m_AMFEncoder->Flush();
+	m_StaticSurface = nullptr;
+	// Like the frames still in the encoder, the ones held back by the lookahead never make it out.
+	m_LookaheadQueue.clear();
 
 	// Threading
 	if (m_MultiThreading) {
 		{
 			std::unique_lock<std::mutex> lock(m_AsyncRetrieve->mutex);
 			m_AsyncRetrieve->shutdown    = true;
-			m_AsyncRetrieve->wakeupcount = 2 ^ 32;
+			m_AsyncRetrieve->wakeupcount = SIZE_MAX;
 			m_AsyncRetrieve->condvar.notify_all();
 			m_AsyncRetrieve->data = nullptr;
 		}
@@ -492,7 +691,7 @@ void Plugin::AMD::Encoder::Stop()
 		{
 			std::unique_lock<std::mutex> lock(m_AsyncSend->mutex);
 			m_AsyncSend->shutdown    = true;
-			m_AsyncSend->wakeupcount = 2 ^ 32;
+			m_AsyncSend->wakeupcount = SIZE_MAX;
 			m_AsyncSend->condvar.notify_all();
 			m_AsyncSend->data = nullptr;
 		}
@@ -500,6 +699,33 @@ void Plugin::AMD::Encoder::Stop()
 		delete m_AsyncSend;
 	}
 
+	if (m_CPUTimeStatistics.frames > 0) {
+		CPUTimeStatistics& st = m_CPUTimeStatistics;
+		uint64_t           n  = st.frames;
+		PLOG_INFO("<Id: %" PRIu64 "> Average per Frame: Latency(%8" PRIu64 " ns) CPU(%8" PRIu64 " ns)", m_UniqueId,
+				  st.latency / n,
+				  (st.allocate + st.store + st.convert + st.main + st.submit + st.query + st.load) / n);
+		PLOG_INFO("<Id: %" PRIu64 ">    CPU: Allocate(%8" PRIu64 " ns) Store(%8" PRIu64 " ns) Convert(%8" PRIu64
+				  " ns) Main(%8" PRIu64 " ns) Submit(%8" PRIu64 " ns) Query(%8" PRIu64 " ns) Load(%8" PRIu64 " ns)",
+				  m_UniqueId, st.allocate / n, st.store / n, st.convert / n, st.main / n, st.submit / n, st.query / n,
+				  st.load / n);
+	}
+
+	if (GetHRDModelMode() != HRDModelMode::Disabled) {
+		HRDModel::Statistics st = GetHRDModelStatistics();
+		PLOG_INFO("<Id: %" PRIu64 "> Decoder Buffer: Frames(%" PRIu64 ") Underflows(%" PRIu64 ") Overflows(%" PRIu64
+				  ") Fullness(%.1f%% - %.1f%%)",
+				  m_UniqueId, st.frames, st.underflows, st.overflows, st.minimumFullness * 100.0,
+				  st.maximumFullness * 100.0);
+	}
+
+	if (m_LTRPeriod > 0) {
+		LTRManager::Statistics st = GetLongTermReferenceStatistics();
+		PLOG_INFO("<Id: %" PRIu64 "> Long-Term References: Marked(%" PRIu64 ") Losses(%" PRIu64 ") Recovered(%" PRIu64
+				  ") Keyframes(%" PRIu64 ")",
+				  m_UniqueId, st.marked, st.losses, st.recovered, st.keyframes);
+	}
+
 	m_Started = false;
 }
 
@@ -510,6 +736,258 @@ bool Plugin::AMD::Encoder::IsStarted()
 	return m_Started;
 }
 
+void Plugin::AMD::Encoder::RequestKeyframe()
+{
+	RequestKeyframe(INT64_MIN);
+}
+
+void Plugin::AMD::Encoder::RequestKeyframe(int64_t pts)
+{
+	std::lock_guard<std::mutex> lock(m_KeyframeRequestMutex);
+	m_KeyframeRequests.push_back(pts);
+}
+
+bool Plugin::AMD::Encoder::TakeKeyframeRequest(int64_t pts)
+{
+	std::lock_guard<std::mutex> lock(m_KeyframeRequestMutex);
+	if (m_KeyframeRequests.empty())
+		return false;
+
+	// Every request up to this frame is served by the same keyframe.
+	size_t kept = 0;
+	for (int64_t request : m_KeyframeRequests) {
+		if (request > pts)
+			m_KeyframeRequests[kept++] = request;
+	}
+	bool taken = (kept != m_KeyframeRequests.size());
+	m_KeyframeRequests.resize(kept);
+	return taken;
+}
+
+void Plugin::AMD::Encoder::SetLongTermReferencePeriod(uint32_t v)
+{
+	m_LTRPeriod = v;
+}
+
+uint32_t Plugin::AMD::Encoder::GetLongTermReferencePeriod()
+{
+	return m_LTRPeriod;
+}
+
+void Plugin::AMD::Encoder::SetLongTermReferenceAcknowledgeDelay(uint32_t v)
+{
+	m_LTRAcknowledgeDelay = v;
+}
+
+uint32_t Plugin::AMD::Encoder::GetLongTermReferenceAcknowledgeDelay()
+{
+	return m_LTRAcknowledgeDelay;
+}
+
+Plugin::LTRManager::Statistics Plugin::AMD::Encoder::GetLongTermReferenceStatistics()
+{
+	std::lock_guard<std::mutex> lock(m_LTRMutex);
+	return m_LTRManager.GetStatistics();
+}
+
+void Plugin::AMD::Encoder::AcknowledgeFrame(int64_t pts)
+{
+	std::lock_guard<std::mutex> lock(m_LTRMutex);
+	m_LTRManager.Acknowledge((pts > 0) ? (uint64_t)pts : 0);
+}
+
+void Plugin::AMD::Encoder::ReportLoss(int64_t pts)
+{
+	std::lock_guard<std::mutex> lock(m_LTRMutex);
+	m_LTRManager.ReportLoss((pts > 0) ? (uint64_t)pts : 0);
+}
+
+bool Plugin::AMD::Encoder::NeedsLTRKeyframe()
+{
+	std::lock_guard<std::mutex> lock(m_LTRMutex);
+	return m_LTRManager.NeedsKeyframe();
+}
+
+Plugin::LTRManager::Action Plugin::AMD::Encoder::NextLTRAction(uint64_t index, bool keyframe)
+{
+	std::lock_guard<std::mutex> lock(m_LTRMutex);
+	return m_LTRManager.Next(index, keyframe);
+}
+
+void Plugin::AMD::Encoder::SetStartupTimestamp(uint64_t v)
+{
+	m_StartupTimestamp = v;
+}
+
+void Plugin::AMD::Encoder::SetPreRollFrames(uint32_t v)
+{
+	m_PreRollFrames = v;
+}
+
+uint32_t Plugin::AMD::Encoder::GetPreRollFrames()
+{
+	return m_PreRollFrames;
+}
+
+void Plugin::AMD::Encoder::SetLookaheadFrames(uint32_t v)
+{
+	m_LookaheadFrames = v;
+}
+
+uint32_t Plugin::AMD::Encoder::GetLookaheadFrames()
+{
+	return m_LookaheadFrames;
+}
+
+void Plugin::AMD::Encoder::SetAdaptiveBitrateEnabled(bool v)
+{
+	std::lock_guard<std::mutex> lock(m_BitrateControllerMutex);
+	if (!v) {
+		m_BitrateController = nullptr;
+		return;
+	}
+	if (!m_BitrateController)
+		m_BitrateController = std::make_unique<BitrateController>();
+	m_BitrateController->Configure(GetTargetBitrate(), GetPeakBitrate(), GetVBVBufferSize());
+}
+
+bool Plugin::AMD::Encoder::IsAdaptiveBitrateEnabled()
+{
+	std::lock_guard<std::mutex> lock(m_BitrateControllerMutex);
+	return !!m_BitrateController;
+}
+
+void Plugin::AMD::Encoder::ReportCongestion(double v)
+{
+	std::lock_guard<std::mutex> lock(m_BitrateControllerMutex);
+	if (m_BitrateController)
+		m_BitrateController->ReportCongestion(v);
+}
+
+void Plugin::AMD::Encoder::ReportDroppedFrames(uint64_t dropped, uint64_t total)
+{
+	std::lock_guard<std::mutex> lock(m_BitrateControllerMutex);
+	if (m_BitrateController)
+		m_BitrateController->ReportDroppedFrames(dropped, total);
+}
+
+void Plugin::AMD::Encoder::ReportBandwidth(uint64_t bitsPerSecond)
+{
+	std::lock_guard<std::mutex> lock(m_BitrateControllerMutex);
+	if (m_BitrateController)
+		m_BitrateController->ReportBandwidth(bitsPerSecond);
+}
+
+void Plugin::AMD::Encoder::UpdateAdaptiveBitrate()
+{
+	std::lock_guard<std::mutex> lock(m_BitrateControllerMutex);
+	if (!m_BitrateController || !m_BitrateController->Update(Clock::ToNanoseconds(Clock::Now())))
+		return;
+
+	// Same setters as a settings update, which the encoder picks up with the next frame.
+	try {
+		SetTargetBitrate(m_BitrateController->GetTargetBitrate());
+		SetPeakBitrate(m_BitrateController->GetPeakBitrate());
+		if (m_BitrateController->GetVBVBufferSize() > 0)
+			SetVBVBufferSize(m_BitrateController->GetVBVBufferSize());
+	} catch (const std::exception& e) {
+		PLOG_WARNING("<Id: %" PRIu64 "> Adapting bitrate failed: %s", m_UniqueId, e.what());
+		return;
+	}
+	PLOG_INFO("<Id: %" PRIu64 "> Adapted bitrate to %.0f%%: Target(%" PRIu64 " bit/s) Peak(%" PRIu64
+			  " bit/s) VBV(%" PRIu64 " bit)",
+			  m_UniqueId, m_BitrateController->GetFactor() * 100.0, m_BitrateController->GetTargetBitrate(),
+			  m_BitrateController->GetPeakBitrate(), m_BitrateController->GetVBVBufferSize());
+
+	// The decoder buffer now fills at the new rate.
+	ConfigureHRDModel();
+}
+
+void Plugin::AMD::Encoder::SetHRDModelMode(HRDModelMode v)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_HRDModelMutex);
+		m_HRDModelMode = v;
+	}
+	ConfigureHRDModel();
+}
+
+Plugin::AMD::HRDModelMode Plugin::AMD::Encoder::GetHRDModelMode()
+{
+	std::lock_guard<std::mutex> lock(m_HRDModelMutex);
+	return m_HRDModelMode;
+}
+
+Plugin::HRDModel::Statistics Plugin::AMD::Encoder::GetHRDModelStatistics()
+{
+	std::lock_guard<std::mutex> lock(m_HRDModelMutex);
+	return m_HRDModel.GetStatistics();
+}
+
+void Plugin::AMD::Encoder::ConfigureHRDModel()
+{
+	// Queried before locking, the getters talk to AMF.
+	RateControlMethod rcm      = GetRateControlMethod();
+	bool              cbr      = (rcm == RateControlMethod::ConstantBitrate);
+	uint64_t          bitrate  = cbr ? GetTargetBitrate() : GetPeakBitrate();
+	uint64_t          size     = GetVBVBufferSize();
+	double            fullness = GetInitialVBVBufferFullness();
+
+	std::lock_guard<std::mutex> lock(m_HRDModelMutex);
+	if (m_HRDModelMode == HRDModelMode::Disabled)
+		return;
+	m_HRDModel.Configure(bitrate, size, fullness, cbr);
+}
+
+void Plugin::AMD::Encoder::UpdateHRDModel(uint64_t bits, uint64_t time)
+{
+	double pressure = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_HRDModelMutex);
+		if (m_HRDModelMode == HRDModelMode::Disabled)
+			return;
+
+		if (!m_HRDModel.AddFrame(bits, time) && (time >= m_HRDModelLastWarning)) {
+			const HRDModel::Statistics& st = m_HRDModel.GetStatistics();
+			PLOG_WARNING("<Id: %" PRIu64 "> Decoder Buffer violated: Underflows(%" PRIu64 ") Overflows(%" PRIu64
+						 ") Frame(%" PRIu64 " bit)",
+						 m_UniqueId, st.underflows, st.overflows, bits);
+			m_HRDModelLastWarning = time + 1000000000ull;
+		}
+
+		if (m_HRDModelMode == HRDModelMode::Feedback)
+			pressure = m_HRDModel.GetPressure();
+	}
+
+	// Outside of the lock, see m_HRDModelMutex.
+	if (pressure > 0)
+		ReportCongestion(pressure);
+}
+
+bool Plugin::AMD::Encoder::DetectStaticFrame(struct encoder_frame* frame)
+{
+	// Only the height is needed, the hash covers whole lines including padding.
+	uint32_t heights[MAX_AV_PLANES] = {m_Resolution.second};
+	switch (m_ColorFormat) {
+	case ColorFormat::NV12:
+		heights[1] = (m_Resolution.second + 1) / 2;
+		break;
+	case ColorFormat::I420:
+		heights[1] = heights[2] = (m_Resolution.second + 1) / 2;
+		break;
+	default:
+		break;
+	}
+
+	uint64_t hash = 0;
+	for (size_t plane = 0; (plane < MAX_AV_PLANES) && (heights[plane] > 0) && frame->data[plane]; plane++)
+		hash = FrameHash::Compute(frame->data[plane], (size_t)frame->linesize[plane] * heights[plane], hash);
+
+	bool unchanged = m_StaticSurface && (hash == m_StaticHash);
+	m_StaticHash   = hash;
+	return unchanged && (m_StaticSkipRun < m_StaticSkipMaximum);
+}
+
 bool Plugin::AMD::Encoder::Encode(struct encoder_frame* frame, struct encoder_packet* packet, bool* received_packet)
 {
 	AMFTRACECALL;
@@ -522,16 +1000,20 @@ bool Plugin::AMD::Encoder::Encode(struct encoder_frame* frame, struct encoder_pa
 	amf::AMFDataPtr    packet_data  = nullptr;
 
 	// Encoding Steps
+	m_StaticFrame = (m_StaticSkipMaximum > 0) && DetectStaticFrame(frame);
 	if (!EncodeAllocate(surface))
 		return false;
 	if (!EncodeStore(surface, frame))
 		return false;
 	if (!EncodeConvert(surface, surface_data))
 		return false;
+	if ((m_LookaheadDepth > 0) && !EncodeLookahead(surface_data))
+		return true;
 	if (!EncodeMain(surface_data, packet_data))
 		return false;
 	if (!EncodeLoad(packet_data, packet, received_packet))
 		return false;
+	UpdateAdaptiveBitrate();
 
 	return true;
 }
@@ -600,46 +1082,55 @@ bool Plugin::AMD::Encoder::GetExtraData(uint8_t** extra_data, size_t* size)
 bool Plugin::AMD::Encoder::EncodeAllocate(OUT amf::AMFSurfacePtr& surface)
 {
 	AMFTRACECALL;
+	ALLOCATION_STAGE(Allocate);
 
 	AMF_RESULT res;
-	auto       clk_start = std::chrono::high_resolution_clock::now();
+	uint64_t   clk_start = Clock::Now();
+	uint64_t   cpu_start = Utility::GetThreadCPUTime();
 
 	// Allocate
-	if (m_OpenCLSubmission) {
-		res = m_AMFContext->AllocSurface(m_AMFMemoryType, m_AMFSurfaceFormat, m_Resolution.first, m_Resolution.second,
-										 &surface);
+	if (m_StaticFrame) {
+		// The converter is done with it, so the last surface can simply be submitted again.
+		surface = m_StaticSurface;
 	} else {
-		// Required when not using OpenCL, can't directly write to GPU memory with memcpy.
-		res = m_AMFContext->AllocSurface(amf::AMF_MEMORY_HOST, m_AMFSurfaceFormat, m_Resolution.first,
-										 m_Resolution.second, &surface);
-	}
-	if (res != AMF_OK) {
-		QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> Unable to allocate Surface, error %ls (code %d)", m_UniqueId,
-							 m_AMF->GetTrace()->GetResultText(res), res);
-		PLOG_ERROR("%s", errMsg.data());
-		return false;
+		if (m_OpenCLSubmission) {
+			res = m_AMFContext->AllocSurface(m_AMFMemoryType, m_AMFSurfaceFormat, m_Resolution.first,
+											 m_Resolution.second, &surface);
+		} else {
+			// Required when not using OpenCL, can't directly write to GPU memory with memcpy.
+			res = m_AMFContext->AllocSurface(amf::AMF_MEMORY_HOST, m_AMFSurfaceFormat, m_Resolution.first,
+											 m_Resolution.second, &surface);
+		}
+		if (res != AMF_OK) {
+			QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> Unable to allocate Surface, error %ls (code %d)", m_UniqueId,
+								 m_AMF->GetTrace()->GetResultText(res), res);
+			PLOG_ERROR("%s", errMsg.data());
+			return false;
+		}
+		ALLOCATION_COUNT_AMF_OBJECT();
 	}
 
 	// Performance Tracking
-	auto     clk_end      = std::chrono::high_resolution_clock::now();
-	uint64_t pf_timestamp = std::chrono::nanoseconds(clk_end.time_since_epoch()).count();
-	uint64_t pf_time      = std::chrono::nanoseconds(clk_end - clk_start).count();
+	uint64_t clk_end      = Clock::Now();
+	uint64_t pf_timestamp = clk_end;
+	uint64_t pf_time      = clk_end - clk_start;
 
 	surface->SetProperty(AMF_TIMESTAMP_ALLOCATE, pf_timestamp);
 	surface->SetProperty(AMF_TIME_ALLOCATE, pf_time);
+	surface->SetProperty(AMF_CPUTIME_ALLOCATE, Utility::GetThreadCPUTime() - cpu_start);
 
 	return true;
 }
 
-bool Plugin::AMD::Encoder::EncodeStore(OUT amf::AMFSurfacePtr& surface, IN struct encoder_frame* frame)
+bool Plugin::AMD::Encoder::EncodeUpload(IN amf::AMFSurfacePtr& surface, IN struct encoder_frame* frame)
 {
-	AMFTRACECALL;
-
 	AMF_RESULT                  res;
 	amf::AMFComputeSyncPointPtr pSyncPoint;
-	auto                        clk_start = std::chrono::high_resolution_clock::now();
 
+	// The queue is shared with the other encoders on this adapter.
+	std::unique_lock<std::mutex> computeLock;
 	if (m_OpenCLSubmission) {
+		computeLock = m_SharedContext->LockCompute();
 		m_AMFCompute->PutSyncPoint(&pSyncPoint);
 		res = surface->Convert(amf::AMF_MEMORY_OPENCL);
 		if (res != AMF_OK) {
@@ -690,6 +1181,7 @@ bool Plugin::AMD::Encoder::EncodeStore(OUT amf::AMFSurfacePtr& surface, IN struc
 			return false;
 		}
 		pSyncPoint->Wait();
+		computeLock.unlock();
 	}
 	res = surface->Convert(m_AMFMemoryType);
 	if (res != AMF_OK) {
@@ -699,6 +1191,52 @@ bool Plugin::AMD::Encoder::EncodeStore(OUT amf::AMFSurfacePtr& surface, IN struc
 		return false;
 	}
 
+	return true;
+}
+
+bool Plugin::AMD::Encoder::EncodeStore(OUT amf::AMFSurfacePtr& surface, IN struct encoder_frame* frame)
+{
+	AMFTRACECALL;
+	ALLOCATION_STAGE(Store);
+
+	uint64_t clk_start = Clock::Now();
+	uint64_t cpu_start = Utility::GetThreadCPUTime();
+
+	// Unchanged frames are still on the surface from last time.
+	if (!m_StaticFrame) {
+		if (!EncodeUpload(surface, frame))
+			return false;
+		if (m_StaticSkipMaximum > 0)
+			m_StaticSurface = surface;
+	}
+
+	// Analysis, done on the luma of the frame as OBS handed it over.
+	size_t   lumaOffset = 0;
+	uint32_t lumaStep   = 1;
+	switch (m_ColorFormat) {
+	case ColorFormat::YUY2:
+		lumaStep = 2;
+		break;
+	case ColorFormat::BGRA:
+	case ColorFormat::RGBA:
+		lumaOffset = 1; // Green is close enough to luma
+		lumaStep   = 4;
+		break;
+	default:
+		break;
+	}
+	/// Scene Cuts
+	m_SceneCut = false;
+	if (m_SceneCutMode != SceneCutMode::Disabled) {
+		m_SceneCut = m_SceneDetector.Analyze(frame->data[0] + lumaOffset, frame->linesize[0], m_Resolution.first,
+											 m_Resolution.second, lumaStep);
+	}
+	/// Lookahead
+	if (m_LookaheadDepth > 0) {
+		m_LookaheadComplexity = m_Lookahead.Analyze(frame->data[0] + lumaOffset, frame->linesize[0],
+													m_Resolution.first, m_Resolution.second, lumaStep);
+	}
+
 	// Data Stuff
 	int64_t tsLast = (int64_t)round((frame->pts - 1) * m_TimestampStep);
 	int64_t tsNow  = (int64_t)round(frame->pts * m_TimestampStep);
@@ -710,18 +1248,19 @@ bool Plugin::AMD::Encoder::EncodeStore(OUT amf::AMFSurfacePtr& surface, IN struc
 	/// Duration
 	surface->SetDuration(tsNow - tsLast);
 	/// Type override
-	std::string printableType = HandleTypeOverride(surface, frame->pts);
+	const char* printableType = HandleTypeOverride(surface, frame->pts);
 
 	// Performance Tracking
-	auto     clk_end      = std::chrono::high_resolution_clock::now();
-	uint64_t pf_timestamp = std::chrono::nanoseconds(clk_end.time_since_epoch()).count();
-	uint64_t pf_time      = std::chrono::nanoseconds(clk_end - clk_start).count();
+	uint64_t clk_end      = Clock::Now();
+	uint64_t pf_timestamp = clk_end;
+	uint64_t pf_time      = clk_end - clk_start;
 	surface->SetProperty(AMF_TIMESTAMP_STORE, pf_timestamp);
 	surface->SetProperty(AMF_TIME_STORE, pf_time);
+	surface->SetProperty(AMF_CPUTIME_STORE, Utility::GetThreadCPUTime() - cpu_start);
 
 	if (m_Debug) {
 		PLOG_DEBUG("<Id: %llu> EncodeStore: PTS(%8lld) DTS(%8lld) TS(%16lld) Duration(%16lld) Type(%s)", m_UniqueId,
-				   frame->pts, frame->pts, surface->GetPts(), surface->GetDuration(), printableType.c_str());
+				   frame->pts, frame->pts, surface->GetPts(), surface->GetDuration(), printableType);
 	}
 
 	return true;
@@ -730,9 +1269,11 @@ bool Plugin::AMD::Encoder::EncodeStore(OUT amf::AMFSurfacePtr& surface, IN struc
 bool Plugin::AMD::Encoder::EncodeConvert(IN amf::AMFSurfacePtr& surface, OUT amf::AMFDataPtr& data)
 {
 	AMFTRACECALL;
+	ALLOCATION_STAGE(Convert);
 
 	AMF_RESULT res;
-	auto       clk_start = std::chrono::high_resolution_clock::now();
+	uint64_t   clk_start = Clock::Now();
+	uint64_t   cpu_start = Utility::GetThreadCPUTime();
 
 	if (m_OpenCLConversion) {
 		res = surface->Convert(amf::AMF_MEMORY_OPENCL);
@@ -758,6 +1299,7 @@ bool Plugin::AMD::Encoder::EncodeConvert(IN amf::AMFSurfacePtr& surface, OUT amf
 		PLOG_WARNING("%s", errMsg.data());
 		return false;
 	}
+	ALLOCATION_COUNT_AMF_OBJECT();
 	if (m_OpenCLConversion) {
 		res = surface->Convert(m_AMFMemoryType);
 		if (res != AMF_OK) {
@@ -769,20 +1311,52 @@ bool Plugin::AMD::Encoder::EncodeConvert(IN amf::AMFSurfacePtr& surface, OUT amf
 	}
 
 	// Performance Tracking
-	auto     clk_end      = std::chrono::high_resolution_clock::now();
-	uint64_t pf_timestamp = std::chrono::nanoseconds(clk_end.time_since_epoch()).count();
-	uint64_t pf_time      = std::chrono::nanoseconds(clk_end - clk_start).count();
+	uint64_t clk_end      = Clock::Now();
+	uint64_t pf_timestamp = clk_end;
+	uint64_t pf_time      = clk_end - clk_start;
 	surface->SetProperty(AMF_TIMESTAMP_CONVERT, pf_timestamp);
 	surface->SetProperty(AMF_TIME_CONVERT, pf_time);
+	surface->SetProperty(AMF_CPUTIME_CONVERT, Utility::GetThreadCPUTime() - cpu_start);
 
 	return true;
 }
 
+bool Plugin::AMD::Encoder::EncodeLookahead(IN OUT amf::AMFDataPtr& data)
+{
+	AMFTRACECALL;
+	ALLOCATION_STAGE(Lookahead);
+
+	// Frames wait until the ones following them have been analyzed, returns false while there is nothing to submit.
+	size_t capacity = m_LookaheadQueue.size();
+	size_t tail     = (m_LookaheadHead + m_Lookahead.GetCount()) % capacity;
+
+	m_LookaheadQueue[tail] = data;
+	m_Lookahead.Push(m_LookaheadComplexity);
+	if (m_Lookahead.GetCount() <= m_LookaheadDepth) {
+		data = nullptr;
+		return false;
+	}
+
+	data = TakeLookahead();
+	return true;
+}
+
+amf::AMFDataPtr Plugin::AMD::Encoder::TakeLookahead()
+{
+	amf::AMFDataPtr data              = m_LookaheadQueue[m_LookaheadHead];
+	m_LookaheadQueue[m_LookaheadHead] = nullptr;
+	m_LookaheadHead                   = (m_LookaheadHead + 1) % m_LookaheadQueue.size();
+	HandleQPOverride(data, m_Lookahead.Next());
+	return data;
+}
+
 bool Plugin::AMD::Encoder::EncodeMain(IN amf::AMFDataPtr& data, OUT amf::AMFDataPtr& packet)
 {
 	AMFTRACECALL;
+	ALLOCATION_STAGE(Main);
 
-	bool frameSubmitted = false, packetRetrieved = false;
+	bool     frameSubmitted = false, packetRetrieved = false;
+	uint64_t cpu_start      = Utility::GetThreadCPUTime();
 
 	bool keepLooping = true;
 	for (uint64_t attempt = 1; keepLooping; attempt++) {
@@ -816,8 +1390,7 @@ bool Plugin::AMD::Encoder::EncodeMain(IN amf::AMFDataPtr& data, OUT amf::AMFData
 				}
 			} else {
 				// Performance Tracking
-				auto     clk   = std::chrono::high_resolution_clock::now();
-				uint64_t pf_ts = std::chrono::nanoseconds(clk.time_since_epoch()).count();
+				uint64_t pf_ts = Clock::Now();
 				data->SetProperty(AMF_TIMESTAMP_SUBMIT, pf_ts);
 
 				AMF_RESULT res = m_AMFEncoder->SubmitInput(data);
@@ -869,12 +1442,12 @@ bool Plugin::AMD::Encoder::EncodeMain(IN amf::AMFDataPtr& data, OUT amf::AMFData
 				}
 
 				if (res == AMF_OK) {
+					ALLOCATION_COUNT_AMF_OBJECT();
 					m_InitialPacketRetrieved = true;
 					packetRetrieved          = true;
 
 					// Performance Tracking
-					auto     clk      = std::chrono::high_resolution_clock::now();
-					uint64_t pf_query = std::chrono::nanoseconds(clk.time_since_epoch()).count(), pf_submit, pf_main;
+					uint64_t pf_query = Clock::Now(), pf_submit, pf_main;
 					packet->GetProperty(AMF_TIMESTAMP_SUBMIT, &pf_submit);
 					packet->SetProperty(AMF_TIMESTAMP_QUERY, pf_query);
 					pf_main = (pf_query - pf_submit);
@@ -895,20 +1468,25 @@ bool Plugin::AMD::Encoder::EncodeMain(IN amf::AMFDataPtr& data, OUT amf::AMFData
 		if (!packetRetrieved || !frameSubmitted)
 			std::this_thread::sleep_for(m_SubmitQueryWaitTimer);
 	}
+	// Logged directly, these run per frame and should not allocate.
 	if (!frameSubmitted) {
-		QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> Input Queue is full, encoder is overloaded!", m_UniqueId);
-		PLOG_WARNING("%s", errMsg.data());
+		PLOG_WARNING("<Id: %" PRIu64 "> Input Queue is full, encoder is overloaded!", m_UniqueId);
 	}
 	if (!m_InitialPacketRetrieved) {
-		QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> Waiting for initial frame...", m_UniqueId);
-		PLOG_DEBUG("%s", errMsg.data());
+		PLOG_DEBUG("<Id: %" PRIu64 "> Waiting for initial frame...", m_UniqueId);
 	}
 	if (m_InitialPacketRetrieved && !packetRetrieved) {
-		QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> No output Packet, encoder is overloaded!", m_UniqueId);
-		PLOG_WARNING("%s", errMsg.data());
+		PLOG_WARNING("<Id: %" PRIu64 "> No output Packet, encoder is overloaded!", m_UniqueId);
 	}
 	if (m_SubmittedFrameCount >= (m_TimestampOffset + m_QueueSize))
 		m_InitialFramesSent = true;
+
+	// Polling without a packet still costs CPU, carry it over to the next packet.
+	m_CPUTimeMainPending += Utility::GetThreadCPUTime() - cpu_start;
+	if (packet != nullptr) {
+		packet->SetProperty(AMF_CPUTIME_MAIN, m_CPUTimeMainPending);
+		m_CPUTimeMainPending = 0;
+	}
 	return true;
 }
 
@@ -916,12 +1494,14 @@ bool Plugin::AMD::Encoder::EncodeLoad(IN amf::AMFDataPtr& data, OUT struct encod
 									  OUT bool* received_packet)
 {
 	AMFTRACECALL;
+	ALLOCATION_STAGE(Load);
 
 	if (data == nullptr)
 		return true;
 
 	amf::AMFBufferPtr pBuffer   = amf::AMFBufferPtr(data);
-	auto              clk_start = std::chrono::high_resolution_clock::now();
+	uint64_t          clk_start = Clock::Now();
+	uint64_t          cpu_start = Utility::GetThreadCPUTime();
 
 	// Timestamps
 	packet->type = OBS_ENCODER_VIDEO;
@@ -939,9 +1519,11 @@ bool Plugin::AMD::Encoder::EncodeLoad(IN amf::AMFDataPtr& data, OUT struct encod
 	}
 	packet->data = m_PacketDataBuffer.data();
 	std::memcpy(packet->data, pBuffer->GetNative(), packet->size);
+	/// Decoder Buffer (AMF timestamps are in 100ns)
+	UpdateHRDModel(packet->size * 8, (uint64_t)data->GetPts() * 100);
 
 	// Performance Tracking
-	auto     clk_end = std::chrono::high_resolution_clock::now();
+	uint64_t clk_end = Clock::Now();
 	uint64_t pf_allocate_ts, pf_allocate_t, pf_store_ts, pf_store_t, pf_convert_ts, pf_convert_t, pf_submit_ts,
 		pf_query_ts, pf_main_t, pf_load_ts, pf_load_t;
 
@@ -954,11 +1536,38 @@ bool Plugin::AMD::Encoder::EncodeLoad(IN amf::AMFDataPtr& data, OUT struct encod
 	data->GetProperty(AMF_TIMESTAMP_SUBMIT, &pf_submit_ts);
 	data->GetProperty(AMF_TIMESTAMP_QUERY, &pf_query_ts);
 	data->GetProperty(AMF_TIME_MAIN, &pf_main_t);
-	pf_load_ts = std::chrono::nanoseconds(clk_end.time_since_epoch()).count();
-	pf_load_t  = std::chrono::nanoseconds(clk_end - clk_start).count();
+	pf_load_ts = clk_end;
+	pf_load_t  = clk_end - clk_start;
+
+	// Everything above is in clock ticks, only convert what gets reported.
+	pf_allocate_t = Clock::ToNanoseconds(pf_allocate_t);
+	pf_store_t    = Clock::ToNanoseconds(pf_store_t);
+	pf_convert_t  = Clock::ToNanoseconds(pf_convert_t);
+	pf_main_t     = Clock::ToNanoseconds(pf_main_t);
+	pf_load_t     = Clock::ToNanoseconds(pf_load_t);
+
+	// CPU Time, properties that were never set (e.g. Query without threading) stay zero.
+	uint64_t cpu_allocate = 0, cpu_store = 0, cpu_convert = 0, cpu_main = 0, cpu_submit = 0, cpu_query = 0, cpu_load;
+	data->GetProperty(AMF_CPUTIME_ALLOCATE, &cpu_allocate);
+	data->GetProperty(AMF_CPUTIME_STORE, &cpu_store);
+	data->GetProperty(AMF_CPUTIME_CONVERT, &cpu_convert);
+	data->GetProperty(AMF_CPUTIME_MAIN, &cpu_main);
+	data->GetProperty(AMF_CPUTIME_QUERY, &cpu_query);
+	cpu_submit = m_CPUTimeSubmitPending.exchange(0);
+	cpu_load = Utility::GetThreadCPUTime() - cpu_start;
+
+	m_CPUTimeStatistics.frames++;
+	m_CPUTimeStatistics.latency += pf_main_t;
+	m_CPUTimeStatistics.allocate += cpu_allocate;
+	m_CPUTimeStatistics.store += cpu_store;
+	m_CPUTimeStatistics.convert += cpu_convert;
+	m_CPUTimeStatistics.main += cpu_main;
+	m_CPUTimeStatistics.submit += cpu_submit;
+	m_CPUTimeStatistics.query += cpu_query;
+	m_CPUTimeStatistics.load += cpu_load;
 
 	if (m_Debug) {
-		std::string printableType = "Unknown";
+		const char* printableType = "Unknown";
 		if (m_Codec == Codec::AVC || m_Codec == Codec::SVC) {
 			uint64_t type = AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE_IDR;
 			data->GetProperty(AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE, &type);
@@ -996,16 +1605,24 @@ bool Plugin::AMD::Encoder::EncodeLoad(IN amf::AMFDataPtr& data, OUT struct encod
 		PLOG_DEBUG("<Id: %" PRIu64 "> EncodeLoad: PTS(%8" PRIu64 ") DTS(%8" PRIu64 ") TS(%16" PRIu64
 				   ") Duration(%16" PRIu64 ") Size(%16" PRIuPTR ") Type(%s)",
 				   m_UniqueId, packet->pts, packet->dts, data->GetPts(), data->GetDuration(), packet->size,
-				   printableType.c_str());
+				   printableType);
 		PLOG_DEBUG("<Id: %" PRIu64 ">    Timings: Allocate(%8" PRIu64 " ns) Store(%8" PRIu64 " ns) Convert(%8" PRIu64
 				   " ns) Main(%8" PRIu64 " ns) Load(%8" PRIu64 " ns)",
 				   m_UniqueId, pf_allocate_t, pf_store_t, pf_convert_t, pf_main_t, pf_load_t);
+		PLOG_DEBUG("<Id: %" PRIu64 ">        CPU: Allocate(%8" PRIu64 " ns) Store(%8" PRIu64 " ns) Convert(%8" PRIu64
+				   " ns) Main(%8" PRIu64 " ns) Submit(%8" PRIu64 " ns) Query(%8" PRIu64 " ns) Load(%8" PRIu64 " ns)",
+				   m_UniqueId, cpu_allocate, cpu_store, cpu_convert, cpu_main, cpu_submit, cpu_query, cpu_load);
 	}
 	if (m_InitialFrameLatency == 0) {
 		m_InitialFrameLatency = pf_main_t;
 		PLOG_INFO("<Id: %" PRIu64 "> Initial Frame Latency is %" PRIu64 " nanoseconds.", m_UniqueId,
 				  m_InitialFrameLatency);
 	}
+	if (m_StartupTimestamp != 0) {
+		PLOG_INFO("<Id: %" PRIu64 "> Time to first packet is %" PRIu64 " milliseconds.", m_UniqueId,
+				  Clock::ToNanoseconds(clk_end - m_StartupTimestamp) / 1000000);
+		m_StartupTimestamp = 0;
+	}
 
 	*received_packet = true;
 
@@ -1019,6 +1636,7 @@ int32_t Plugin::AMD::Encoder::AsyncSendMain(Encoder* obj)
 
 int32_t Plugin::AMD::Encoder::AsyncSendLocalMain()
 {
+	ALLOCATION_STAGE(AsyncSend);
 	EncoderThreadingData* own = m_AsyncSend;
 
 	std::unique_lock<std::mutex> lock(own->mutex);
@@ -1028,14 +1646,15 @@ int32_t Plugin::AMD::Encoder::AsyncSendLocalMain()
 		if (own->data == nullptr)
 			continue;
 
+		uint64_t cpu_start = Utility::GetThreadCPUTime();
 		{
 			// Performance Tracking
-			auto     clk   = std::chrono::high_resolution_clock::now();
-			uint64_t pf_ts = std::chrono::nanoseconds(clk.time_since_epoch()).count();
+			uint64_t pf_ts = Clock::Now();
 			own->data->SetProperty(AMF_TIMESTAMP_SUBMIT, pf_ts);
 		}
 
 		AMF_RESULT res = m_AMFEncoder->SubmitInput(own->data);
+		m_CPUTimeSubmitPending += Utility::GetThreadCPUTime() - cpu_start;
 		if (m_Debug) {
 			QUICK_FORMAT_MESSAGE(errMsg, "<Id: %llu> [Main/Submit] SubmitInput returned %ls (code %d).", m_UniqueId,
 								 m_AMF->GetTrace()->GetResultText(res), res);
@@ -1059,7 +1678,10 @@ int32_t Plugin::AMD::Encoder::AsyncSendLocalMain()
 			return -1;
 		}
 
+		// Don't hold the lock while sleeping, Encode needs it to hand over data.
+		lock.unlock();
 		std::this_thread::sleep_for(m_SubmitQueryWaitTimer);
+		lock.lock();
 	}
 	return 0;
 }
@@ -1071,11 +1693,14 @@ int32_t Plugin::AMD::Encoder::AsyncRetrieveMain(Encoder* obj)
 
 int32_t Plugin::AMD::Encoder::AsyncRetrieveLocalMain()
 {
-	EncoderThreadingData* own = m_AsyncRetrieve;
+	ALLOCATION_STAGE(AsyncRetrieve);
+	EncoderThreadingData* own         = m_AsyncRetrieve;
+	uint64_t              cpu_pending = 0; // Queries that did not return a packet yet.
 
 	std::unique_lock<std::mutex> lock(own->mutex);
 	while (!own->shutdown) {
-		own->condvar.wait(lock, [&own] { return own->shutdown || (own->wakeupcount > 0); });
+		// Waiting on a pending packet as well keeps this from spinning with the lock held.
+		own->condvar.wait(lock, [&own] { return own->shutdown || ((own->wakeupcount > 0) && (own->data == nullptr)); });
 
 		if (own->wakeupcount == 0)
 			continue;
@@ -1083,6 +1708,7 @@ int32_t Plugin::AMD::Encoder::AsyncRetrieveLocalMain()
 		if (own->data != nullptr)
 			continue;
 
+		uint64_t        cpu_start = Utility::GetThreadCPUTime();
 		amf::AMFDataPtr packet;
 		AMF_RESULT      res = m_AMFEncoder->QueryOutput(&packet);
 		if (m_Debug) {
@@ -1092,17 +1718,19 @@ int32_t Plugin::AMD::Encoder::AsyncRetrieveLocalMain()
 		}
 
 		if (res == AMF_OK) {
+			ALLOCATION_COUNT_AMF_OBJECT();
 			own->data = packet;
 			own->wakeupcount--;
 
 			// Performance Tracking
 			{
-				auto     clk      = std::chrono::high_resolution_clock::now();
-				uint64_t pf_query = std::chrono::nanoseconds(clk.time_since_epoch()).count(), pf_submit, pf_main;
+				uint64_t pf_query = Clock::Now(), pf_submit, pf_main;
 				packet->GetProperty(AMF_TIMESTAMP_SUBMIT, &pf_submit);
 				packet->SetProperty(AMF_TIMESTAMP_QUERY, pf_query);
 				pf_main = (pf_query - pf_submit);
 				packet->SetProperty(AMF_TIME_MAIN, pf_main);
+				packet->SetProperty(AMF_CPUTIME_QUERY, cpu_pending + (Utility::GetThreadCPUTime() - cpu_start));
+				cpu_pending = 0;
 			}
 		} else if (res == AMF_REPEAT) {
 			m_AsyncRetrieve->condvar.notify_all();
@@ -1118,8 +1746,13 @@ int32_t Plugin::AMD::Encoder::AsyncRetrieveLocalMain()
 			PLOG_ERROR("%s", errMsg.data());
 			return -1;
 		}
+		if (res != AMF_OK)
+			cpu_pending += Utility::GetThreadCPUTime() - cpu_start;
 
+		// Don't hold the lock while sleeping, Encode needs it to hand over data.
+		lock.unlock();
 		std::this_thread::sleep_for(m_SubmitQueryWaitTimer);
+		lock.lock();
 	}
 	return 0;
 }
@@ -19,6 +19,7 @@
 
 #include "amf.hpp"
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include <components\Component.h>
@@ -52,19 +53,71 @@ class CustomWriter : public amf::AMFTraceWriter {
 };
 
 #pragma region    Singleton
-static AMF*       __instance;
-static std::mutex __instance_mutex;
-void              Plugin::AMD::AMF::Initialize()
+static AMF*        __instance;
+static std::mutex  __instance_mutex;
+static std::string __instance_error;
+static AMF*        CreateInstance()
 {
-	const std::lock_guard<std::mutex> lock(__instance_mutex);
+	// Remember why it failed so that lazy callers do not retry loading a broken runtime over and over.
+	if (!__instance && __instance_error.empty()) {
+		try {
+			__instance = new AMF();
+		} catch (const std::exception& e) {
+			__instance_error = e.what();
+		}
+	}
 	if (!__instance)
-		__instance = new AMF();
+		throw std::exception(__instance_error.c_str());
+	return __instance;
+}
+
+void Plugin::AMD::AMF::Initialize()
+{
+	const std::lock_guard<std::mutex> lock(__instance_mutex);
+	CreateInstance();
 }
 
 AMF* Plugin::AMD::AMF::Instance()
 {
 	const std::lock_guard<std::mutex> lock(__instance_mutex);
-	return __instance;
+	return CreateInstance();
+}
+
+bool Plugin::AMD::AMF::IsAvailable()
+{
+	{
+		const std::lock_guard<std::mutex> lock(__instance_mutex);
+		if (__instance)
+			return true;
+		if (!__instance_error.empty())
+			return false;
+	}
+
+#ifdef _WIN32
+	// Mapping the file as data does not run any of its code, which keeps this cheap for non-AMD systems.
+	HMODULE module = LoadLibraryExW(AMF_DLL_NAME, NULL, LOAD_LIBRARY_AS_DATAFILE);
+	if (!module)
+		return false;
+	FreeLibrary(module);
+#endif
+	return true;
+}
+
+uint64_t Plugin::AMD::AMF::GetRuntimeFileVersion()
+{
+#ifdef _WIN32
+	std::vector<char> verbuf(GetFileVersionInfoSizeW(AMF_DLL_NAME, nullptr));
+	if ((verbuf.size() == 0) || !GetFileVersionInfoW(AMF_DLL_NAME, 0, (DWORD)verbuf.size(), verbuf.data()))
+		return 0;
+
+	VS_FIXEDFILEINFO* info     = nullptr;
+	UINT              infoSize = 0;
+	if (!VerQueryValueW(verbuf.data(), L"\\", (LPVOID*)&info, &infoSize) || (info == nullptr))
+		return 0;
+	return ((uint64_t)info->dwFileVersionMS << 32) | (uint64_t)info->dwFileVersionLS;
+#else
+	return 0;
+#endif
 }
 
 void Plugin::AMD::AMF::Finalize()
@@ -73,6 +126,7 @@ void Plugin::AMD::AMF::Finalize()
 	if (__instance)
 		delete __instance;
 	__instance = nullptr;
+	__instance_error.clear();
 }
 #pragma endregion Singleton
 
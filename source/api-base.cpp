@@ -19,6 +19,7 @@
 
 #include "api-base.hpp"
 #include <cinttypes>
+#include <mutex>
 #include "api-d3d11.hpp"
 #include "api-d3d9.hpp"
 #include "api-host.hpp"
@@ -60,7 +61,7 @@ bool Plugin::API::operator>=(const Plugin::API::Adapter& left, const Plugin::API
 
 bool Plugin::API::operator==(const Plugin::API::Adapter& left, const Plugin::API::Adapter& right)
 {
-	return ((left.idLow == right.idLow) && (right.idHigh == right.idHigh));
+	return ((left.idLow == right.idLow) && (left.idHigh == right.idHigh));
 }
 
 bool Plugin::API::operator!=(const Plugin::API::Adapter& left, const Plugin::API::Adapter& right)
@@ -96,10 +97,47 @@ Plugin::API::Adapter Plugin::API::IAPI::GetAdapterByName(const std::string& name
 	return *(EnumerateAdapters().begin());
 }
 
+std::shared_ptr<Instance> Plugin::API::IAPI::CreateInstance(Adapter adapter)
+{
+	std::pair<int32_t, int32_t> key = std::make_pair(adapter.idLow, adapter.idHigh);
+	std::shared_ptr<std::mutex> creation;
+	{
+		std::lock_guard<std::mutex> lock(m_InstanceMapMutex);
+		auto&                       slot = m_InstanceMap[key];
+		if (auto inst = slot.instance.lock())
+			return inst;
+		if (!slot.creation)
+			slot.creation = std::make_shared<std::mutex>();
+		creation = slot.creation;
+	}
+
+	// Creating a device is slow, only serialize callers that want the same adapter.
+	std::lock_guard<std::mutex> creationLock(*creation);
+	{
+		std::lock_guard<std::mutex> lock(m_InstanceMapMutex);
+		if (auto inst = m_InstanceMap[key].instance.lock())
+			return inst;
+	}
+
+	auto inst = CreateInstanceInternal(adapter);
+	{
+		std::lock_guard<std::mutex> lock(m_InstanceMapMutex);
+		m_InstanceMap[key].instance = inst;
+	}
+	return inst;
+}
+
 // Static API Stuff
 static std::vector<std::shared_ptr<IAPI>> s_APIInstances;
-void                                      Plugin::API::InitializeAPIs()
+static bool                               s_APIInitialized = false;
+static std::mutex                         s_APIMutex;
+
+static void InitializeAPIsInternal()
 {
+	if (s_APIInitialized)
+		return;
+	s_APIInitialized = true;
+
 // DirectX 11
 #ifdef _WIN32
 	if (IsWindows8OrGreater()) {
@@ -134,69 +172,83 @@ void                                      Plugin::API::InitializeAPIs()
 	//}
 }
 
+// Initializes the APIs on first use and returns a copy that is safe to iterate without the lock.
+static std::vector<std::shared_ptr<IAPI>> GetAPIs()
+{
+	const std::lock_guard<std::mutex> lock(s_APIMutex);
+	InitializeAPIsInternal();
+	return s_APIInstances;
+}
+
+void Plugin::API::InitializeAPIs()
+{
+	const std::lock_guard<std::mutex> lock(s_APIMutex);
+	InitializeAPIsInternal();
+}
+
 void Plugin::API::FinalizeAPIs()
 {
+	const std::lock_guard<std::mutex> lock(s_APIMutex);
 	s_APIInstances.clear();
+	s_APIInitialized = false;
 }
 
 size_t Plugin::API::CountAPIs()
 {
-	return s_APIInstances.size();
+	return GetAPIs().size();
 }
 
 std::string Plugin::API::GetAPIName(size_t index)
 {
-	auto indAPI = s_APIInstances.begin();
-	indAPI + index; // Advanced by x elements.
-
-	if (indAPI == s_APIInstances.end())
-		throw std::exception("Invalid API Index");
-
-	return indAPI->get()->GetName();
+	return GetAPI(index)->GetName();
 }
 
 std::shared_ptr<IAPI> Plugin::API::GetAPI(size_t index)
 {
-	auto indAPI = s_APIInstances.begin();
-	indAPI + index; // Advanced by x elements.
-
-	if (indAPI == s_APIInstances.end())
+	auto apis = GetAPIs();
+	if (index >= apis.size())
 		throw std::exception("Invalid API Index");
 
-	return *indAPI;
+	return apis[index];
 }
 
 std::shared_ptr<IAPI> Plugin::API::GetAPI(const std::string& name)
 {
-	for (auto api : s_APIInstances) {
+	auto apis = GetAPIs();
+	for (auto api : apis) {
 		if (name == api->GetName()) {
 			return api;
 		}
 	}
 	// If none was found, return the first one.
-	return *s_APIInstances.begin();
+	if (apis.size() == 0)
+		throw std::exception("No APIs available");
+	return *apis.begin();
 }
 
 std::shared_ptr<IAPI> Plugin::API::GetAPI(Type type)
 {
-	for (auto api : s_APIInstances) {
+	auto apis = GetAPIs();
+	for (auto api : apis) {
 		if (type == api->GetType()) {
 			return api;
 		}
 	}
 	// If none was found, return the first one.
-	return *s_APIInstances.begin();
+	if (apis.size() == 0)
+		throw std::exception("No APIs available");
+	return *apis.begin();
 }
 
 std::vector<std::shared_ptr<IAPI>> Plugin::API::EnumerateAPIs()
 {
-	return std::vector<std::shared_ptr<IAPI>>(s_APIInstances);
+	return GetAPIs();
 }
 
 std::vector<std::string> Plugin::API::EnumerateAPINames()
 {
 	std::vector<std::string> names;
-	for (auto api : s_APIInstances) {
+	for (auto api : GetAPIs()) {
 		names.push_back(api->GetName());
 	}
 	return names;
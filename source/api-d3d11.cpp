@@ -151,7 +151,12 @@ Plugin::API::Direct3D11::Direct3D11()
 		snprintf(buf.data(), buf.size(), "%ls (VEN_%04x/DEV_%04x/SUB_%04x/REV_%04x)", desc.Description, desc.VendorId,
 				 desc.DeviceId, desc.SubSysId, desc.Revision);
 
-		m_AdapterList.emplace_back(desc.AdapterLuid.LowPart, desc.AdapterLuid.HighPart, std::string(buf.data()));
+		// DXGI reports the user mode driver version through this, the interface itself is irrelevant.
+		LARGE_INTEGER driverVersion = LARGE_INTEGER();
+		dxgiAdapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+
+		m_AdapterList.emplace_back(desc.AdapterLuid.LowPart, desc.AdapterLuid.HighPart, std::string(buf.data()),
+								   desc.VendorId, desc.DeviceId, (uint64_t)driverVersion.QuadPart);
 	}
 }
 
@@ -168,17 +173,9 @@ std::vector<Adapter> Plugin::API::Direct3D11::EnumerateAdapters()
 	return m_AdapterList;
 }
 
-std::shared_ptr<Instance> Plugin::API::Direct3D11::CreateInstance(Adapter adapter)
+std::shared_ptr<Instance> Plugin::API::Direct3D11::CreateInstanceInternal(Adapter adapter)
 {
-	//std::lock_guard<std::mutex> lock(m_InstanceMapMutex);
-	//std::pair<int32_t, int32_t> key = std::make_pair(adapter.idLow, adapter.idHigh);
-	//auto inst = m_InstanceMap.find(key);
-	//if (inst != m_InstanceMap.end())
-	//	return inst->second;
-
-	auto inst2 = std::make_shared<Direct3D11Instance>(this, adapter);
-	//m_InstanceMap.insert_or_assign(key, inst2);
-	return inst2;
+	return std::make_shared<Direct3D11Instance>(this, adapter);
 }
 
 Plugin::API::Type Plugin::API::Direct3D11::GetType()
@@ -247,16 +244,19 @@ Plugin::API::Direct3D11Instance::Direct3D11Instance(Direct3D11* api, Adapter ada
 		snprintf(buf.data(), buf.size(), "<" __FUNCTION_NAME__ "> Unable to create D3D11 device, error code %X.", hr);
 		throw std::exception(buf.data());
 	}
+
+	// The device is shared by every encoder on this adapter, so the immediate context needs protection.
+	ATL::CComPtr<ID3D10Multithread> multithread;
+	if (SUCCEEDED(m_Device->QueryInterface(__uuidof(ID3D10Multithread), (void**)&multithread)))
+		multithread->SetMultithreadProtected(TRUE);
 }
 
 Plugin::API::Direct3D11Instance::~Direct3D11Instance()
 {
+	if (m_DeviceContext)
+		m_DeviceContext->Release();
 	if (m_Device)
 		m_Device->Release();
-
-	//std::lock_guard<std::mutex> lock(m_API->m_InstanceMapMutex);
-	//std::pair<int32_t, int32_t> key = std::make_pair(m_Adapter.idLow, m_Adapter.idHigh);
-	//m_API->m_InstanceMap.erase(key);
 }
 
 Plugin::API::Adapter Plugin::API::Direct3D11Instance::GetAdapter()
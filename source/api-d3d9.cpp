@@ -60,13 +60,14 @@ Plugin::API::Direct3D9::Direct3D9()
 				 adapterIdentifier.VendorId, adapterIdentifier.DeviceId, adapterIdentifier.SubSysId,
 				 adapterIdentifier.Revision);
 
-		m_Adapters.emplace_back(Adapter(adapterLUID.LowPart, adapterLUID.HighPart, std::string(buf.data())));
+		m_Adapters.emplace_back(Adapter(adapterLUID.LowPart, adapterLUID.HighPart, std::string(buf.data()),
+										adapterIdentifier.VendorId, adapterIdentifier.DeviceId,
+										(uint64_t)adapterIdentifier.DriverVersion.QuadPart));
 	}
 }
 
 Plugin::API::Direct3D9::~Direct3D9()
 {
-	//m_InstanceMap.clear(); // Need to destroy IDirect3D9Device9Ex before IDirect3D9Ex.
 	m_Direct3D9Ex->Release();
 }
 
@@ -85,16 +86,9 @@ std::vector<Adapter> Plugin::API::Direct3D9::EnumerateAdapters()
 	return m_Adapters;
 }
 
-std::shared_ptr<Instance> Plugin::API::Direct3D9::CreateInstance(Adapter adapter)
+std::shared_ptr<Instance> Plugin::API::Direct3D9::CreateInstanceInternal(Adapter adapter)
 {
-	//std::pair<int32_t, int32_t> key = std::make_pair(adapter.idLow, adapter.idHigh);
-	//auto inst = m_InstanceMap.find(key);
-	//if (inst != m_InstanceMap.end())
-	//	return inst->second;
-
-	auto inst2 = std::make_shared<Direct3D9Instance>(this, adapter);
-	//m_InstanceMap.insert_or_assign(key, inst2);
-	return inst2;
+	return std::make_shared<Direct3D9Instance>(this, adapter);
 }
 
 Plugin::API::Direct3D9Instance::Direct3D9Instance(Direct3D9* api, Adapter adapter) : m_API(api), m_Adapter(adapter)
@@ -159,9 +153,6 @@ Plugin::API::Direct3D9Instance::Direct3D9Instance(Direct3D9* api, Adapter adapte
 
 Plugin::API::Direct3D9Instance::~Direct3D9Instance()
 {
-	//std::pair<int32_t, int32_t> key = std::make_pair(m_Adapter.idLow, m_Adapter.idHigh);
-	//m_API->m_InstanceMap.erase(key);
-
 	//m_Device->Release(); // Can't release/free on AMD hardware?
 }
 
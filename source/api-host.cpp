@@ -38,7 +38,7 @@ std::vector<Adapter> Plugin::API::Host::EnumerateAdapters()
 	return list;
 }
 
-std::shared_ptr<Instance> Plugin::API::Host::CreateInstance(Adapter adapter)
+std::shared_ptr<Instance> Plugin::API::Host::CreateInstanceInternal(Adapter adapter)
 {
 	return std::make_unique<HostInstance>();
 }
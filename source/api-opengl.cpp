@@ -48,7 +48,7 @@ std::vector<Adapter> Plugin::API::OpenGL::EnumerateAdapters()
 	return adapters;
 }
 
-std::shared_ptr<Instance> Plugin::API::OpenGL::CreateInstance(Adapter adapter)
+std::shared_ptr<Instance> Plugin::API::OpenGL::CreateInstanceInternal(Adapter adapter)
 {
 	// ToDo: Actually create a hidden window and OpenGL context. Not that it is going to be useful.
 	return std::make_unique<OpenGLInstance>();
@@ -0,0 +1,140 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "bitrate-controller.hpp"
+#include <cmath>
+
+Plugin::BitrateController::BitrateController() : BitrateController(Settings()) {}
+
+Plugin::BitrateController::BitrateController(const Settings& settings)
+{
+	m_Settings      = settings;
+	m_TargetBitrate = 0;
+	m_PeakBitrate   = 0;
+	m_VBVBufferSize = 0;
+	m_Factor        = 1.0;
+	m_Pending       = false;
+	m_Congestion    = 0;
+	m_Dropped       = 0;
+	m_Total         = 0;
+	m_Bandwidth     = 0;
+	m_Running       = false;
+	m_LastDecision  = 0;
+	m_LastChange    = 0;
+	m_LowSince      = 0;
+}
+
+void Plugin::BitrateController::Configure(uint64_t targetBitrate, uint64_t peakBitrate, uint64_t vbvBufferSize)
+{
+	m_TargetBitrate = targetBitrate;
+	m_PeakBitrate   = peakBitrate;
+	m_VBVBufferSize = vbvBufferSize;
+	m_Pending       = (m_Factor < 1.0);
+}
+
+void Plugin::BitrateController::ReportCongestion(double congestion)
+{
+	if (congestion > m_Congestion)
+		m_Congestion = (congestion < 1.0) ? congestion : 1.0;
+}
+
+void Plugin::BitrateController::ReportDroppedFrames(uint64_t dropped, uint64_t total)
+{
+	// Counters start over with a new output.
+	if ((dropped >= m_Dropped) && (total > m_Total)) {
+		ReportCongestion((double)(dropped - m_Dropped) / (double)(total - m_Total) * m_Settings.dropWeight);
+	}
+	m_Dropped = dropped;
+	m_Total   = total;
+}
+
+void Plugin::BitrateController::ReportBandwidth(uint64_t bitsPerSecond)
+{
+	m_Bandwidth = bitsPerSecond;
+}
+
+bool Plugin::BitrateController::Update(uint64_t now)
+{
+	if (!m_Running) {
+		m_Running      = true;
+		m_LastDecision = now;
+		m_LastChange   = now;
+		m_LowSince     = now;
+	}
+	if (m_TargetBitrate == 0)
+		return false;
+
+	bool changed = m_Pending;
+	m_Pending    = false;
+	if ((now - m_LastDecision) < m_Settings.interval)
+		return changed;
+	m_LastDecision = now;
+
+	double congestion = m_Congestion;
+	double factor     = m_Factor;
+	m_Congestion      = 0;
+	if (congestion > m_Settings.congestionHigh) {
+		factor     = m_Factor * (1.0 - m_Settings.decreaseStep);
+		m_LowSince = now;
+	} else if (congestion >= m_Settings.congestionLow) {
+		m_LowSince = now;
+	} else if (((now - m_LowSince) >= m_Settings.recoveryDelay)
+			   && ((now - m_LastChange) >= m_Settings.increaseInterval)) {
+		factor = m_Factor + m_Settings.increaseStep;
+	}
+
+	// An estimate only ever limits, getting back up still goes through the recovery above.
+	if (m_Bandwidth > 0) {
+		double limit   = (double)m_Bandwidth * m_Settings.bandwidthHeadroom / (double)m_TargetBitrate;
+		double slowest = m_Factor * (1.0 - m_Settings.decreaseStep);
+		if (factor > limit)
+			factor = (limit > slowest) ? limit : (factor < slowest ? factor : slowest);
+	}
+
+	if (factor < m_Settings.minimumFactor)
+		factor = m_Settings.minimumFactor;
+	if (factor > 1.0)
+		factor = 1.0;
+	if (std::fabs(factor - m_Factor) < 0.001)
+		return changed;
+
+	m_Factor     = factor;
+	m_LastChange = now;
+	return true;
+}
+
+uint64_t Plugin::BitrateController::GetTargetBitrate()
+{
+	return (uint64_t)((double)m_TargetBitrate * m_Factor);
+}
+
+uint64_t Plugin::BitrateController::GetPeakBitrate()
+{
+	return (uint64_t)((double)m_PeakBitrate * m_Factor);
+}
+
+uint64_t Plugin::BitrateController::GetVBVBufferSize()
+{
+	return (uint64_t)((double)m_VBVBufferSize * m_Factor);
+}
+
+double Plugin::BitrateController::GetFactor()
+{
+	return m_Factor;
+}
@@ -0,0 +1,79 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "clock.hpp"
+#include <mutex>
+#include <thread>
+#ifdef PLUGIN_CLOCK_TSC
+#ifndef _MSC_VER
+#include <cpuid.h>
+#endif
+#endif
+
+bool   Plugin::Clock::Internal::UseTSC = false;
+double Plugin::Clock::Internal::NanosecondsPerTick =
+	(double)std::chrono::steady_clock::period::num * 1000000000.0 / (double)std::chrono::steady_clock::period::den;
+
+#ifdef PLUGIN_CLOCK_TSC
+static bool HasInvariantTSC()
+{
+	uint32_t regs[4] = {0, 0, 0, 0};
+#ifdef _MSC_VER
+	__cpuid((int*)regs, 0x80000000);
+	if (regs[0] < 0x80000007)
+		return false;
+	__cpuid((int*)regs, 0x80000007);
+#else
+	if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007)
+		return false;
+	__get_cpuid(0x80000007, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+	// EDX Bit 8: TSC runs at a constant rate in all ACPI P-, C- and T-states.
+	return (regs[3] & (1 << 8)) != 0;
+}
+#endif
+
+void Plugin::Clock::Initialize()
+{
+	static std::once_flag once;
+	std::call_once(once, [] {
+#ifdef PLUGIN_CLOCK_TSC
+		if (!HasInvariantTSC())
+			return;
+
+		auto     t0 = std::chrono::steady_clock::now();
+		uint64_t c0 = __rdtsc();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		auto     t1 = std::chrono::steady_clock::now();
+		uint64_t c1 = __rdtsc();
+
+		double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+		if ((c1 <= c0) || (ns <= 0))
+			return;
+
+		Internal::NanosecondsPerTick = ns / (double)(c1 - c0);
+		Internal::UseTSC             = true;
+#endif
+	});
+}
+
+bool Plugin::Clock::IsTSC()
+{
+	return Internal::UseTSC;
+}
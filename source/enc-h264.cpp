@@ -20,9 +20,12 @@
 #include "enc-h264.hpp"
 #include "amf-capabilities.hpp"
 #include "amf-encoder-h264.hpp"
+#include "amf-encoder-pool.hpp"
+#include "clock.hpp"
 #include "strings.hpp"
 #include "utility.hpp"
 
+#define ENCODER_ID "amd_amf_h264"
 #define PREFIX "[H264/AVC]"
 
 using namespace Plugin;
@@ -32,8 +35,9 @@ using namespace Utility;
 
 void Plugin::Interface::H264Interface::encoder_register()
 {
-	// Test if we actually have AVC support.
-	if (!AMD::CapabilityManager::Instance()->IsCodecSupported(Codec::AVC)) {
+	// Registration has to stay cheap, so only skip it if a previous run found no AVC support at all. The adapters
+	// are tested once the encoder is actually used.
+	if (AMD::CapabilityManager::IsCodecKnownUnsupported(Codec::AVC)) {
 		PLOG_WARNING(PREFIX " Not supported by any GPU, disabling...");
 		return;
 	}
@@ -44,7 +48,7 @@ void Plugin::Interface::H264Interface::encoder_register()
 
 	// Initialize Structure
 	encoder_info->type               = obs_encoder_type::OBS_ENCODER_VIDEO;
-	static const char* encoder_name  = "amd_amf_h264";
+	static const char* encoder_name  = ENCODER_ID;
 	encoder_info->id                 = encoder_name;
 	static const char* encoder_codec = "h264";
 	encoder_info->codec              = encoder_codec;
@@ -118,6 +122,10 @@ void Plugin::Interface::H264Interface::get_defaults(obs_data_t* data)
 	//obs_data_set_default_frames_per_second(data, P_ASPECTRATIO, media_frames_per_second{ 1, 1 }, "");
 	obs_data_set_default_int(data, P_CODINGTYPE, static_cast<int64_t>(CodingType::Automatic));
 	obs_data_set_default_int(data, P_MAXIMUMREFERENCEFRAMES, 4);
+	obs_data_set_default_int(data, ("last" P_TEMPORALLAYERS), -1);
+	obs_data_set_default_int(data, P_TEMPORALLAYERS, 1);
+	obs_data_set_default_int(data, P_TEMPORALLAYERS_QPDELTA, 2);
+	obs_data_set_default_int(data, P_TEMPORALLAYERS_BASESHARE, 50);
 
 	// Rate Control Properties
 	obs_data_set_default_int(data, ("last" P_RATECONTROLMETHOD), -1);
@@ -128,14 +136,18 @@ void Plugin::Interface::H264Interface::get_defaults(obs_data_t* data)
 	obs_data_set_default_int(data, P_QP_IFRAME, 22);
 	obs_data_set_default_int(data, P_QP_PFRAME, 22);
 	obs_data_set_default_int(data, P_QP_BFRAME, 22);
+	obs_data_set_default_int(data, P_LOOKAHEAD, 0);
 	obs_data_set_default_int(data, P_QP_MINIMUM, 18);
 	obs_data_set_default_int(data, P_QP_MAXIMUM, 51);
 	obs_data_set_default_int(data, P_FILLERDATA, 1);
 	obs_data_set_default_int(data, P_FRAMESKIPPING, 0);
 	obs_data_set_default_int(data, P_FRAMESKIPPING_PERIOD, 0);
 	obs_data_set_default_int(data, P_FRAMESKIPPING_BEHAVIOUR, 0);
+	obs_data_set_default_int(data, P_FRAMESKIPPING_STATIC, 0);
 	obs_data_set_default_int(data, P_VBAQ, 0);
 	obs_data_set_default_int(data, P_ENFORCEHRD, 1);
+	obs_data_set_default_int(data, P_ADAPTIVEBITRATE, 0);
+	obs_data_set_default_int(data, P_HRDMODEL, static_cast<int64_t>(HRDModelMode::Disabled));
 
 	// VBV Buffer
 	obs_data_set_default_int(data, ("last" P_VBVBUFFER), -1);
@@ -147,12 +159,16 @@ void Plugin::Interface::H264Interface::get_defaults(obs_data_t* data)
 	// Picture Control
 	obs_data_set_default_double(data, P_INTERVAL_KEYFRAME, 2.0);
 	obs_data_set_default_int(data, P_PERIOD_IDR_H264, 0);
+	obs_data_set_default_double(data, P_INTERVAL_SEGMENT, 0.0);
+	obs_data_set_default_double(data, P_INTRAREFRESH, 0.0);
 	obs_data_set_default_double(data, P_INTERVAL_IFRAME, 0.0);
 	obs_data_set_default_int(data, P_PERIOD_IFRAME, 0);
 	obs_data_set_default_double(data, P_INTERVAL_PFRAME, 0.0);
 	obs_data_set_default_int(data, P_PERIOD_PFRAME, 0);
 	obs_data_set_default_double(data, P_INTERVAL_BFRAME, 0.0);
 	obs_data_set_default_int(data, P_PERIOD_BFRAME, 0);
+	obs_data_set_default_int(data, P_SCENECUT, static_cast<int64_t>(SceneCutMode::Disabled));
+	obs_data_set_default_int(data, P_SCENECUT_DISTANCE, 15);
 	obs_data_set_default_int(data, ("last" P_BFRAME_PATTERN), -1);
 	obs_data_set_default_int(data, P_BFRAME_PATTERN, 0);
 	obs_data_set_default_int(data, ("last" P_BFRAME_REFERENCE), -1);
@@ -171,6 +187,7 @@ void Plugin::Interface::H264Interface::get_defaults(obs_data_t* data)
 	obs_data_set_default_int(data, P_OPENCL_CONVERSION, 0);
 	obs_data_set_default_int(data, P_MULTITHREADING, 0);
 	obs_data_set_default_int(data, P_QUEUESIZE, 8);
+	obs_data_set_default_int(data, P_PREROLL, 0);
 	obs_data_set_default_int(data, ("last" P_VIEW), -1);
 	obs_data_set_default_int(data, P_VIEW, static_cast<int64_t>(ViewMode::Basic));
 	obs_data_set_default_bool(data, P_DEBUG, false);
@@ -278,6 +295,18 @@ obs_properties_t* Plugin::Interface::H264Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_MAXIMUMREFERENCEFRAMES)));
 #pragma endregion Maximum Reference Frames
 
+#pragma region Temporal Layers
+	p = obs_properties_add_int_slider(props, P_TEMPORALLAYERS, P_TRANSLATE(P_TEMPORALLAYERS), 1,
+									  TemporalLayers::MAXIMUM, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_TEMPORALLAYERS)));
+	obs_property_set_modified_callback(p, properties_modified);
+	p = obs_properties_add_int_slider(props, P_TEMPORALLAYERS_QPDELTA, P_TRANSLATE(P_TEMPORALLAYERS_QPDELTA), 0, 10, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_TEMPORALLAYERS_QPDELTA)));
+	p = obs_properties_add_int_slider(props, P_TEMPORALLAYERS_BASESHARE, P_TRANSLATE(P_TEMPORALLAYERS_BASESHARE), 10,
+									  100, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_TEMPORALLAYERS_BASESHARE)));
+#pragma endregion Temporal Layers
+
 	// Rate Control
 #pragma region Rate Control Method
 	p = obs_properties_add_list(props, P_RATECONTROLMETHOD, P_TRANSLATE(P_RATECONTROLMETHOD), OBS_COMBO_TYPE_LIST,
@@ -322,6 +351,8 @@ obs_properties_t* Plugin::Interface::H264Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_QP_PFRAME)));
 	p = obs_properties_add_int_slider(props, P_QP_BFRAME, P_TRANSLATE(P_QP_BFRAME), 0, 51, 1);
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_QP_BFRAME)));
+	p = obs_properties_add_int_slider(props, P_LOOKAHEAD, P_TRANSLATE(P_LOOKAHEAD), 0, 32, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_LOOKAHEAD)));
 #pragma endregion Parameters
 
 #pragma region Filler Data
@@ -345,6 +376,8 @@ obs_properties_t* Plugin::Interface::H264Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_FRAMESKIPPING_BEHAVIOUR)));
 	obs_property_list_add_int(p, P_TRANSLATE(P_FRAMESKIPPING_SKIPNTH), 0);
 	obs_property_list_add_int(p, P_TRANSLATE(P_FRAMESKIPPING_KEEPNTH), 1);
+	p = obs_properties_add_int_slider(props, P_FRAMESKIPPING_STATIC, P_TRANSLATE(P_FRAMESKIPPING_STATIC), 0, 300, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_FRAMESKIPPING_STATIC)));
 #pragma endregion Frame Skipping
 
 #pragma region VBAQ
@@ -362,6 +395,22 @@ obs_properties_t* Plugin::Interface::H264Interface::get_properties(void* data)
 	obs_property_list_add_int(p, P_TRANSLATE(P_UTIL_SWITCH_ENABLED), 1);
 #pragma endregion Enforce Hyptothetical Reference Decoder Restrictions
 
+#pragma region Adaptive Bitrate
+	p = obs_properties_add_list(props, P_ADAPTIVEBITRATE, P_TRANSLATE(P_ADAPTIVEBITRATE), OBS_COMBO_TYPE_LIST,
+								OBS_COMBO_FORMAT_INT);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_ADAPTIVEBITRATE)));
+	obs_property_list_add_int(p, P_TRANSLATE(P_UTIL_SWITCH_DISABLED), 0);
+	obs_property_list_add_int(p, P_TRANSLATE(P_UTIL_SWITCH_ENABLED), 1);
+#pragma endregion Adaptive Bitrate
+
+#pragma region Decoder Buffer Model
+	p = obs_properties_add_list(props, P_HRDMODEL, P_TRANSLATE(P_HRDMODEL), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_HRDMODEL)));
+	obs_property_list_add_int(p, P_TRANSLATE(P_UTIL_SWITCH_DISABLED), static_cast<int64_t>(HRDModelMode::Disabled));
+	obs_property_list_add_int(p, P_TRANSLATE(P_HRDMODEL_MONITOR), static_cast<int64_t>(HRDModelMode::Monitor));
+	obs_property_list_add_int(p, P_TRANSLATE(P_HRDMODEL_FEEDBACK), static_cast<int64_t>(HRDModelMode::Feedback));
+#pragma endregion Decoder Buffer Model
+
 	// VBV Buffer
 #pragma region VBV Buffer Mode
 	p = obs_properties_add_list(props, P_VBVBUFFER, P_TRANSLATE(P_VBVBUFFER), OBS_COMBO_TYPE_LIST,
@@ -396,6 +445,10 @@ obs_properties_t* Plugin::Interface::H264Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_INTERVAL_KEYFRAME)));
 	p = obs_properties_add_int(props, P_PERIOD_IDR_H264, P_TRANSLATE(P_PERIOD_IDR_H264), 0, 1000, 1);
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_PERIOD_IDR_H264)));
+	p = obs_properties_add_float(props, P_INTERVAL_SEGMENT, P_TRANSLATE(P_INTERVAL_SEGMENT), 0, 60, 0.001);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_INTERVAL_SEGMENT)));
+	p = obs_properties_add_float(props, P_INTRAREFRESH, P_TRANSLATE(P_INTRAREFRESH), 0, 10, 0.001);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_INTRAREFRESH)));
 	/// I-Frame
 	p = obs_properties_add_float(props, P_INTERVAL_IFRAME, P_TRANSLATE(P_INTERVAL_IFRAME), 0, 100, 0.001);
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_INTERVAL_IFRAME)));
@@ -413,6 +466,16 @@ obs_properties_t* Plugin::Interface::H264Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_PERIOD_BFRAME)));
 #pragma endregion Interval and Periods
 
+#pragma region Scene Cut
+	p = obs_properties_add_list(props, P_SCENECUT, P_TRANSLATE(P_SCENECUT), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_SCENECUT)));
+	obs_property_list_add_int(p, P_TRANSLATE(P_UTIL_SWITCH_DISABLED), static_cast<int64_t>(SceneCutMode::Disabled));
+	obs_property_list_add_int(p, P_TRANSLATE(P_SCENECUT_IFRAME), static_cast<int64_t>(SceneCutMode::IFrame));
+	obs_property_list_add_int(p, P_TRANSLATE(P_SCENECUT_IDRFRAME), static_cast<int64_t>(SceneCutMode::IDRFrame));
+	p = obs_properties_add_int_slider(props, P_SCENECUT_DISTANCE, P_TRANSLATE(P_SCENECUT_DISTANCE), 1, 300, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_SCENECUT_DISTANCE)));
+#pragma endregion Scene Cut
+
 #pragma region B - Frames Pattern
 	p = obs_properties_add_int_slider(props, P_BFRAME_PATTERN, P_TRANSLATE(P_BFRAME_PATTERN), 0, 3, 1);
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_BFRAME_PATTERN)));
@@ -496,6 +559,9 @@ obs_properties_t* Plugin::Interface::H264Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_QUEUESIZE)));
 #pragma endregion Asynchronous Queue
 
+	p = obs_properties_add_int_slider(props, P_PREROLL, P_TRANSLATE(P_PREROLL), 0, 30, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_PREROLL)));
+
 #pragma region View Mode
 	p = obs_properties_add_list(props, P_VIEW, P_TRANSLATE(P_VIEW), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_VIEW)));
@@ -637,15 +703,21 @@ bool Plugin::Interface::H264Interface::properties_modified(obs_properties_t* pro
 		} adapterid  = {videoAdapter_cur};
 		auto adapter = api->GetAdapterById(adapterid.id[0], adapterid.id[1]);
 		try {
-			auto enc = EncoderH264(api, adapter);
+			// Read from the snapshot taken at load, creating an encoder here would open a session on the GPU.
+			auto caps = CapabilityManager::Instance()->GetSnapshot(Codec::AVC, api->GetType(), adapter);
+			if (!caps) {
+				QUICK_FORMAT_MESSAGE(errMsg, "Adapter '%s' does not support %s.", adapter.Name.c_str(),
+									 Utility::CodecToString(Codec::AVC));
+				throw std::exception(errMsg.c_str());
+			}
 
 #define TEMP_LIMIT_DROPDOWN(func, enm, prop)                                             \
 	{                                                                                    \
 		auto tmp_p = obs_properties_get(props, prop);                                    \
-		auto tmp_l = enc.func();                                                         \
+		auto tmp_l = caps->func;                                                         \
 		enm  tmp_s = static_cast<enm>(obs_data_get_int(data, obs_property_name(tmp_p))); \
 		for (size_t idx = 0; idx < obs_property_list_item_count(tmp_p); idx++) {         \
-			bool enabled = false;                                                        \
+			bool enabled = tmp_l.empty(); /* Not reported, so not restricted either. */  \
 			enm  tmp_v   = static_cast<enm>(obs_property_list_item_int(tmp_p, idx));     \
 			for (auto tmp_k : tmp_l) {                                                   \
 				if (tmp_k == tmp_v) {                                                    \
@@ -658,43 +730,45 @@ bool Plugin::Interface::H264Interface::properties_modified(obs_properties_t* pro
 				obs_data_unset_user_value(data, obs_property_name(tmp_p));               \
 		}                                                                                \
 	}
-#define TEMP_LIMIT_SLIDER(func, prop)                                               \
-	{                                                                               \
-		auto tmp_p = obs_properties_get(props, prop);                               \
-		auto tmp_l = enc.func();                                                    \
-		obs_property_int_set_limits(tmp_p, (int)tmp_l.first, (int)tmp_l.second, 1); \
+#define TEMP_LIMIT_SLIDER(func, prop)                                                   \
+	{                                                                                   \
+		auto tmp_p = obs_properties_get(props, prop);                                   \
+		auto tmp_l = caps->func;                                                        \
+		if (tmp_l.second > 0)                                                           \
+			obs_property_int_set_limits(tmp_p, (int)tmp_l.first, (int)tmp_l.second, 1); \
 	}
-#define TEMP_LIMIT_SLIDER_BITRATE(func, prop)                                                     \
-	{                                                                                             \
-		auto tmp_p = obs_properties_get(props, prop);                                             \
-		auto tmp_l = enc.func();                                                                  \
-		obs_property_int_set_limits(tmp_p, (int)tmp_l.first / 1000, (int)tmp_l.second / 1000, 1); \
+#define TEMP_LIMIT_SLIDER_BITRATE(func, prop)                                                         \
+	{                                                                                                 \
+		auto tmp_p = obs_properties_get(props, prop);                                                 \
+		auto tmp_l = caps->func;                                                                      \
+		if (tmp_l.second > 0)                                                                         \
+			obs_property_int_set_limits(tmp_p, (int)tmp_l.first / 1000, (int)tmp_l.second / 1000, 1); \
 	}
 
-			//TEMP_LIMIT_DROPDOWN(CapsUsage, AMD::Usage, P_USAGE);
-			TEMP_LIMIT_DROPDOWN(CapsQualityPreset, AMD::QualityPreset, P_QUALITYPRESET);
-			TEMP_LIMIT_DROPDOWN(CapsProfile, AMD::Profile, P_PROFILE);
-			TEMP_LIMIT_DROPDOWN(CapsProfileLevel, AMD::ProfileLevel, P_PROFILELEVEL);
+			//TEMP_LIMIT_DROPDOWN(usage, AMD::Usage, P_USAGE);
+			TEMP_LIMIT_DROPDOWN(qualityPreset, AMD::QualityPreset, P_QUALITYPRESET);
+			TEMP_LIMIT_DROPDOWN(profile, AMD::Profile, P_PROFILE);
+			TEMP_LIMIT_DROPDOWN(profileLevel, AMD::ProfileLevel, P_PROFILELEVEL);
 			{
 				auto tmp_p = obs_properties_get(props, P_PROFILELEVEL);
 				obs_property_list_item_disable(tmp_p, 0, false);
 			}
-			TEMP_LIMIT_DROPDOWN(CapsCodingType, AMD::CodingType, P_CODINGTYPE);
-			TEMP_LIMIT_SLIDER(CapsMaximumReferenceFrames, P_MAXIMUMREFERENCEFRAMES);
-			TEMP_LIMIT_DROPDOWN(CapsRateControlMethod, AMD::RateControlMethod, P_RATECONTROLMETHOD);
-			try {
-				TEMP_LIMIT_DROPDOWN(CapsPrePassMode, AMD::PrePassMode, P_PREPASSMODE);
+			TEMP_LIMIT_DROPDOWN(codingType, AMD::CodingType, P_CODINGTYPE);
+			TEMP_LIMIT_SLIDER(maximumReferenceFrames, P_MAXIMUMREFERENCEFRAMES);
+			TEMP_LIMIT_DROPDOWN(rateControlMethod, AMD::RateControlMethod, P_RATECONTROLMETHOD);
+			if (caps->prePassMode.size() > 0) {
+				TEMP_LIMIT_DROPDOWN(prePassMode, AMD::PrePassMode, P_PREPASSMODE);
 				obs_property_set_enabled(obs_properties_get(props, P_PREPASSMODE), true);
-			} catch (...) {
+			} else {
 				obs_property_set_enabled(obs_properties_get(props, P_PREPASSMODE), false);
 			}
 
-			TEMP_LIMIT_SLIDER_BITRATE(CapsTargetBitrate, "bitrate");
-			TEMP_LIMIT_SLIDER_BITRATE(CapsPeakBitrate, P_BITRATE_PEAK);
-			TEMP_LIMIT_SLIDER_BITRATE(CapsVBVBufferSize, P_VBVBUFFER_SIZE);
+			TEMP_LIMIT_SLIDER_BITRATE(targetBitrate, "bitrate");
+			TEMP_LIMIT_SLIDER_BITRATE(peakBitrate, P_BITRATE_PEAK);
+			TEMP_LIMIT_SLIDER_BITRATE(vbvBufferSize, P_VBVBUFFER_SIZE);
 			{
 				auto bframep    = obs_properties_get(props, P_BFRAME_PATTERN);
-				auto bframecaps = enc.CapsBFramePattern();
+				auto bframecaps = caps->bFramePattern;
 				obs_property_int_set_limits(bframep, 0, (int)bframecaps, 1);
 				if (obs_data_get_int(data, obs_property_name(bframep)) > bframecaps) {
 					obs_data_set_int(data, obs_property_name(bframep), bframecaps);
@@ -967,6 +1041,9 @@ bool Plugin::Interface::H264Interface::properties_modified(obs_properties_t* pro
 		std::make_pair(P_ASPECTRATIO, ViewMode::Master),
 		std::make_pair(P_CODINGTYPE, ViewMode::Expert),
 		std::make_pair(P_MAXIMUMREFERENCEFRAMES, ViewMode::Expert),
+		std::make_pair(P_TEMPORALLAYERS, ViewMode::Advanced),
+		std::make_pair(P_TEMPORALLAYERS_QPDELTA, ViewMode::Advanced),
+		std::make_pair(P_TEMPORALLAYERS_BASESHARE, ViewMode::Advanced),
 		// ----------- Rate Control Section
 		std::make_pair(P_RATECONTROLMETHOD, ViewMode::Basic),
 		//std::make_pair(P_PREPASSMODE, ViewMode::Basic),
@@ -981,8 +1058,11 @@ bool Plugin::Interface::H264Interface::properties_modified(obs_properties_t* pro
 		std::make_pair(P_FRAMESKIPPING, ViewMode::Advanced),
 		std::make_pair(P_FRAMESKIPPING_PERIOD, ViewMode::Master),
 		std::make_pair(P_FRAMESKIPPING_BEHAVIOUR, ViewMode::Master),
+		std::make_pair(P_FRAMESKIPPING_STATIC, ViewMode::Advanced),
 		//std::make_pair(P_VBAQ, ViewMode::Expert),
 		std::make_pair(P_ENFORCEHRD, ViewMode::Expert),
+		std::make_pair(P_ADAPTIVEBITRATE, ViewMode::Advanced),
+		std::make_pair(P_HRDMODEL, ViewMode::Advanced),
 		// ----------- VBV Buffer
 		std::make_pair(P_VBVBUFFER, ViewMode::Advanced),
 		//std::make_pair(P_VBVBUFFER_STRICTNESS, ViewMode::Advanced),
@@ -991,12 +1071,16 @@ bool Plugin::Interface::H264Interface::properties_modified(obs_properties_t* pro
 		// ----------- Picture Control
 		std::make_pair(P_INTERVAL_KEYFRAME, ViewMode::Basic),
 		std::make_pair(P_PERIOD_IDR_H264, ViewMode::Master),
+		std::make_pair(P_INTERVAL_SEGMENT, ViewMode::Advanced),
+		std::make_pair(P_INTRAREFRESH, ViewMode::Advanced),
 		std::make_pair(P_INTERVAL_IFRAME, ViewMode::Master),
 		std::make_pair(P_PERIOD_IFRAME, ViewMode::Master),
 		std::make_pair(P_INTERVAL_PFRAME, ViewMode::Master),
 		std::make_pair(P_PERIOD_PFRAME, ViewMode::Master),
 		//std::make_pair(P_INTERVAL_BFRAME, ViewMode::Master),
 		//std::make_pair(P_PERIOD_BFRAME, ViewMode::Master),
+		std::make_pair(P_SCENECUT, ViewMode::Advanced),
+		std::make_pair(P_SCENECUT_DISTANCE, ViewMode::Advanced),
 		std::make_pair(P_BFRAME_PATTERN, ViewMode::Advanced),
 		std::make_pair(P_BFRAME_DELTAQP, ViewMode::Advanced),
 		std::make_pair(P_BFRAME_REFERENCE, ViewMode::Advanced),
@@ -1012,6 +1096,7 @@ bool Plugin::Interface::H264Interface::properties_modified(obs_properties_t* pro
 		std::make_pair(P_OPENCL_CONVERSION, ViewMode::Advanced),
 		std::make_pair(P_MULTITHREADING, ViewMode::Expert),
 		std::make_pair(P_QUEUESIZE, ViewMode::Expert),
+		std::make_pair(P_PREROLL, ViewMode::Expert),
 		std::make_pair(P_VIEW, ViewMode::Basic),
 		std::make_pair(P_DEBUG, ViewMode::Basic),
 	};
@@ -1111,6 +1196,7 @@ bool Plugin::Interface::H264Interface::properties_modified(obs_properties_t* pro
 	obs_property_set_visible(obs_properties_get(props, P_QP_BFRAME), vis_rcm_qp_b);
 	if (!vis_rcm_qp_b)
 		obs_data_unset_user_value(data, P_QP_BFRAME);
+	obs_property_set_visible(obs_properties_get(props, P_LOOKAHEAD), (curView >= ViewMode::Advanced) && vis_rcm_qp);
 
 	/// QP Min/Max
 	obs_property_set_visible(obs_properties_get(props, P_QP_MINIMUM), (curView >= ViewMode::Advanced) && !vis_rcm_qp);
@@ -1155,6 +1241,38 @@ bool Plugin::Interface::H264Interface::properties_modified(obs_properties_t* pro
 		obs_data_unset_user_value(data, P_VBVBUFFER_STRICTNESS);
 #pragma endregion VBV Buffer
 
+#pragma region Temporal Layers
+	{
+		// Only the SVC encoder does temporal layers, hide them if the adapter doesn't have it.
+		auto api = Plugin::API::GetAPI(obs_data_get_string(data, P_VIDEO_API));
+		union {
+			int64_t  v;
+			uint32_t id[2];
+		} adapterid       = {obs_data_get_int(data, P_VIDEO_ADAPTER)};
+		auto adapter      = api->GetAdapterById(adapterid.id[0], adapterid.id[1]);
+		bool svcSupported = CapabilityManager::Instance()->IsCodecSupportedByAPIAdapter(Codec::SVC, api->GetType(),
+																						 adapter);
+		bool layersPropertyVisible = (curView >= ViewMode::Advanced) && svcSupported;
+		obs_property_set_visible(obs_properties_get(props, P_TEMPORALLAYERS), layersPropertyVisible);
+		if (!layersPropertyVisible)
+			obs_data_unset_user_value(data, P_TEMPORALLAYERS);
+	}
+
+	int64_t temporalLayers = obs_data_get_int(data, P_TEMPORALLAYERS);
+	if (obs_data_get_int(data, ("last" P_TEMPORALLAYERS)) != temporalLayers) {
+		obs_data_set_int(data, ("last" P_TEMPORALLAYERS), temporalLayers);
+		result = true;
+	}
+
+	bool layersVisible = (curView >= ViewMode::Advanced) && (temporalLayers > 1);
+	obs_property_set_visible(obs_properties_get(props, P_TEMPORALLAYERS_QPDELTA), layersVisible && vis_rcm_qp);
+	obs_property_set_visible(obs_properties_get(props, P_TEMPORALLAYERS_BASESHARE), layersVisible && !vis_rcm_qp);
+	if (!layersVisible || !vis_rcm_qp)
+		obs_data_unset_user_value(data, P_TEMPORALLAYERS_QPDELTA);
+	if (!layersVisible || vis_rcm_qp)
+		obs_data_unset_user_value(data, P_TEMPORALLAYERS_BASESHARE);
+#pragma endregion Temporal Layers
+
 #pragma region B - Frame Interval
 	bool bframeIntervalVisible = bframeSupported && (curView >= ViewMode::Master);
 	obs_property_set_visible(obs_properties_get(props, P_PERIOD_BFRAME), bframeIntervalVisible);
@@ -1177,6 +1295,8 @@ bool Plugin::Interface::H264Interface::properties_modified(obs_properties_t* pro
 			P_PROFILELEVEL,
 			P_CODINGTYPE,
 			P_MAXIMUMREFERENCEFRAMES,
+			P_TEMPORALLAYERS,
+			P_INTRAREFRESH,
 
 			P_BFRAME_PATTERN,
 			P_BFRAME_REFERENCE,
@@ -1216,6 +1336,8 @@ bool Plugin::Interface::H264Interface::properties_modified(obs_properties_t* pro
 			P_OPENCL_CONVERSION,
 			P_MULTITHREADING,
 			P_QUEUESIZE,
+			P_PREROLL,
+			P_LOOKAHEAD,
 			P_DEBUG,
 		};
 		for (const char* pr : hiddenProperties) {
@@ -1246,30 +1368,12 @@ bool Plugin::Interface::H264Interface::get_extra_data(void* data, uint8_t** extr
 	return false;
 }
 
-//////////////////////////////////////////////////////////////////////////
-// Module Code
-//////////////////////////////////////////////////////////////////////////
-Plugin::Interface::H264Interface::H264Interface(obs_data_t* data, obs_encoder_t* encoder)
+// Everything the encoder is constructed with, shared by the constructor and the encoder pool.
+static EncoderParameters GetEncoderParameters(obs_data_t* data, video_format format, video_colorspace colorspace,
+											  video_range_type range)
 {
-	PLOG_DEBUG("<" __FUNCTION_NAME__ "> Initializing...");
-
-	m_Encoder = encoder;
-
-	// OBS Settings
-	uint32_t                        obsWidth     = obs_encoder_get_width(encoder);
-	uint32_t                        obsHeight    = obs_encoder_get_height(encoder);
-	video_t*                        obsVideoInfo = obs_encoder_video(encoder);
-	const struct video_output_info* voi          = video_output_get_info(obsVideoInfo);
-	uint32_t                        obsFPSnum    = voi->fps_num;
-	uint32_t                        obsFPSden    = voi->fps_den;
-
-	//////////////////////////////////////////////////////////////////////////
-	/// Initialize Encoder
-	bool debug = obs_data_get_bool(data, P_DEBUG);
-	Plugin::AMD::AMF::Instance()->EnableDebugTrace(debug);
-
 	ColorFormat colorFormat = ColorFormat::NV12;
-	switch (voi->format) {
+	switch (format) {
 	case VIDEO_FORMAT_NV12:
 		colorFormat = ColorFormat::NV12;
 		break;
@@ -1290,7 +1394,7 @@ Plugin::Interface::H264Interface::H264Interface(obs_data_t* data, obs_encoder_t*
 		break;
 	}
 	ColorSpace colorSpace = ColorSpace::BT601;
-	switch (voi->colorspace) {
+	switch (colorspace) {
 	case VIDEO_CS_DEFAULT:
 	case VIDEO_CS_601:
 		colorSpace = ColorSpace::BT601;
@@ -1307,13 +1411,93 @@ Plugin::Interface::H264Interface::H264Interface(obs_data_t* data, obs_encoder_t*
 	} adapterid  = {obs_data_get_int(data, P_VIDEO_ADAPTER)};
 	auto adapter = api->GetAdapterById(adapterid.id[0], adapterid.id[1]);
 
-	m_VideoEncoder = std::make_unique<EncoderH264>(
-		api, adapter, !!obs_data_get_int(data, P_OPENCL_TRANSFER), !!obs_data_get_int(data, P_OPENCL_CONVERSION),
-		colorFormat, colorSpace, voi->range == VIDEO_RANGE_FULL, !!obs_data_get_int(data, P_MULTITHREADING),
-		(size_t)obs_data_get_int(data, P_QUEUESIZE));
+	// Temporal layers are only available from the SVC encoder, without it the encoder falls back to a single layer.
+	bool svc = (obs_data_get_int(data, P_TEMPORALLAYERS) > 1)
+			   && CapabilityManager::Instance()->IsCodecSupportedByAPIAdapter(Codec::SVC, api->GetType(), adapter);
+	return {svc ? Codec::SVC : Codec::AVC,
+			api,
+			adapter,
+			!!obs_data_get_int(data, P_OPENCL_TRANSFER),
+			!!obs_data_get_int(data, P_OPENCL_CONVERSION),
+			colorFormat,
+			colorSpace,
+			range == VIDEO_RANGE_FULL,
+			!!obs_data_get_int(data, P_MULTITHREADING),
+			(size_t)obs_data_get_int(data, P_QUEUESIZE)};
+}
+
+void Plugin::Interface::H264Interface::prepare()
+{
+	obs_video_info ovi;
+	if (!obs_get_video_info(&ovi))
+		return;
+
+	obs_data_t* data = obs_encoder_defaults(ENCODER_ID);
+	try {
+		AMD::EncoderPool::Instance()->Prepare(GetEncoderParameters(data, ovi.output_format, ovi.colorspace, ovi.range));
+	} catch (const std::exception& ex) {
+		PLOG_WARNING(PREFIX " Unable to prepare an encoder: %s", ex.what());
+	}
+	obs_data_release(data);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Module Code
+//////////////////////////////////////////////////////////////////////////
+Plugin::Interface::H264Interface::H264Interface(obs_data_t* data, obs_encoder_t* encoder)
+{
+	PLOG_DEBUG("<" __FUNCTION_NAME__ "> Initializing...");
+	uint64_t clk_create = Clock::Now(); // Start of the time to first packet
+
+	m_Encoder                  = encoder;
+	m_CongestionQueryTimestamp = 0;
+
+	// OBS Settings
+	uint32_t                        obsWidth     = obs_encoder_get_width(encoder);
+	uint32_t                        obsHeight    = obs_encoder_get_height(encoder);
+	video_t*                        obsVideoInfo = obs_encoder_video(encoder);
+	const struct video_output_info* voi          = video_output_get_info(obsVideoInfo);
+	uint32_t                        obsFPSnum    = voi->fps_num;
+	uint32_t                        obsFPSden    = voi->fps_den;
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Initialize Encoder
+	// Waits for the lazy adapter tests, so nothing is created in-process before the self-test had its say.
+	if (!AMD::CapabilityManager::Instance()->IsCodecSupported(Codec::AVC))
+		throw std::exception("No adapter supports H264/AVC.");
+
+	bool debug = obs_data_get_bool(data, P_DEBUG);
+	Plugin::AMD::AMF::Instance()->EnableDebugTrace(debug);
+
+	// Pooled encoders only need the settings applied.
+	EncoderParameters params = GetEncoderParameters(data, voi->format, voi->colorspace, voi->range);
+	if (AMD::EncoderPool::IsEnabled()) {
+		bool pooled = false;
+		m_VideoEncoder.reset(
+			static_cast<EncoderH264*>(AMD::EncoderPool::Instance()->Acquire(params, &pooled).release()));
+		if (pooled)
+			PLOG_INFO(PREFIX " Using prepared encoder <Id: %" PRIu64 ">.", m_VideoEncoder->GetUniqueId());
+	} else {
+		m_VideoEncoder.reset(static_cast<EncoderH264*>(params.Create().release()));
+	}
+	m_VideoEncoder->SetStartupTimestamp(clk_create);
 
 	/// Static Properties
-	m_VideoEncoder->SetUsage(Plugin::AMD::Usage::Transcoding);
+	// Intra-Refresh needs Ultra Low Latency, and the usage resets everything else, so it is decided on first.
+	uint32_t intraRefresh = static_cast<uint32_t>(obs_data_get_double(data, P_INTRAREFRESH) * 1000.0);
+	if (intraRefresh > 0) {
+		try {
+			m_VideoEncoder->SetUsage(Plugin::AMD::Usage::UltraLowLatency);
+			m_VideoEncoder->SetResolution(std::make_pair(obsWidth, obsHeight));
+			m_VideoEncoder->SetFrameRate(std::make_pair(obsFPSnum, obsFPSden));
+			m_VideoEncoder->SetIntraRefreshPeriod(intraRefresh);
+		} catch (const std::exception& ex) {
+			PLOG_WARNING(PREFIX " Intra-Refresh is not available, using keyframes instead: %s", ex.what());
+			intraRefresh = 0;
+		}
+	}
+	if (intraRefresh == 0)
+		m_VideoEncoder->SetUsage(Plugin::AMD::Usage::Transcoding);
 	m_VideoEncoder->SetQualityPreset(static_cast<QualityPreset>(obs_data_get_int(data, P_QUALITYPRESET)));
 
 	/// Frame
@@ -1333,6 +1517,16 @@ Plugin::Interface::H264Interface::H264Interface(obs_data_t* data, obs_encoder_t*
 		m_VideoEncoder->SetMaximumReferenceFrames(obs_data_get_int(data, P_MAXIMUMREFERENCEFRAMES));
 	} catch (...) {
 	}
+	{
+		uint8_t layers = static_cast<uint8_t>(obs_data_get_int(data, P_TEMPORALLAYERS));
+		uint8_t caps   = m_VideoEncoder->CapsTemporalLayers();
+		if ((layers > 1) && (params.codec != Codec::SVC)) {
+			PLOG_WARNING(PREFIX " %s is not supported by this adapter, using a single temporal layer instead of %d.",
+						 Utility::CodecToString(Codec::SVC), layers);
+			layers = 1;
+		}
+		m_VideoEncoder->SetTemporalLayers(min(layers, caps));
+	}
 
 	// OBS - Enforce Streaming Service Restrictions
 #pragma region OBS - Enforce Streaming Service Restrictions
@@ -1374,6 +1568,8 @@ Plugin::Interface::H264Interface::H264Interface(obs_data_t* data, obs_encoder_t*
 	this->update(data);
 
 	// Initialize (locks static properties)
+	m_VideoEncoder->SetPreRollFrames(static_cast<uint32_t>(obs_data_get_int(data, P_PREROLL)));
+	m_VideoEncoder->SetLookaheadFrames(static_cast<uint32_t>(obs_data_get_int(data, P_LOOKAHEAD)));
 	try {
 		m_VideoEncoder->Start();
 	} catch (...) {
@@ -1445,6 +1641,21 @@ bool Plugin::Interface::H264Interface::update(obs_data_t* data)
 	} else {
 		m_VideoEncoder->SetFillerDataEnabled(false);
 	}
+	/// Temporal Layers
+	for (uint8_t layer = 0, layers = m_VideoEncoder->GetTemporalLayers(); (layers > 1) && (layer < layers); layer++) {
+		try {
+			if (rcm == RateControlMethod::ConstantQP) {
+				int64_t qp = obs_data_get_int(data, P_QP_PFRAME)
+							 + obs_data_get_int(data, P_TEMPORALLAYERS_QPDELTA) * layer;
+				m_VideoEncoder->SetTemporalLayerQP(layer, static_cast<uint8_t>(min(qp, 51)));
+			} else {
+				uint64_t bitrate = static_cast<uint64_t>(obs_data_get_int(data, "bitrate") * 1000);
+				double_t share   = obs_data_get_int(data, P_TEMPORALLAYERS_BASESHARE) / 100.0;
+				m_VideoEncoder->SetTemporalLayerBitrate(layer, TemporalLayers::Bitrate(layer, layers, bitrate, share));
+			}
+		} catch (...) {
+		}
+	}
 	m_VideoEncoder->SetFrameSkippingEnabled(!!obs_data_get_int(data, P_FRAMESKIPPING));
 	m_VideoEncoder->SetEnforceHRDEnabled(!!obs_data_get_int(data, P_ENFORCEHRD));
 	m_VideoEncoder->SetVBVBufferInitialFullness((float)obs_data_get_double(data, P_VBVBUFFER_INITIALFULLNESS) / 100.0f);
@@ -1453,6 +1664,15 @@ bool Plugin::Interface::H264Interface::update(obs_data_t* data)
 	} else {
 		m_VideoEncoder->SetVBVBufferSize(static_cast<uint32_t>(obs_data_get_int(data, P_VBVBUFFER_SIZE) * 1000));
 	}
+	{
+		HRDModelMode hrd = (rcm == RateControlMethod::ConstantQP)
+							   ? HRDModelMode::Disabled
+							   : static_cast<HRDModelMode>(obs_data_get_int(data, P_HRDMODEL));
+		m_VideoEncoder->SetAdaptiveBitrateEnabled(
+			(rcm != RateControlMethod::ConstantQP)
+			&& (!!obs_data_get_int(data, P_ADAPTIVEBITRATE) || (hrd == HRDModelMode::Feedback)));
+		m_VideoEncoder->SetHRDModelMode(hrd);
+	}
 
 	// Picture Control
 	double_t framerate = (double_t)obsFPSnum / (double_t)obsFPSden;
@@ -1486,6 +1706,10 @@ bool Plugin::Interface::H264Interface::update(obs_data_t* data)
 		m_VideoEncoder->SetFrameSkippingPeriod(period);
 		m_VideoEncoder->SetFrameSkippingBehaviour(!!obs_data_get_int(data, P_FRAMESKIPPING_BEHAVIOUR));
 	}
+	m_VideoEncoder->SetStaticFrameSkipping(static_cast<uint32_t>(obs_data_get_int(data, P_FRAMESKIPPING_STATIC)));
+	m_VideoEncoder->SetSceneCutMode(static_cast<SceneCutMode>(obs_data_get_int(data, P_SCENECUT)));
+	m_VideoEncoder->SetSceneCutMinimumDistance(static_cast<uint32_t>(obs_data_get_int(data, P_SCENECUT_DISTANCE)));
+	m_VideoEncoder->SetSegmentDuration(static_cast<uint32_t>(obs_data_get_double(data, P_INTERVAL_SEGMENT) * 1000.0));
 	m_VideoEncoder->SetDeblockingFilterEnabled(!!obs_data_get_int(data, P_DEBLOCKINGFILTER));
 
 #pragma region B - Frames
@@ -1565,6 +1789,20 @@ bool Plugin::Interface::H264Interface::encode(struct encoder_frame* frame, struc
 
 	bool retVal = false;
 
+	// Looking for the output every frame would be wasteful, congestion doesn't change that quickly.
+	if (m_VideoEncoder->IsAdaptiveBitrateEnabled()) {
+		uint64_t now = Clock::Now();
+		if (Clock::ToNanoseconds(now - m_CongestionQueryTimestamp) >= 500000000) {
+			double   congestion;
+			uint64_t dropped, total;
+			if (Utility::GetOutputCongestion(m_Encoder, congestion, dropped, total)) {
+				m_VideoEncoder->ReportCongestion(congestion);
+				m_VideoEncoder->ReportDroppedFrames(dropped, total);
+			}
+			m_CongestionQueryTimestamp = now;
+		}
+	}
+
 	try {
 		retVal = m_VideoEncoder->Encode(frame, packet, received_packet);
 	} catch (std::exception e) {
@@ -20,18 +20,22 @@
 #include "enc-h265.hpp"
 #include "amf-capabilities.hpp"
 #include "amf-encoder-h265.hpp"
+#include "amf-encoder-pool.hpp"
 #include "amf-encoder.hpp"
+#include "clock.hpp"
 #include "strings.hpp"
 #include "utility.hpp"
 
+#define ENCODER_ID "amd_amf_h265"
 #define PREFIX "[H265/HEVC]"
 
 using namespace Plugin::AMD;
 
 void Plugin::Interface::H265Interface::encoder_register()
 {
-	// Test if we actually have AVC support.
-	if (!AMD::CapabilityManager::Instance()->IsCodecSupported(Codec::HEVC)) {
+	// Registration has to stay cheap, so only skip it if a previous run found no HEVC support at all. The adapters
+	// are tested once the encoder is actually used.
+	if (AMD::CapabilityManager::IsCodecKnownUnsupported(Codec::HEVC)) {
 		PLOG_WARNING(PREFIX " Not supported by any GPU, disabling...");
 		return;
 	}
@@ -42,7 +46,7 @@ void Plugin::Interface::H265Interface::encoder_register()
 
 	// Initialize Structure
 	encoder_info->type               = obs_encoder_type::OBS_ENCODER_VIDEO;
-	static const char* encoder_name  = "amd_amf_h265";
+	static const char* encoder_name  = ENCODER_ID;
 	encoder_info->id                 = encoder_name;
 	static const char* encoder_codec = "hevc";
 	encoder_info->codec              = encoder_codec;
@@ -98,6 +102,7 @@ void Plugin::Interface::H265Interface::get_defaults(obs_data_t* data)
 	obs_data_set_default_int(data, P_QP_IFRAME, 22);
 	obs_data_set_default_int(data, P_QP_PFRAME, 22);
 	obs_data_set_default_int(data, P_QP_BFRAME, 22);
+	obs_data_set_default_int(data, P_LOOKAHEAD, 0);
 	obs_data_set_default_int(data, P_QP_IFRAME_MINIMUM, 18);
 	obs_data_set_default_int(data, P_QP_IFRAME_MAXIMUM, 51);
 	obs_data_set_default_int(data, P_QP_PFRAME_MINIMUM, 18);
@@ -106,6 +111,8 @@ void Plugin::Interface::H265Interface::get_defaults(obs_data_t* data)
 	obs_data_set_default_int(data, P_FRAMESKIPPING, 0);
 	obs_data_set_default_int(data, P_VBAQ, 0);
 	obs_data_set_default_int(data, P_ENFORCEHRD, 1);
+	obs_data_set_default_int(data, P_ADAPTIVEBITRATE, 0);
+	obs_data_set_default_int(data, P_HRDMODEL, static_cast<int64_t>(HRDModelMode::Disabled));
 
 	// VBV Buffer
 	obs_data_set_int(data, ("last" P_VBVBUFFER), -1);
@@ -118,12 +125,16 @@ void Plugin::Interface::H265Interface::get_defaults(obs_data_t* data)
 	// Picture Control
 	obs_data_set_default_double(data, P_INTERVAL_KEYFRAME, 2.0);
 	obs_data_set_default_int(data, P_PERIOD_IDR_H265, 0);
+	obs_data_set_default_double(data, P_INTERVAL_SEGMENT, 0.0);
 	obs_data_set_default_double(data, P_INTERVAL_IFRAME, 0.0);
 	obs_data_set_default_int(data, P_PERIOD_IFRAME, 0);
 	obs_data_set_default_double(data, P_INTERVAL_PFRAME, 0.0);
 	obs_data_set_default_int(data, P_PERIOD_PFRAME, 0);
+	obs_data_set_default_int(data, P_SCENECUT, static_cast<int64_t>(SceneCutMode::Disabled));
+	obs_data_set_default_int(data, P_SCENECUT_DISTANCE, 15);
 	obs_data_set_default_int(data, P_FRAMESKIPPING_PERIOD, 0);
 	obs_data_set_default_int(data, P_FRAMESKIPPING_BEHAVIOUR, 0);
+	obs_data_set_default_int(data, P_FRAMESKIPPING_STATIC, 0);
 	obs_data_set_default_int(data, P_GOP_TYPE, static_cast<int64_t>(H265::GOPType::Fixed));
 	obs_data_set_default_int(data, P_GOP_SIZE, 60);
 	obs_data_set_default_int(data, P_GOP_SIZE_MINIMUM, 1);
@@ -142,6 +153,7 @@ void Plugin::Interface::H265Interface::get_defaults(obs_data_t* data)
 	obs_data_set_default_int(data, P_OPENCL_CONVERSION, 0);
 	obs_data_set_default_int(data, P_MULTITHREADING, 0);
 	obs_data_set_default_int(data, P_QUEUESIZE, 8);
+	obs_data_set_default_int(data, P_PREROLL, 0);
 	obs_data_set_int(data, ("last" P_VIEW), -1);
 	obs_data_set_default_int(data, ("last" P_VIEW), -1);
 	obs_data_set_default_int(data, P_VIEW, static_cast<int64_t>(ViewMode::Basic));
@@ -271,6 +283,8 @@ obs_properties_t* Plugin::Interface::H265Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_QP_IFRAME)));
 	p = obs_properties_add_int_slider(props, P_QP_PFRAME, P_TRANSLATE(P_QP_PFRAME), 0, 51, 1);
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_QP_PFRAME)));
+	p = obs_properties_add_int_slider(props, P_LOOKAHEAD, P_TRANSLATE(P_LOOKAHEAD), 0, 32, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_LOOKAHEAD)));
 
 	/// Minimum QP, Maximum QP
 	p = obs_properties_add_int_slider(props, P_QP_IFRAME_MINIMUM, P_TRANSLATE(P_QP_IFRAME_MINIMUM), 0, 51, 1);
@@ -304,6 +318,8 @@ obs_properties_t* Plugin::Interface::H265Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_FRAMESKIPPING_BEHAVIOUR)));
 	obs_property_list_add_int(p, P_TRANSLATE(P_FRAMESKIPPING_SKIPNTH), 0);
 	obs_property_list_add_int(p, P_TRANSLATE(P_FRAMESKIPPING_KEEPNTH), 1);
+	p = obs_properties_add_int_slider(props, P_FRAMESKIPPING_STATIC, P_TRANSLATE(P_FRAMESKIPPING_STATIC), 0, 300, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_FRAMESKIPPING_STATIC)));
 #pragma endregion Frame Skipping
 
 #pragma region VBAQ
@@ -321,6 +337,22 @@ obs_properties_t* Plugin::Interface::H265Interface::get_properties(void* data)
 	obs_property_list_add_int(p, P_TRANSLATE(P_UTIL_SWITCH_ENABLED), 1);
 #pragma endregion Enforce Hyptothetical Reference Decoder Restrictions
 
+#pragma region Adaptive Bitrate
+	p = obs_properties_add_list(props, P_ADAPTIVEBITRATE, P_TRANSLATE(P_ADAPTIVEBITRATE), OBS_COMBO_TYPE_LIST,
+								OBS_COMBO_FORMAT_INT);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_ADAPTIVEBITRATE)));
+	obs_property_list_add_int(p, P_TRANSLATE(P_UTIL_SWITCH_DISABLED), 0);
+	obs_property_list_add_int(p, P_TRANSLATE(P_UTIL_SWITCH_ENABLED), 1);
+#pragma endregion Adaptive Bitrate
+
+#pragma region Decoder Buffer Model
+	p = obs_properties_add_list(props, P_HRDMODEL, P_TRANSLATE(P_HRDMODEL), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_HRDMODEL)));
+	obs_property_list_add_int(p, P_TRANSLATE(P_UTIL_SWITCH_DISABLED), static_cast<int64_t>(HRDModelMode::Disabled));
+	obs_property_list_add_int(p, P_TRANSLATE(P_HRDMODEL_MONITOR), static_cast<int64_t>(HRDModelMode::Monitor));
+	obs_property_list_add_int(p, P_TRANSLATE(P_HRDMODEL_FEEDBACK), static_cast<int64_t>(HRDModelMode::Feedback));
+#pragma endregion Decoder Buffer Model
+
 	// VBV Buffer
 #pragma region VBV Buffer Mode
 	p = obs_properties_add_list(props, P_VBVBUFFER, P_TRANSLATE(P_VBVBUFFER), OBS_COMBO_TYPE_LIST,
@@ -355,6 +387,8 @@ obs_properties_t* Plugin::Interface::H265Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_INTERVAL_KEYFRAME)));
 	p = obs_properties_add_int(props, P_PERIOD_IDR_H265, P_TRANSLATE(P_PERIOD_IDR_H265), 0, 1000, 1);
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_PERIOD_IDR_H265)));
+	p = obs_properties_add_float(props, P_INTERVAL_SEGMENT, P_TRANSLATE(P_INTERVAL_SEGMENT), 0, 60, 0.001);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_INTERVAL_SEGMENT)));
 	/// I-Frame
 	p = obs_properties_add_float(props, P_INTERVAL_IFRAME, P_TRANSLATE(P_INTERVAL_IFRAME), 0, 100, 0.001);
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_INTERVAL_IFRAME)));
@@ -367,6 +401,16 @@ obs_properties_t* Plugin::Interface::H265Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_PERIOD_PFRAME)));
 #pragma endregion Interval and Periods
 
+#pragma region Scene Cut
+	p = obs_properties_add_list(props, P_SCENECUT, P_TRANSLATE(P_SCENECUT), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_SCENECUT)));
+	obs_property_list_add_int(p, P_TRANSLATE(P_UTIL_SWITCH_DISABLED), static_cast<int64_t>(SceneCutMode::Disabled));
+	obs_property_list_add_int(p, P_TRANSLATE(P_SCENECUT_IFRAME), static_cast<int64_t>(SceneCutMode::IFrame));
+	obs_property_list_add_int(p, P_TRANSLATE(P_SCENECUT_IDRFRAME), static_cast<int64_t>(SceneCutMode::IDRFrame));
+	p = obs_properties_add_int_slider(props, P_SCENECUT_DISTANCE, P_TRANSLATE(P_SCENECUT_DISTANCE), 1, 300, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_SCENECUT_DISTANCE)));
+#pragma endregion Scene Cut
+
 #pragma region GOP Type
 	p = obs_properties_add_list(props, P_GOP_TYPE, P_TRANSLATE(P_GOP_TYPE), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_GOP_TYPE)));
@@ -447,6 +491,9 @@ obs_properties_t* Plugin::Interface::H265Interface::get_properties(void* data)
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_QUEUESIZE)));
 #pragma endregion Asynchronous Queue
 
+	p = obs_properties_add_int_slider(props, P_PREROLL, P_TRANSLATE(P_PREROLL), 0, 30, 1);
+	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_PREROLL)));
+
 #pragma region View Mode
 	p = obs_properties_add_list(props, P_VIEW, P_TRANSLATE(P_VIEW), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 	obs_property_set_long_description(p, P_TRANSLATE(P_DESC(P_VIEW)));
@@ -529,15 +576,21 @@ bool Plugin::Interface::H265Interface::properties_modified(obs_properties_t* pro
 		} adapterid  = {videoAdapter_cur};
 		auto adapter = api->GetAdapterById(adapterid.id[0], adapterid.id[1]);
 		try {
-			auto enc = EncoderH265(api, adapter);
+			// Read from the snapshot taken at load, creating an encoder here would open a session on the GPU.
+			auto caps = CapabilityManager::Instance()->GetSnapshot(Codec::HEVC, api->GetType(), adapter);
+			if (!caps) {
+				QUICK_FORMAT_MESSAGE(errMsg, "Adapter '%s' does not support %s.", adapter.Name.c_str(),
+									 Utility::CodecToString(Codec::HEVC));
+				throw std::exception(errMsg.c_str());
+			}
 
 #define TEMP_LIMIT_DROPDOWN(func, enm, prop)                                             \
 	{                                                                                    \
 		auto tmp_p = obs_properties_get(props, prop);                                    \
-		auto tmp_l = enc.func();                                                         \
+		auto tmp_l = caps->func;                                                         \
 		enm  tmp_s = static_cast<enm>(obs_data_get_int(data, obs_property_name(tmp_p))); \
 		for (size_t idx = 0; idx < obs_property_list_item_count(tmp_p); idx++) {         \
-			bool enabled = false;                                                        \
+			bool enabled = tmp_l.empty(); /* Not reported, so not restricted either. */  \
 			enm  tmp_v   = static_cast<enm>(obs_property_list_item_int(tmp_p, idx));     \
 			for (auto tmp_k : tmp_l) {                                                   \
 				if (tmp_k == tmp_v) {                                                    \
@@ -550,36 +603,38 @@ bool Plugin::Interface::H265Interface::properties_modified(obs_properties_t* pro
 				obs_data_unset_user_value(data, obs_property_name(tmp_p));               \
 		}                                                                                \
 	}
-#define TEMP_LIMIT_SLIDER(func, prop)                                               \
-	{                                                                               \
-		auto tmp_p = obs_properties_get(props, prop);                               \
-		auto tmp_l = enc.func();                                                    \
-		obs_property_int_set_limits(tmp_p, (int)tmp_l.first, (int)tmp_l.second, 1); \
+#define TEMP_LIMIT_SLIDER(func, prop)                                                   \
+	{                                                                                   \
+		auto tmp_p = obs_properties_get(props, prop);                                   \
+		auto tmp_l = caps->func;                                                        \
+		if (tmp_l.second > 0)                                                           \
+			obs_property_int_set_limits(tmp_p, (int)tmp_l.first, (int)tmp_l.second, 1); \
 	}
-#define TEMP_LIMIT_SLIDER_BITRATE(func, prop)                                                     \
-	{                                                                                             \
-		auto tmp_p = obs_properties_get(props, prop);                                             \
-		auto tmp_l = enc.func();                                                                  \
-		obs_property_int_set_limits(tmp_p, (int)tmp_l.first / 1000, (int)tmp_l.second / 1000, 1); \
+#define TEMP_LIMIT_SLIDER_BITRATE(func, prop)                                                         \
+	{                                                                                                 \
+		auto tmp_p = obs_properties_get(props, prop);                                                 \
+		auto tmp_l = caps->func;                                                                      \
+		if (tmp_l.second > 0)                                                                         \
+			obs_property_int_set_limits(tmp_p, (int)tmp_l.first / 1000, (int)tmp_l.second / 1000, 1); \
 	}
 
-			//TEMP_LIMIT_DROPDOWN(CapsUsage, AMD::Usage, P_USAGE);
-			TEMP_LIMIT_DROPDOWN(CapsQualityPreset, AMD::QualityPreset, P_QUALITYPRESET);
-			TEMP_LIMIT_DROPDOWN(CapsProfile, AMD::Profile, P_PROFILE);
-			TEMP_LIMIT_DROPDOWN(CapsProfileLevel, AMD::ProfileLevel, P_PROFILELEVEL);
+			//TEMP_LIMIT_DROPDOWN(usage, AMD::Usage, P_USAGE);
+			TEMP_LIMIT_DROPDOWN(qualityPreset, AMD::QualityPreset, P_QUALITYPRESET);
+			TEMP_LIMIT_DROPDOWN(profile, AMD::Profile, P_PROFILE);
+			TEMP_LIMIT_DROPDOWN(profileLevel, AMD::ProfileLevel, P_PROFILELEVEL);
 			{
 				auto tmp_p = obs_properties_get(props, P_PROFILELEVEL);
 				obs_property_list_item_disable(tmp_p, 0, false);
 			}
-			TEMP_LIMIT_DROPDOWN(CapsTier, AMD::H265::Tier, P_TIER);
+			TEMP_LIMIT_DROPDOWN(tier, AMD::H265::Tier, P_TIER);
 			// Aspect Ratio - No limits, only affects players/transcoders
-			TEMP_LIMIT_DROPDOWN(CapsCodingType, AMD::CodingType, P_CODINGTYPE);
-			TEMP_LIMIT_SLIDER(CapsMaximumReferenceFrames, P_MAXIMUMREFERENCEFRAMES);
-			TEMP_LIMIT_DROPDOWN(CapsRateControlMethod, AMD::RateControlMethod, P_RATECONTROLMETHOD);
-			TEMP_LIMIT_DROPDOWN(CapsPrePassMode, AMD::PrePassMode, P_PREPASSMODE);
-			TEMP_LIMIT_SLIDER_BITRATE(CapsTargetBitrate, "bitrate");
-			TEMP_LIMIT_SLIDER_BITRATE(CapsPeakBitrate, P_BITRATE_PEAK);
-			TEMP_LIMIT_SLIDER_BITRATE(CapsVBVBufferSize, P_VBVBUFFER_SIZE);
+			TEMP_LIMIT_DROPDOWN(codingType, AMD::CodingType, P_CODINGTYPE);
+			TEMP_LIMIT_SLIDER(maximumReferenceFrames, P_MAXIMUMREFERENCEFRAMES);
+			TEMP_LIMIT_DROPDOWN(rateControlMethod, AMD::RateControlMethod, P_RATECONTROLMETHOD);
+			TEMP_LIMIT_DROPDOWN(prePassMode, AMD::PrePassMode, P_PREPASSMODE);
+			TEMP_LIMIT_SLIDER_BITRATE(targetBitrate, "bitrate");
+			TEMP_LIMIT_SLIDER_BITRATE(peakBitrate, P_BITRATE_PEAK);
+			TEMP_LIMIT_SLIDER_BITRATE(vbvBufferSize, P_VBVBUFFER_SIZE);
 		} catch (const std::exception& e) {
 			PLOG_ERROR("Exception occured while updating capabilities: %s", e.what());
 		}
@@ -619,8 +674,11 @@ bool Plugin::Interface::H265Interface::properties_modified(obs_properties_t* pro
 		std::make_pair(P_FRAMESKIPPING, ViewMode::Advanced),
 		std::make_pair(P_FRAMESKIPPING_PERIOD, ViewMode::Master),
 		std::make_pair(P_FRAMESKIPPING_BEHAVIOUR, ViewMode::Master),
+		std::make_pair(P_FRAMESKIPPING_STATIC, ViewMode::Advanced),
 		//std::make_pair(P_VBAQ, ViewMode::Expert),
 		std::make_pair(P_ENFORCEHRD, ViewMode::Expert),
+		std::make_pair(P_ADAPTIVEBITRATE, ViewMode::Advanced),
+		std::make_pair(P_HRDMODEL, ViewMode::Advanced),
 		// ----------- VBV Buffer
 		std::make_pair(P_VBVBUFFER, ViewMode::Advanced),
 		//std::make_pair(P_VBVBUFFER_STRICTNESS, ViewMode::Advanced),
@@ -629,10 +687,13 @@ bool Plugin::Interface::H265Interface::properties_modified(obs_properties_t* pro
 		// ----------- Picture Control
 		std::make_pair(P_INTERVAL_KEYFRAME, ViewMode::Basic),
 		std::make_pair(P_PERIOD_IDR_H265, ViewMode::Master),
+		std::make_pair(P_INTERVAL_SEGMENT, ViewMode::Advanced),
 		std::make_pair(P_INTERVAL_IFRAME, ViewMode::Master),
 		std::make_pair(P_PERIOD_IFRAME, ViewMode::Master),
 		std::make_pair(P_INTERVAL_PFRAME, ViewMode::Master),
 		std::make_pair(P_PERIOD_PFRAME, ViewMode::Master),
+		std::make_pair(P_SCENECUT, ViewMode::Advanced),
+		std::make_pair(P_SCENECUT_DISTANCE, ViewMode::Advanced),
 		std::make_pair(P_GOP_TYPE, ViewMode::Expert),
 		//std::make_pair(P_GOP_SIZE, ViewMode::Expert),
 		//std::make_pair(P_GOP_SIZE_MINIMUM, ViewMode::Expert),
@@ -648,6 +709,7 @@ bool Plugin::Interface::H265Interface::properties_modified(obs_properties_t* pro
 		std::make_pair(P_OPENCL_CONVERSION, ViewMode::Advanced),
 		std::make_pair(P_MULTITHREADING, ViewMode::Expert),
 		std::make_pair(P_QUEUESIZE, ViewMode::Expert),
+		std::make_pair(P_PREROLL, ViewMode::Expert),
 		std::make_pair(P_VIEW, ViewMode::Basic),
 		std::make_pair(P_DEBUG, ViewMode::Basic),
 	};
@@ -700,6 +762,7 @@ bool Plugin::Interface::H265Interface::properties_modified(obs_properties_t* pro
 		obs_data_unset_user_value(data, P_QP_IFRAME);
 		obs_data_unset_user_value(data, P_QP_PFRAME);
 	}
+	obs_property_set_visible(obs_properties_get(props, P_LOOKAHEAD), (curView >= ViewMode::Advanced) && vis_rcm_qp);
 
 	/// QP Min/Max
 	obs_property_set_visible(obs_properties_get(props, P_QP_IFRAME_MINIMUM),
@@ -808,6 +871,8 @@ bool Plugin::Interface::H265Interface::properties_modified(obs_properties_t* pro
 			P_OPENCL_CONVERSION,
 			P_MULTITHREADING,
 			P_QUEUESIZE,
+			P_PREROLL,
+			P_LOOKAHEAD,
 			P_DEBUG,
 		};
 		for (const char* pr : hiddenProperties) {
@@ -828,27 +893,12 @@ void* Plugin::Interface::H265Interface::create(obs_data_t* data, obs_encoder_t*
 	return nullptr;
 }
 
-Plugin::Interface::H265Interface::H265Interface(obs_data_t* data, obs_encoder_t* encoder)
+// Everything the encoder is constructed with, shared by the constructor and the encoder pool.
+static EncoderParameters GetEncoderParameters(obs_data_t* data, video_format format, video_colorspace colorspace,
+											  video_range_type range)
 {
-	PLOG_DEBUG("<" __FUNCTION_NAME__ "> Initializing...");
-
-	m_Encoder = encoder;
-
-	// OBS Settings
-	uint32_t                        obsWidth     = obs_encoder_get_width(encoder);
-	uint32_t                        obsHeight    = obs_encoder_get_height(encoder);
-	video_t*                        obsVideoInfo = obs_encoder_video(encoder);
-	const struct video_output_info* voi          = video_output_get_info(obsVideoInfo);
-	uint32_t                        obsFPSnum    = voi->fps_num;
-	uint32_t                        obsFPSden    = voi->fps_den;
-
-	//////////////////////////////////////////////////////////////////////////
-	/// Initialize Encoder
-	bool debug = obs_data_get_bool(data, P_DEBUG);
-	Plugin::AMD::AMF::Instance()->EnableDebugTrace(debug);
-
 	ColorFormat colorFormat = ColorFormat::NV12;
-	switch (voi->format) {
+	switch (format) {
 	case VIDEO_FORMAT_NV12:
 		colorFormat = ColorFormat::NV12;
 		break;
@@ -869,7 +919,7 @@ Plugin::Interface::H265Interface::H265Interface(obs_data_t* data, obs_encoder_t*
 		break;
 	}
 	ColorSpace colorSpace = ColorSpace::BT601;
-	switch (voi->colorspace) {
+	switch (colorspace) {
 	case VIDEO_CS_DEFAULT:
 	case VIDEO_CS_601:
 		colorSpace = ColorSpace::BT601;
@@ -886,10 +936,70 @@ Plugin::Interface::H265Interface::H265Interface(obs_data_t* data, obs_encoder_t*
 	} adapterid  = {obs_data_get_int(data, P_VIDEO_ADAPTER)};
 	auto adapter = api->GetAdapterById(adapterid.id[0], adapterid.id[1]);
 
-	m_VideoEncoder = std::make_unique<EncoderH265>(
-		api, adapter, !!obs_data_get_int(data, P_OPENCL_TRANSFER), !!obs_data_get_int(data, P_OPENCL_CONVERSION),
-		colorFormat, colorSpace, voi->range == VIDEO_RANGE_FULL, !!obs_data_get_int(data, P_MULTITHREADING),
-		(size_t)obs_data_get_int(data, P_QUEUESIZE));
+	return {Codec::HEVC,
+			api,
+			adapter,
+			!!obs_data_get_int(data, P_OPENCL_TRANSFER),
+			!!obs_data_get_int(data, P_OPENCL_CONVERSION),
+			colorFormat,
+			colorSpace,
+			range == VIDEO_RANGE_FULL,
+			!!obs_data_get_int(data, P_MULTITHREADING),
+			(size_t)obs_data_get_int(data, P_QUEUESIZE)};
+}
+
+void Plugin::Interface::H265Interface::prepare()
+{
+	obs_video_info ovi;
+	if (!obs_get_video_info(&ovi))
+		return;
+
+	obs_data_t* data = obs_encoder_defaults(ENCODER_ID);
+	try {
+		AMD::EncoderPool::Instance()->Prepare(GetEncoderParameters(data, ovi.output_format, ovi.colorspace, ovi.range));
+	} catch (const std::exception& ex) {
+		PLOG_WARNING(PREFIX " Unable to prepare an encoder: %s", ex.what());
+	}
+	obs_data_release(data);
+}
+
+Plugin::Interface::H265Interface::H265Interface(obs_data_t* data, obs_encoder_t* encoder)
+{
+	PLOG_DEBUG("<" __FUNCTION_NAME__ "> Initializing...");
+	uint64_t clk_create = Clock::Now(); // Start of the time to first packet
+
+	m_Encoder                  = encoder;
+	m_CongestionQueryTimestamp = 0;
+
+	// OBS Settings
+	uint32_t                        obsWidth     = obs_encoder_get_width(encoder);
+	uint32_t                        obsHeight    = obs_encoder_get_height(encoder);
+	video_t*                        obsVideoInfo = obs_encoder_video(encoder);
+	const struct video_output_info* voi          = video_output_get_info(obsVideoInfo);
+	uint32_t                        obsFPSnum    = voi->fps_num;
+	uint32_t                        obsFPSden    = voi->fps_den;
+
+	//////////////////////////////////////////////////////////////////////////
+	/// Initialize Encoder
+	// Waits for the lazy adapter tests, so nothing is created in-process before the self-test had its say.
+	if (!AMD::CapabilityManager::Instance()->IsCodecSupported(Codec::HEVC))
+		throw std::exception("No adapter supports H265/HEVC.");
+
+	bool debug = obs_data_get_bool(data, P_DEBUG);
+	Plugin::AMD::AMF::Instance()->EnableDebugTrace(debug);
+
+	// Pooled encoders only need the settings applied.
+	EncoderParameters params = GetEncoderParameters(data, voi->format, voi->colorspace, voi->range);
+	if (AMD::EncoderPool::IsEnabled()) {
+		bool pooled = false;
+		m_VideoEncoder.reset(
+			static_cast<EncoderH265*>(AMD::EncoderPool::Instance()->Acquire(params, &pooled).release()));
+		if (pooled)
+			PLOG_INFO(PREFIX " Using prepared encoder <Id: %" PRIu64 ">.", m_VideoEncoder->GetUniqueId());
+	} else {
+		m_VideoEncoder.reset(static_cast<EncoderH265*>(params.Create().release()));
+	}
+	m_VideoEncoder->SetStartupTimestamp(clk_create);
 
 	/// Static Properties
 	m_VideoEncoder->SetUsage(Plugin::AMD::Usage::Transcoding);
@@ -1014,6 +1124,8 @@ Plugin::Interface::H265Interface::H265Interface(obs_data_t* data, obs_encoder_t*
 	this->update(data);
 
 	// Initialize (locks static properties)
+	m_VideoEncoder->SetPreRollFrames(static_cast<uint32_t>(obs_data_get_int(data, P_PREROLL)));
+	m_VideoEncoder->SetLookaheadFrames(static_cast<uint32_t>(obs_data_get_int(data, P_LOOKAHEAD)));
 	try {
 		m_VideoEncoder->Start();
 	} catch (...) {
@@ -1082,6 +1194,15 @@ bool Plugin::Interface::H265Interface::update(obs_data_t* data)
 	}
 	m_VideoEncoder->SetFrameSkippingEnabled(!!obs_data_get_int(data, P_FRAMESKIPPING));
 	m_VideoEncoder->SetEnforceHRDEnabled(!!obs_data_get_int(data, P_ENFORCEHRD));
+	{
+		HRDModelMode hrd = (rcm == RateControlMethod::ConstantQP)
+							   ? HRDModelMode::Disabled
+							   : static_cast<HRDModelMode>(obs_data_get_int(data, P_HRDMODEL));
+		m_VideoEncoder->SetAdaptiveBitrateEnabled(
+			(rcm != RateControlMethod::ConstantQP)
+			&& (!!obs_data_get_int(data, P_ADAPTIVEBITRATE) || (hrd == HRDModelMode::Feedback)));
+		m_VideoEncoder->SetHRDModelMode(hrd);
+	}
 
 	// Picture Control
 	double_t framerate = (double_t)obsFPSnum / (double_t)obsFPSden;
@@ -1106,6 +1227,10 @@ bool Plugin::Interface::H265Interface::update(obs_data_t* data)
 		m_VideoEncoder->SetFrameSkippingPeriod(period);
 		m_VideoEncoder->SetFrameSkippingBehaviour(!!obs_data_get_int(data, P_FRAMESKIPPING_BEHAVIOUR));
 	}
+	m_VideoEncoder->SetStaticFrameSkipping(static_cast<uint32_t>(obs_data_get_int(data, P_FRAMESKIPPING_STATIC)));
+	m_VideoEncoder->SetSceneCutMode(static_cast<SceneCutMode>(obs_data_get_int(data, P_SCENECUT)));
+	m_VideoEncoder->SetSceneCutMinimumDistance(static_cast<uint32_t>(obs_data_get_int(data, P_SCENECUT_DISTANCE)));
+	m_VideoEncoder->SetSegmentDuration(static_cast<uint32_t>(obs_data_get_double(data, P_INTERVAL_SEGMENT) * 1000.0));
 
 	m_VideoEncoder->SetDebug(obs_data_get_bool(data, P_DEBUG));
 
@@ -1134,6 +1259,20 @@ bool Plugin::Interface::H265Interface::encode(struct encoder_frame* frame, struc
 	if (!frame || !packet || !received_packet)
 		return false;
 
+	// Looking for the output every frame would be wasteful, congestion doesn't change that quickly.
+	if (m_VideoEncoder->IsAdaptiveBitrateEnabled()) {
+		uint64_t now = Clock::Now();
+		if (Clock::ToNanoseconds(now - m_CongestionQueryTimestamp) >= 500000000) {
+			double   congestion;
+			uint64_t dropped, total;
+			if (Utility::GetOutputCongestion(m_Encoder, congestion, dropped, total)) {
+				m_VideoEncoder->ReportCongestion(congestion);
+				m_VideoEncoder->ReportDroppedFrames(dropped, total);
+			}
+			m_CongestionQueryTimestamp = now;
+		}
+	}
+
 	try {
 		return m_VideoEncoder->Encode(frame, packet, received_packet);
 	} catch (std::exception e) {
@@ -0,0 +1,132 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "frame-hash.hpp"
+#include <cstring>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define PLUGIN_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+#define PRIME32_1 0x9E3779B1ULL
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define STRIPE_SIZE 32 // Bytes per round, four 64-bit lanes
+#define BLOCK_SIZE 1024 // Bytes between scrambles
+
+static const uint64_t s_Key[4] = {0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL,
+								  0x1F67B3B7A4A44072ULL};
+
+static inline uint64_t Read64(const uint8_t* ptr)
+{
+	uint64_t v;
+	std::memcpy(&v, ptr, sizeof(v));
+	return v;
+}
+
+static inline uint64_t Avalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+#ifdef PLUGIN_HASH_SSE2
+static inline __m128i Accumulate(__m128i acc, __m128i data, __m128i key)
+{
+	// Low times high half of each lane, plus the data of the other lane so that nothing is lost to a zero.
+	__m128i mixed = _mm_xor_si128(data, key);
+	__m128i prod  = _mm_mul_epu32(mixed, _mm_shuffle_epi32(mixed, _MM_SHUFFLE(0, 3, 0, 1)));
+	return _mm_add_epi64(_mm_add_epi64(acc, _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2))), prod);
+}
+
+static inline __m128i Scramble(__m128i acc, __m128i key)
+{
+	const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+	acc                 = _mm_xor_si128(_mm_xor_si128(acc, _mm_srli_epi64(acc, 47)), key);
+	__m128i lo          = _mm_mul_epu32(acc, prime);
+	__m128i hi          = _mm_mul_epu32(_mm_shuffle_epi32(acc, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+	return _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+}
+#endif
+
+uint64_t Plugin::FrameHash::Compute(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* ptr    = static_cast<const uint8_t*>(data);
+	uint64_t       acc[4] = {seed + PRIME64_1, seed + PRIME64_2, seed + PRIME64_3, seed + PRIME64_4};
+	size_t         idx    = 0;
+
+#ifdef PLUGIN_HASH_SSE2
+	{
+		__m128i acc0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc));
+		__m128i acc1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + 2));
+		__m128i key0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s_Key));
+		__m128i key1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s_Key + 2));
+		while (idx + STRIPE_SIZE <= size) {
+			size_t end = idx + BLOCK_SIZE;
+			for (; (idx < end) && (idx + STRIPE_SIZE <= size); idx += STRIPE_SIZE) {
+				acc0 = Accumulate(acc0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + idx)), key0);
+				acc1 = Accumulate(acc1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + idx + 16)), key1);
+			}
+			acc0 = Scramble(acc0, key0);
+			acc1 = Scramble(acc1, key1);
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(acc), acc0);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(acc + 2), acc1);
+	}
+#else
+	while (idx + STRIPE_SIZE <= size) {
+		size_t end = idx + BLOCK_SIZE;
+		for (; (idx < end) && (idx + STRIPE_SIZE <= size); idx += STRIPE_SIZE) {
+			uint64_t lanes[4] = {Read64(ptr + idx), Read64(ptr + idx + 8), Read64(ptr + idx + 16),
+								 Read64(ptr + idx + 24)};
+			for (size_t lane = 0; lane < 4; lane++) {
+				uint64_t mixed = lanes[lane] ^ s_Key[lane];
+				acc[lane] += lanes[lane ^ 1] + (mixed & 0xFFFFFFFFULL) * (mixed >> 32);
+			}
+		}
+		for (size_t lane = 0; lane < 4; lane++) {
+			acc[lane] = (acc[lane] ^ (acc[lane] >> 47) ^ s_Key[lane]) * PRIME32_1;
+		}
+	}
+#endif
+
+	uint64_t h = (uint64_t)size * PRIME64_5;
+	for (size_t lane = 0; lane < 4; lane++) {
+		h ^= Avalanche(acc[lane]);
+		h = ((h << 27) | (h >> 37)) * PRIME64_1 + PRIME64_4;
+	}
+	for (; idx + 8 <= size; idx += 8) {
+		h ^= Avalanche(Read64(ptr + idx) * PRIME64_2);
+		h = ((h << 27) | (h >> 37)) * PRIME64_1 + PRIME64_4;
+	}
+	for (; idx < size; idx++) {
+		h ^= ptr[idx] * PRIME64_5;
+		h = ((h << 11) | (h >> 53)) * PRIME64_1;
+	}
+	return Avalanche(h);
+}
@@ -0,0 +1,175 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "gop-planner.hpp"
+
+using namespace Plugin;
+
+// Longer cycles are evaluated per frame instead, which is a handful of divisions.
+#define SCHEDULE_MAXIMUM 16384
+
+static uint64_t GreatestCommonDivisor(uint64_t a, uint64_t b)
+{
+	while (b != 0) {
+		uint64_t t = a % b;
+		a          = b;
+		b          = t;
+	}
+	return a;
+}
+
+static inline PictureType Stronger(PictureType a, PictureType b)
+{
+	if (a == PictureType::None)
+		return b;
+	if (b == PictureType::None)
+		return a;
+	return (a < b) ? a : b;
+}
+
+bool Plugin::GOPPlanner::Periods::operator==(const Periods& other) const
+{
+	return (idr == other.idr) && (iframe == other.iframe) && (pframe == other.pframe) && (bframe == other.bframe)
+		   && (skip == other.skip) && (keepOnlyNth == other.keepOnlyNth);
+}
+
+bool Plugin::GOPPlanner::Periods::operator!=(const Periods& other) const
+{
+	return !(*this == other);
+}
+
+Plugin::GOPPlanner::GOPPlanner()
+{
+	m_Periods = {0, 0, 0, 0, 0, false};
+	m_Schedule.assign(1, Slot{PictureType::None, false, false});
+	m_Pending = PictureType::None;
+
+	m_SegmentDuration       = 0;
+	m_SegmentFPSNumerator   = 0;
+	m_SegmentFPSDenominator = 0;
+	m_Segment               = 0;
+	m_HasSegment            = false;
+}
+
+void Plugin::GOPPlanner::Configure(const Periods& periods)
+{
+	if (periods == m_Periods)
+		return;
+	m_Periods = periods;
+
+	uint64_t cycle = 1;
+	for (uint64_t period : {periods.idr, (uint64_t)periods.iframe, (uint64_t)periods.pframe,
+							(uint64_t)periods.bframe, (uint64_t)periods.skip}) {
+		if (period == 0)
+			continue;
+		cycle = cycle / GreatestCommonDivisor(cycle, period) * period;
+		if (cycle > SCHEDULE_MAXIMUM) {
+			m_Schedule.clear();
+			return;
+		}
+	}
+
+	m_Schedule.resize((size_t)cycle);
+	for (uint64_t index = 0; index < cycle; index++)
+		m_Schedule[(size_t)index] = Evaluate(index);
+}
+
+const Plugin::GOPPlanner::Periods& Plugin::GOPPlanner::GetPeriods()
+{
+	return m_Periods;
+}
+
+size_t Plugin::GOPPlanner::GetCycleLength()
+{
+	return m_Schedule.size();
+}
+
+void Plugin::GOPPlanner::SetSegmentDuration(uint32_t milliseconds, uint32_t fpsNumerator, uint32_t fpsDenominator)
+{
+	if ((fpsNumerator == 0) || (fpsDenominator == 0))
+		milliseconds = 0;
+	m_SegmentDuration       = milliseconds;
+	m_SegmentFPSNumerator   = fpsNumerator;
+	m_SegmentFPSDenominator = fpsDenominator;
+}
+
+uint32_t Plugin::GOPPlanner::GetSegmentDuration()
+{
+	return m_SegmentDuration;
+}
+
+void Plugin::GOPPlanner::Reset()
+{
+	m_Pending    = PictureType::None;
+	m_HasSegment = false;
+}
+
+void Plugin::GOPPlanner::Request(PictureType type)
+{
+	m_Pending = Stronger(m_Pending, type);
+}
+
+Plugin::PictureType Plugin::GOPPlanner::Next(uint64_t index, bool& keyframe)
+{
+	Slot slot = m_Schedule.empty() ? Evaluate(index) : m_Schedule[(size_t)(index % m_Schedule.size())];
+
+	PictureType type;
+	if (slot.skip) {
+		m_Pending = Stronger(m_Pending, slot.type);
+		type      = PictureType::Skip;
+	} else {
+		type      = Stronger(slot.type, m_Pending);
+		m_Pending = PictureType::None;
+	}
+	if (m_SegmentDuration > 0) {
+		// Integer math from the timestamp, so that nothing accumulates (index * 1000 / fps / duration).
+		uint64_t segment = index * m_SegmentFPSDenominator * 1000
+						   / ((uint64_t)m_SegmentFPSNumerator * m_SegmentDuration);
+		if (!m_HasSegment || (segment != m_Segment)) {
+			// An IDR-Frame satisfies anything that was carried over.
+			type         = PictureType::IDR;
+			m_Pending    = PictureType::None;
+			m_Segment    = segment;
+			m_HasSegment = true;
+		}
+	}
+	keyframe = slot.idr || (type == PictureType::IDR) || (type == PictureType::I);
+	return type;
+}
+
+Plugin::GOPPlanner::Slot Plugin::GOPPlanner::Evaluate(uint64_t index)
+{
+	Slot slot = {PictureType::None, false, false};
+	if ((m_Periods.bframe > 0) && ((index % m_Periods.bframe) == 0))
+		slot.type = PictureType::B;
+	if ((m_Periods.pframe > 0) && ((index % m_Periods.pframe) == 0))
+		slot.type = PictureType::P;
+	if ((m_Periods.iframe > 0) && ((index % m_Periods.iframe) == 0))
+		slot.type = PictureType::I;
+	if ((m_Periods.idr > 0) && ((index % m_Periods.idr) == 0)) {
+		slot.idr = true;
+		if (slot.type != PictureType::None)
+			slot.type = PictureType::IDR;
+	}
+	if (m_Periods.skip > 0) {
+		bool nth  = (index % m_Periods.skip) == 0;
+		slot.skip = m_Periods.keepOnlyNth ? !nth : nth;
+	}
+	return slot;
+}
@@ -0,0 +1,119 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "hrd-model.hpp"
+
+// Below this share of the buffer, the stream is getting close to an underflow.
+#define PRESSURE_THRESHOLD 0.25
+// Timestamps are rounded to 100ns, so a buffer kept exactly full by filler data would overflow by a few bits.
+#define OVERFLOW_TOLERANCE 1000000 // ns
+
+Plugin::HRDModel::HRDModel()
+{
+	m_Bitrate         = 0;
+	m_BufferSize      = 0;
+	m_InitialFullness = 1.0;
+	m_ConstantBitrate = false;
+	Reset();
+}
+
+void Plugin::HRDModel::Configure(uint64_t bitrate, uint64_t bufferSize, double initialFullness, bool constantBitrate)
+{
+	m_Bitrate         = bitrate;
+	m_BufferSize      = bufferSize;
+	m_InitialFullness = initialFullness;
+	m_ConstantBitrate = constantBitrate;
+	if (m_Running) {
+		if (m_Fullness > (double)m_BufferSize)
+			m_Fullness = (double)m_BufferSize;
+	} else {
+		m_Fullness = m_InitialFullness * (double)m_BufferSize;
+	}
+}
+
+void Plugin::HRDModel::Reset()
+{
+	m_Fullness                   = m_InitialFullness * (double)m_BufferSize;
+	m_Running                    = false;
+	m_LastTime                   = 0;
+	m_Statistics.frames          = 0;
+	m_Statistics.underflows      = 0;
+	m_Statistics.overflows       = 0;
+	m_Statistics.minimumFullness = 1.0;
+	m_Statistics.maximumFullness = 0.0;
+}
+
+bool Plugin::HRDModel::AddFrame(uint64_t bits, uint64_t time)
+{
+	if ((m_BufferSize == 0) || (m_Bitrate == 0))
+		return true;
+
+	bool valid = true;
+	if (m_Running && (time > m_LastTime)) {
+		m_Fullness += (double)m_Bitrate * (double)(time - m_LastTime) / 1000000000.0;
+		if (m_Fullness > (double)m_BufferSize) {
+			// VBR simply stops sending while the buffer is full.
+			double tolerance = (double)m_Bitrate * OVERFLOW_TOLERANCE / 1000000000.0;
+			if (m_ConstantBitrate && (m_Fullness - (double)m_BufferSize > tolerance)) {
+				m_Statistics.overflows++;
+				valid = false;
+			}
+			m_Fullness = (double)m_BufferSize;
+		}
+	}
+	m_Running  = true;
+	m_LastTime = time;
+
+	if ((double)bits > m_Fullness) {
+		// The decoder would have to wait for the rest of the frame, it continues with an empty buffer.
+		m_Statistics.underflows++;
+		valid      = false;
+		m_Fullness = 0;
+	} else {
+		m_Fullness -= (double)bits;
+	}
+
+	double fullness = GetFullness();
+	m_Statistics.frames++;
+	if (fullness < m_Statistics.minimumFullness)
+		m_Statistics.minimumFullness = fullness;
+	if (fullness > m_Statistics.maximumFullness)
+		m_Statistics.maximumFullness = fullness;
+	return valid;
+}
+
+double Plugin::HRDModel::GetFullness()
+{
+	if (m_BufferSize == 0)
+		return 0;
+	return m_Fullness / (double)m_BufferSize;
+}
+
+double Plugin::HRDModel::GetPressure()
+{
+	double fullness = GetFullness();
+	if (fullness >= PRESSURE_THRESHOLD)
+		return 0;
+	return (PRESSURE_THRESHOLD - fullness) / PRESSURE_THRESHOLD;
+}
+
+const Plugin::HRDModel::Statistics& Plugin::HRDModel::GetStatistics()
+{
+	return m_Statistics;
+}
@@ -0,0 +1,48 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "intra-refresh.hpp"
+
+Plugin::IntraRefresh::Layout Plugin::IntraRefresh::Plan(uint32_t width, uint32_t height, uint32_t fpsNumerator,
+														uint32_t fpsDenominator, uint32_t periodMs,
+														uint32_t minimumMBs, uint32_t maximumMBs)
+{
+	Layout layout = {0, 0};
+	if ((width == 0) || (height == 0) || (fpsNumerator == 0) || (fpsDenominator == 0) || (periodMs == 0)
+		|| (maximumMBs == 0))
+		return layout;
+
+	// Frames in the period, rounded, but at least one.
+	uint64_t frames = ((uint64_t)periodMs * fpsNumerator + 500ull * fpsDenominator) / (1000ull * fpsDenominator);
+	if (frames == 0)
+		frames = 1;
+
+	uint64_t columns = (width + 15) / 16, rows = (height + 15) / 16;
+	uint64_t mbs     = ((rows + frames - 1) / frames) * columns;
+	if (mbs < minimumMBs)
+		mbs = minimumMBs;
+	if (mbs > maximumMBs)
+		mbs = maximumMBs;
+	if (mbs == 0)
+		return layout;
+
+	layout.mbsPerSlot = (uint32_t)mbs;
+	layout.stripes    = (uint32_t)((columns * rows + mbs - 1) / mbs);
+	return layout;
+}
@@ -0,0 +1,190 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "lookahead.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define PLUGIN_LOOKAHEAD_SSE2
+#include <emmintrin.h>
+#endif
+
+#define BLOCK_SIZE 8
+// Header and mode cost of an intra block, keeps flat static areas from looking like they are never reused.
+#define INTRA_OVERHEAD 4.0
+// Same as x264's macroblock tree with qcompress 0.6.
+#define QP_STRENGTH 2.0
+#define QP_OFFSET_MAXIMUM 6
+#define REUSE_AVERAGE_WEIGHT 32.0
+
+Plugin::Lookahead::Lookahead()
+{
+	m_Width   = 0;
+	m_Height  = 0;
+	m_Columns = 0;
+	m_Rows    = 0;
+	SetDepth(8);
+}
+
+void Plugin::Lookahead::SetDepth(uint32_t v)
+{
+	m_Depth = v;
+	m_Window.assign(m_Depth + 1, Complexity{0, 0});
+	Reset();
+}
+
+uint32_t Plugin::Lookahead::GetDepth()
+{
+	return m_Depth;
+}
+
+void Plugin::Lookahead::Reset()
+{
+	m_HasPrevious  = false;
+	m_WindowHead   = 0;
+	m_WindowCount  = 0;
+	m_AverageReuse = 0;
+	m_HasAverage   = false;
+}
+
+Plugin::Lookahead::Complexity Plugin::Lookahead::Analyze(const uint8_t* data, size_t linesize, uint32_t width,
+														 uint32_t height, uint32_t step)
+{
+	Complexity result = {INTRA_OVERHEAD, INTRA_OVERHEAD};
+	if ((data == nullptr) || (width < BLOCK_SIZE) || (height < BLOCK_SIZE) || (step == 0))
+		return result;
+
+	if ((width != m_Width) || (height != m_Height)) {
+		m_Width   = width;
+		m_Height  = height;
+		m_Columns = width / BLOCK_SIZE;
+		m_Rows    = height / BLOCK_SIZE;
+		m_Blocks.assign(m_Columns * m_Rows, 0);
+		m_PreviousBlocks.assign(m_Columns * m_Rows, 0);
+		m_HasPrevious = false;
+	}
+
+	// Block Averages
+	std::swap(m_Blocks, m_PreviousBlocks);
+	for (uint32_t row = 0; row < m_Rows; row++) {
+		const uint8_t* line   = data + (size_t)row * BLOCK_SIZE * linesize;
+		uint8_t*       block  = m_Blocks.data() + (size_t)row * m_Columns;
+		uint32_t       column = 0;
+#ifdef PLUGIN_LOOKAHEAD_SSE2
+		if (step == 1) {
+			// SAD against zero sums each half of 16 bytes, which is one row of two blocks at once.
+			const __m128i zero = _mm_setzero_si128();
+			for (; column + 2 <= m_Columns; column += 2) {
+				const uint8_t* px   = line + (size_t)column * BLOCK_SIZE;
+				__m128i        sums = _mm_setzero_si128();
+				for (uint32_t y = 0; y < BLOCK_SIZE; y++) {
+					sums = _mm_add_epi32(
+						sums, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(px + y * linesize)), zero));
+				}
+				block[column]     = (uint8_t)(_mm_cvtsi128_si32(sums) >> 6);
+				block[column + 1] = (uint8_t)(_mm_cvtsi128_si32(_mm_srli_si128(sums, 8)) >> 6);
+			}
+		}
+#endif
+		for (; column < m_Columns; column++) {
+			const uint8_t* px  = line + (size_t)column * BLOCK_SIZE * step;
+			uint32_t       sum = 0;
+			for (uint32_t y = 0; y < BLOCK_SIZE; y++) {
+				const uint8_t* py = px + y * linesize;
+				for (uint32_t x = 0; x < BLOCK_SIZE; x++)
+					sum += py[x * step];
+			}
+			block[column] = (uint8_t)(sum / (BLOCK_SIZE * BLOCK_SIZE));
+		}
+	}
+
+	// Costs
+	const uint8_t* cur   = m_Blocks.data();
+	const uint8_t* prev  = m_PreviousBlocks.data();
+	uint64_t       intra = 0;
+	double         inter = 0;
+	for (uint32_t row = 0; row < m_Rows; row++) {
+		for (uint32_t column = 0; column < m_Columns; column++) {
+			size_t   idx      = (size_t)row * m_Columns + column;
+			int32_t  value    = cur[idx];
+			int32_t  left     = (column > 0) ? cur[idx - 1] : value;
+			int32_t  up       = (row > 0) ? cur[idx - m_Columns] : value;
+			uint32_t gradient = (uint32_t)(std::abs(value - left) + std::abs(value - up));
+			intra += gradient;
+			if (m_HasPrevious) {
+				double difference = (double)std::abs(value - (int32_t)prev[idx]);
+				double intraCost  = (double)gradient + INTRA_OVERHEAD;
+				inter += (difference < intraCost) ? difference : intraCost;
+			}
+		}
+	}
+	double count  = (double)m_Columns * (double)m_Rows;
+	result.intra  = (double)intra / count + INTRA_OVERHEAD;
+	result.inter  = m_HasPrevious ? (inter / count) : result.intra;
+	m_HasPrevious = true;
+	return result;
+}
+
+void Plugin::Lookahead::Push(const Complexity& v)
+{
+	if (m_WindowCount == m_Window.size())
+		return;
+	m_Window[(m_WindowHead + m_WindowCount) % m_Window.size()] = v;
+	m_WindowCount++;
+}
+
+size_t Plugin::Lookahead::GetCount()
+{
+	return m_WindowCount;
+}
+
+int32_t Plugin::Lookahead::Next()
+{
+	if (m_WindowCount == 0)
+		return 0;
+	m_WindowHead = (m_WindowHead + 1) % m_Window.size();
+	m_WindowCount--;
+
+	// How much of the frame ends up in the following ones, each passes on what it took from the one before.
+	double propagated = 0, chain = 1.0;
+	for (size_t idx = 0; idx < m_WindowCount; idx++) {
+		const Complexity& cplx = m_Window[(m_WindowHead + idx) % m_Window.size()];
+		chain *= 1.0 - (cplx.inter / cplx.intra);
+		propagated += chain;
+		if (chain < 0.01)
+			break;
+	}
+
+	// Relative to what is usual for this content, so the configured QP stays the average.
+	double reuse = log2(1.0 + propagated);
+	if (!m_HasAverage) {
+		m_AverageReuse = reuse;
+		m_HasAverage   = true;
+	}
+	double offset = QP_STRENGTH * (m_AverageReuse - reuse);
+	m_AverageReuse += (reuse - m_AverageReuse) / REUSE_AVERAGE_WEIGHT;
+	int32_t qp = (int32_t)lround(offset);
+	if (qp > QP_OFFSET_MAXIMUM)
+		return QP_OFFSET_MAXIMUM;
+	if (qp < -QP_OFFSET_MAXIMUM)
+		return -QP_OFFSET_MAXIMUM;
+	return qp;
+}
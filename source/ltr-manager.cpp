@@ -0,0 +1,149 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "ltr-manager.hpp"
+#include <cstring>
+
+Plugin::LTRManager::LTRManager()
+{
+	m_Period           = 0;
+	m_AcknowledgeDelay = 0;
+	Reset();
+	std::memset(&m_Statistics, 0, sizeof(m_Statistics));
+}
+
+void Plugin::LTRManager::Configure(uint32_t slots, uint32_t period, uint32_t acknowledgeDelay)
+{
+	if ((slots == m_Slots.size()) && (period == m_Period) && (acknowledgeDelay == m_AcknowledgeDelay))
+		return;
+
+	m_Slots.resize(slots);
+	m_Period           = period;
+	m_AcknowledgeDelay = acknowledgeDelay;
+	Reset();
+}
+
+void Plugin::LTRManager::Reset()
+{
+	for (Slot& slot : m_Slots)
+		slot = {false, false, 0};
+	m_HasMark   = false;
+	m_LastMark  = 0;
+	m_Loss      = false;
+	m_LossIndex = 0;
+}
+
+void Plugin::LTRManager::Acknowledge(uint64_t index)
+{
+	for (Slot& slot : m_Slots) {
+		if (slot.used && (slot.index <= index))
+			slot.acknowledged = true;
+	}
+}
+
+void Plugin::LTRManager::ReportLoss(uint64_t index)
+{
+	if (!m_Loss || (index < m_LossIndex))
+		m_LossIndex = index;
+	m_Loss = true;
+	m_Statistics.losses++;
+}
+
+bool Plugin::LTRManager::NeedsKeyframe()
+{
+	return m_Loss && (FindRecovery() < 0);
+}
+
+Plugin::LTRManager::Action Plugin::LTRManager::Next(uint64_t index, bool keyframe)
+{
+	Action action = {-1, 0};
+	if (keyframe) {
+		// An IDR-Frame empties the reference lists, but is itself the best LTR there is.
+		if (m_Loss)
+			m_Statistics.keyframes++;
+		Reset();
+	}
+	if (m_Slots.empty() || (m_Period == 0))
+		return action;
+
+	if (m_Loss) {
+		int32_t slot = FindRecovery();
+		if (slot >= 0) {
+			// Everything marked since the loss was predicted from what the receiver does not have.
+			for (Slot& other : m_Slots) {
+				if (other.used && (other.index >= m_LossIndex))
+					other = {false, false, 0};
+			}
+			action.reference = (int64_t)1 << slot;
+			m_Loss           = false;
+			m_Statistics.recovered++;
+		}
+	}
+
+	if (!m_HasMark || keyframe || ((index - m_LastMark) >= m_Period)) {
+		// Fill empty slots first, then replace the oldest one, but keep the newest acknowledged one around.
+		int32_t newest = -1, target = -1;
+		for (size_t idx = 0; idx < m_Slots.size(); idx++) {
+			const Slot& slot = m_Slots[idx];
+			if (slot.used && slot.acknowledged && ((newest < 0) || (slot.index > m_Slots[newest].index)))
+				newest = (int32_t)idx;
+		}
+		for (size_t idx = 0; idx < m_Slots.size(); idx++) {
+			const Slot& slot = m_Slots[idx];
+			if (!slot.used) {
+				target = (int32_t)idx;
+				break;
+			}
+			if (((int32_t)idx != newest) && ((target < 0) || (slot.index < m_Slots[target].index)))
+				target = (int32_t)idx;
+		}
+		if (target < 0) // Only one slot, which is also the one to keep.
+			target = 0;
+
+		m_Slots[target] = {true, false, index};
+		m_HasMark       = true;
+		m_LastMark      = index;
+		action.mark     = target;
+		m_Statistics.marked++;
+	}
+
+	// Done here instead of at the start of the next frame so that NeedsKeyframe() already knows about it.
+	if ((m_AcknowledgeDelay > 0) && ((index + 1) >= m_AcknowledgeDelay))
+		Acknowledge(index + 1 - m_AcknowledgeDelay);
+	return action;
+}
+
+const Plugin::LTRManager::Statistics& Plugin::LTRManager::GetStatistics()
+{
+	return m_Statistics;
+}
+
+int32_t Plugin::LTRManager::FindRecovery()
+{
+	// Newest frame the receiver has that was marked before the loss.
+	int32_t found = -1;
+	for (size_t idx = 0; idx < m_Slots.size(); idx++) {
+		const Slot& slot = m_Slots[idx];
+		if (!slot.used || !slot.acknowledged || (slot.index >= m_LossIndex))
+			continue;
+		if ((found < 0) || (slot.index > m_Slots[found].index))
+			found = (int32_t)idx;
+	}
+	return found;
+}
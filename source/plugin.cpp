@@ -20,17 +20,20 @@
 #pragma once
 #include "plugin.hpp"
 #include <sstream>
+#include <thread>
+#include "allocation-tracker.hpp"
 #include "amf-capabilities.hpp"
+#include "amf-encoder-pool.hpp"
 #include "amf.hpp"
 #include "api-base.hpp"
 #include "enc-h264.hpp"
 #include "enc-h265.hpp"
+#include "self-test.hpp"
 
 #pragma warning(push)
 #pragma warning(disable : 4201)
 extern "C" {
 #include <obs-module.h>
-#include <util/pipe.h>
 #include <util/platform.h>
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
@@ -46,49 +49,10 @@ BOOL WINAPI DllMain(HINSTANCE, DWORD, LPVOID)
 {
 	return TRUE;
 }
-
-static inline bool create_process(const char* cmd_line, HANDLE stdin_handle, HANDLE stdout_handle, HANDLE* process)
-{
-	PROCESS_INFORMATION pi         = {0};
-	wchar_t*            cmd_line_w = NULL;
-	STARTUPINFOW        si         = {0};
-	bool                success    = false;
-
-	si.cb         = sizeof(si);
-	si.dwFlags    = STARTF_USESTDHANDLES;
-	si.hStdInput  = stdin_handle;
-	si.hStdOutput = stdout_handle;
-
-	os_utf8_to_wcs_ptr(cmd_line, 0, &cmd_line_w);
-	if (cmd_line_w) {
-		success = !!CreateProcessW(NULL, cmd_line_w, NULL, NULL, true, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
-
-		if (success) {
-			*process = pi.hProcess;
-			CloseHandle(pi.hThread);
-		}
-
-		bfree(cmd_line_w);
-	}
-
-	return success;
-}
-
-static bool create_pipe(HANDLE* input, HANDLE* output)
-{
-	SECURITY_ATTRIBUTES sa = {0};
-
-	sa.nLength        = sizeof(sa);
-	sa.bInheritHandle = true;
-
-	if (!CreatePipe(input, output, &sa, 0)) {
-		return false;
-	}
-
-	return true;
-}
 #endif
 
+static std::thread s_WarmupThread;
+
 OBS_DECLARE_MODULE();
 OBS_MODULE_AUTHOR("Michael Fabian Dirks");
 OBS_MODULE_USE_DEFAULT_LOCALE("enc-amf", "en-US");
@@ -189,114 +153,62 @@ MODULE_EXPORT bool obs_module_load(void)
 {
 	PLOG_DEBUG("<" __FUNCTION_NAME__ "> Loading...");
 
-#ifdef _WIN32
-	// Out-of-process AMF Test
-	{
-		unsigned long returnCode = 0xFFFFFFFF;
-		HANDLE        hProcess, hIn, hOut;
-		char*         path = obs_module_file("enc-amf-test" BIT_STR ".exe");
-
-		if (!create_pipe(&hIn, &hOut)) {
-			PLOG_ERROR("Failed to create pipes for AMF test.");
-			bfree(path);
-			return false;
-		}
-		if (!SetHandleInformation(hIn, HANDLE_FLAG_INHERIT, false)
-			|| !SetHandleInformation(hOut, HANDLE_FLAG_INHERIT, false)) {
-			CloseHandle(hIn);
-			CloseHandle(hOut);
-			PLOG_ERROR("Failed to modify pipes for AMF test.");
-			bfree(path);
-			return false;
-		};
-		if (!create_process(path, hIn, hOut, &hProcess)) {
-			CloseHandle(hIn);
-			CloseHandle(hOut);
-			PLOG_ERROR("Failed to start AMF test subprocess.");
-			bfree(path);
-			return false;
-		}
-
-		bfree(path);
-		std::vector<char> buf(1024);
-		DWORD             bufread = 0;
-		while (ReadFile(hOut, buf.data(), 1024, &bufread, NULL)) {
-			PLOG_ERROR("%s", buf.data());
-		}
-
-		if (WaitForSingleObject(hProcess, 2000) == WAIT_OBJECT_0)
-			GetExitCodeProcess(hProcess, &returnCode);
+	// Without the runtime, which only ships with AMD drivers, there is nothing to offer.
+	if (!Plugin::AMD::AMF::IsAvailable()) {
+		PLOG_INFO("AMF Runtime is not installed, encoders are disabled.");
+		return false;
+	}
 
-		CloseHandle(hProcess);
-		CloseHandle(hIn);
-		CloseHandle(hOut);
+	// Out-of-process AMF Test, runs while the rest of the module initializes.
+	if (!Plugin::SelfTest::Start()) {
+		PLOG_ERROR("Failed to start AMF test subprocess.");
+		return false;
+	}
 
-		switch (returnCode) {
-		case STATUS_ACCESS_VIOLATION:
-		case STATUS_ARRAY_BOUNDS_EXCEEDED:
-		case STATUS_BREAKPOINT:
-		case STATUS_DATATYPE_MISALIGNMENT:
-		case STATUS_FLOAT_DENORMAL_OPERAND:
-		case STATUS_FLOAT_DIVIDE_BY_ZERO:
-		case STATUS_FLOAT_INEXACT_RESULT:
-		case STATUS_FLOAT_INVALID_OPERATION:
-		case STATUS_FLOAT_OVERFLOW:
-		case STATUS_FLOAT_STACK_CHECK:
-		case STATUS_FLOAT_UNDERFLOW:
-		case STATUS_GUARD_PAGE_VIOLATION:
-		case STATUS_ILLEGAL_INSTRUCTION:
-		case STATUS_IN_PAGE_ERROR:
-		case STATUS_INTEGER_DIVIDE_BY_ZERO:
-		case STATUS_INTEGER_OVERFLOW:
-		case STATUS_INVALID_DISPOSITION:
-		case STATUS_INVALID_HANDLE:
-		case STATUS_NONCONTINUABLE_EXCEPTION:
-		case STATUS_PRIVILEGED_INSTRUCTION:
-		case STATUS_SINGLE_STEP:
-		case STATUS_STACK_OVERFLOW:
-		case STATUS_UNWIND_CONSOLIDATE:
-		default:
+	// AMF, the APIs and the capabilities are all initialized on first use. A valid capability cache means this plugin
+	// and runtime already went through the in-process tests without trouble, otherwise wait for the test first.
+	Plugin::AMD::CapabilityManager::SetPrecondition([]() {
+		if (Plugin::AMD::CapabilityManager::IsCacheValid())
+			return true;
+
+		auto result = Plugin::SelfTest::Wait(SELFTEST_TIMEOUT);
+		switch (result.status) {
+		case Plugin::SelfTest::Status::Passed:
+			return true;
+		case Plugin::SelfTest::Status::Pending:
+			PLOG_ERROR("AMF Test did not finish within %d ms.", SELFTEST_TIMEOUT);
+			break;
+		case Plugin::SelfTest::Status::Crashed:
 			PLOG_ERROR("A critical error occured during AMF Testing.");
-			return false;
-		case 2:
-		case 1:
+			break;
+		case Plugin::SelfTest::Status::Failed:
 			PLOG_ERROR("AMF Test failed due to one or more errors.");
-			return false;
-		case 0:
 			break;
 		}
-	}
-#endif
-
-	// AMF
-	try {
-		Plugin::AMD::AMF::Initialize();
-	} catch (const std::exception& e) {
-		PLOG_ERROR("Encountered Exception during AMF initialization: %s", e.what());
-		return false;
-	} catch (...) {
-		PLOG_ERROR("Unexpected Exception during AMF initialization.");
 		return false;
-	}
-
-	// Initialize Graphics APIs
-	Plugin::API::InitializeAPIs();
-
-	// AMF Capabilities
-	try {
-		Plugin::AMD::CapabilityManager::Initialize();
-	} catch (const std::exception& e) {
-		PLOG_ERROR("Encountered Exception during Capability Manager initialization: %s", e.what());
-		return false;
-	} catch (...) {
-		PLOG_ERROR("Unexpected Exception during Capability Manager initialization.");
-		return false;
-	}
+	});
 
 	// Register Encoders
 	Plugin::Interface::H264Interface::encoder_register();
 	Plugin::Interface::H265Interface::encoder_register();
 
+	// Warm up in the background so the first properties dialog or encoder does not have to.
+	s_WarmupThread = std::thread([]() {
+		try {
+			auto caps = Plugin::AMD::CapabilityManager::Instance();
+			if (Plugin::AMD::EncoderPool::IsEnabled()) {
+				if (caps->IsCodecSupported(Plugin::AMD::Codec::AVC))
+					Plugin::Interface::H264Interface::prepare();
+				if (caps->IsCodecSupported(Plugin::AMD::Codec::HEVC))
+					Plugin::Interface::H265Interface::prepare();
+			}
+		} catch (const std::exception& e) {
+			PLOG_ERROR("Encountered Exception during Capability Manager initialization: %s", e.what());
+		} catch (...) {
+			PLOG_ERROR("Unexpected Exception during Capability Manager initialization.");
+		}
+	});
+
 #ifdef _DEBUG
 	{
 		PLOG_INFO("Dumping Parameter Information...");
@@ -353,9 +265,14 @@ MODULE_EXPORT bool obs_module_load(void)
 /** Optional: Called when the module is unloaded.  */
 MODULE_EXPORT void obs_module_unload(void)
 {
+	if (s_WarmupThread.joinable())
+		s_WarmupThread.join();
+	Plugin::SelfTest::Finalize();
+	Plugin::AMD::EncoderPool::Finalize();
 	Plugin::AMD::CapabilityManager::Finalize();
 	Plugin::API::FinalizeAPIs();
 	Plugin::AMD::AMF::Finalize();
+	Plugin::Allocation::Log();
 }
 
 /** Optional: Returns the full name of the module */
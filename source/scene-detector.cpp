@@ -0,0 +1,174 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "scene-detector.hpp"
+#include <cstring>
+#include <utility>
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define PLUGIN_SCENE_SSE2
+#include <emmintrin.h>
+#endif
+
+#define THUMBNAIL_ROW_STEP 16 // Every 16th row
+#define THUMBNAIL_COLUMN_SIZE 8 // Averaged into one sample
+
+// A cut differs this much more than the recent frames did, and at least by the minimum.
+#define CUT_DIFFERENCE_RATIO 3.0
+#define CUT_DIFFERENCE_MINIMUM 12.0
+#define CUT_HISTOGRAM_MINIMUM 0.25
+
+Plugin::SceneDetector::SceneDetector()
+{
+	m_MinimumDistance = 15;
+	m_Width           = 0;
+	m_Height          = 0;
+	m_Columns         = 0;
+	m_Rows            = 0;
+	Reset();
+}
+
+void Plugin::SceneDetector::SetMinimumDistance(uint32_t v)
+{
+	m_MinimumDistance = v;
+}
+
+uint32_t Plugin::SceneDetector::GetMinimumDistance()
+{
+	return m_MinimumDistance;
+}
+
+void Plugin::SceneDetector::Reset()
+{
+	m_Distance              = 0;
+	m_HasPrevious           = false;
+	m_AverageDifference     = 0;
+	m_LastDifference        = 0;
+	m_LastHistogramDistance = 0;
+	std::memset(m_Histogram, 0, sizeof(m_Histogram));
+	std::memset(m_PreviousHistogram, 0, sizeof(m_PreviousHistogram));
+}
+
+bool Plugin::SceneDetector::Analyze(const uint8_t* data, size_t linesize, uint32_t width, uint32_t height,
+									uint32_t step)
+{
+	if ((data == nullptr) || (width < THUMBNAIL_COLUMN_SIZE) || (height == 0) || (step == 0))
+		return false;
+
+	if ((width != m_Width) || (height != m_Height)) {
+		m_Width   = width;
+		m_Height  = height;
+		m_Columns = width / THUMBNAIL_COLUMN_SIZE;
+		m_Rows    = (height + THUMBNAIL_ROW_STEP - 1) / THUMBNAIL_ROW_STEP;
+		m_Thumbnail.assign(m_Columns * m_Rows, 0);
+		m_PreviousThumbnail.assign(m_Columns * m_Rows, 0);
+		Reset();
+	}
+	m_Distance++;
+
+	// Thumbnail
+	std::swap(m_Thumbnail, m_PreviousThumbnail);
+	std::memcpy(m_PreviousHistogram, m_Histogram, sizeof(m_Histogram));
+	std::memset(m_Histogram, 0, sizeof(m_Histogram));
+	for (uint32_t row = 0; row < m_Rows; row++) {
+		const uint8_t* line   = data + (size_t)row * THUMBNAIL_ROW_STEP * linesize;
+		uint8_t*       thumb  = m_Thumbnail.data() + (size_t)row * m_Columns;
+		uint32_t       column = 0;
+#ifdef PLUGIN_SCENE_SSE2
+		if (step == 1) {
+			// SAD against zero sums each half of 16 bytes, which is two thumbnail samples at once.
+			const __m128i zero = _mm_setzero_si128();
+			for (; column + 2 <= m_Columns; column += 2) {
+				__m128i sums = _mm_sad_epu8(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(line + column * THUMBNAIL_COLUMN_SIZE)), zero);
+				thumb[column]     = (uint8_t)(_mm_cvtsi128_si32(sums) >> 3);
+				thumb[column + 1] = (uint8_t)(_mm_extract_epi16(sums, 4) >> 3);
+			}
+		}
+#endif
+		for (; column < m_Columns; column++) {
+			const uint8_t* px  = line + (size_t)column * THUMBNAIL_COLUMN_SIZE * step;
+			uint32_t       sum = 0;
+			for (uint32_t idx = 0; idx < THUMBNAIL_COLUMN_SIZE; idx++)
+				sum += px[idx * step];
+			thumb[column] = (uint8_t)(sum / THUMBNAIL_COLUMN_SIZE);
+		}
+		for (column = 0; column < m_Columns; column++)
+			m_Histogram[thumb[column] >> 3]++;
+	}
+	if (!m_HasPrevious) {
+		m_HasPrevious = true;
+		return false;
+	}
+
+	// Difference to the previous thumbnail
+	const uint8_t* cur   = m_Thumbnail.data();
+	const uint8_t* prev  = m_PreviousThumbnail.data();
+	size_t         count = m_Thumbnail.size(), idx = 0;
+	uint64_t       sad   = 0;
+#ifdef PLUGIN_SCENE_SSE2
+	{
+		__m128i acc = _mm_setzero_si128();
+		for (; idx + 16 <= count; idx += 16) {
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + idx)),
+												  _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + idx))));
+		}
+		sad = (uint64_t)_mm_cvtsi128_si32(acc) + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+	}
+#endif
+	for (; idx < count; idx++)
+		sad += (cur[idx] > prev[idx]) ? (cur[idx] - prev[idx]) : (prev[idx] - cur[idx]);
+
+	uint64_t histogram = 0;
+	for (size_t bin = 0; bin < 32; bin++) {
+		histogram += (m_Histogram[bin] > m_PreviousHistogram[bin]) ? (m_Histogram[bin] - m_PreviousHistogram[bin])
+																	 : (m_PreviousHistogram[bin] - m_Histogram[bin]);
+	}
+
+	m_LastDifference        = (double)sad / (double)count;
+	m_LastHistogramDistance = (double)histogram / (double)(2 * count);
+
+	bool cut = (m_LastDifference > CUT_DIFFERENCE_MINIMUM)
+			   && (m_LastDifference > (m_AverageDifference * CUT_DIFFERENCE_RATIO))
+			   && (m_LastHistogramDistance > CUT_HISTOGRAM_MINIMUM);
+	if (cut && (m_Distance >= m_MinimumDistance)) {
+		m_Distance = 0;
+		return true;
+	}
+
+	// Cuts would make the following ones harder to detect, only regular frames make up the average.
+	if (!cut)
+		m_AverageDifference += (m_LastDifference - m_AverageDifference) / 8.0;
+	return false;
+}
+
+void Plugin::SceneDetector::NotifyKeyframe()
+{
+	m_Distance = 0;
+}
+
+double Plugin::SceneDetector::GetLastDifference()
+{
+	return m_LastDifference;
+}
+
+double Plugin::SceneDetector::GetLastHistogramDistance()
+{
+	return m_LastHistogramDistance;
+}
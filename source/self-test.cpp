@@ -0,0 +1,386 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "self-test.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include "plugin.hpp"
+
+#if defined(_WIN32) || defined(_WIN64)
+extern "C" {
+#include <windows.h>
+}
+#define SELFTEST_EXECUTABLE "enc-amf-test" BIT_STR ".exe"
+#else
+extern "C" {
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+}
+#define SELFTEST_EXECUTABLE "enc-amf-test" BIT_STR
+#endif
+
+using namespace Plugin;
+
+static std::mutex                            s_lock;
+static std::condition_variable               s_cv;
+static std::thread                           s_thread;
+static std::thread                           s_errorThread;
+static SelfTest::Result                      s_result;
+static std::chrono::steady_clock::time_point s_started;
+static bool                                  s_done = false;
+#if defined(_WIN32) || defined(_WIN64)
+static HANDLE s_process = NULL;
+static HANDLE s_output  = NULL;
+static HANDLE s_error   = NULL;
+#else
+static pid_t s_process = -1;
+static int   s_output  = -1;
+static int   s_error   = -1;
+static bool  s_reaped  = false; // Once set the pid may belong to another process, so it must not be killed.
+#endif
+
+static void ParseRecord(const std::string& line)
+{
+	std::vector<std::string> fields;
+	std::stringstream        stream(line);
+	std::string              field;
+	while (std::getline(stream, field, '\t'))
+		fields.push_back(field);
+	if (fields.size() == 0)
+		return;
+
+	if (fields[0] == SELFTEST_RECORD_VERSION) {
+		if ((fields.size() < 2) || (std::strtol(fields[1].c_str(), nullptr, 10) != SELFTEST_PROTOCOL_VERSION))
+			s_result.errors.push_back("Unknown protocol version '" + line + "'.");
+	} else if (fields[0] == SELFTEST_RECORD_PROBE) {
+		if (fields.size() < 6) {
+			s_result.errors.push_back("Malformed record '" + line + "'.");
+			return;
+		}
+		SelfTest::Probe probe;
+		probe.api       = fields[1];
+		probe.adapter   = fields[2];
+		probe.codec     = fields[3];
+		probe.supported = (fields[4] == "1");
+		probe.time      = std::strtoull(fields[5].c_str(), nullptr, 10);
+		s_result.probes.push_back(probe);
+	} else if (fields[0] == SELFTEST_RECORD_ERROR) {
+		s_result.errors.push_back(fields.size() > 1 ? fields[1] : "");
+	} else if (fields[0] == SELFTEST_RECORD_DONE) {
+		if (fields.size() < 2) {
+			s_result.errors.push_back("Malformed record '" + line + "'.");
+			return;
+		}
+		s_result.duration = std::strtoull(fields[1].c_str(), nullptr, 10);
+	} else if (line.size() > 0) {
+		// Not part of the protocol, the runtime or drivers printing to stdout. Only worth a look when debugging.
+		PLOG_DEBUG("AMF Test: %s", line.c_str());
+	}
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+static void ReadLines(HANDLE handle, std::function<void(const std::string&)> fn)
+#else
+static void ReadLines(int handle, std::function<void(const std::string&)> fn)
+#endif
+{
+	std::vector<char> buf(1024);
+	std::string       pending;
+	for (;;) {
+#if defined(_WIN32) || defined(_WIN64)
+		DWORD read = 0;
+		if (!ReadFile(handle, buf.data(), (DWORD)buf.size(), &read, NULL) || (read == 0))
+			break;
+#else
+		ssize_t read = ::read(handle, buf.data(), buf.size());
+		if (read <= 0)
+			break;
+#endif
+		pending.append(buf.data(), (size_t)read);
+
+		size_t eol;
+		while ((eol = pending.find('\n')) != std::string::npos) {
+			std::string line = pending.substr(0, eol);
+			pending.erase(0, eol + 1);
+			if ((line.size() > 0) && (line.back() == '\r'))
+				line.pop_back();
+			fn(line);
+		}
+	}
+	if (pending.size() > 0)
+		fn(pending);
+}
+
+static void ErrorReader()
+{
+	// Whatever ends up on stderr comes from the runtime or drivers, not from the test itself.
+	ReadLines(s_error, [](const std::string& line) {
+		if (line.size() > 0)
+			PLOG_INFO("AMF Test (stderr): %s", line.c_str());
+	});
+}
+
+static void Reader()
+{
+	ReadLines(s_output, [](const std::string& line) {
+		std::unique_lock<std::mutex> lock(s_lock);
+		ParseRecord(line);
+	});
+
+	// The pipe closes when the process exits, collect the exit code.
+	int64_t exitCode = -1;
+	bool    crashed  = true;
+#if defined(_WIN32) || defined(_WIN64)
+	DWORD code = 0;
+	if ((WaitForSingleObject(s_process, INFINITE) == WAIT_OBJECT_0) && GetExitCodeProcess(s_process, &code)) {
+		exitCode = code;
+		// Exceptions terminate the process with an NTSTATUS code, anything the test returns itself is small.
+		crashed = (code > 2);
+	}
+#else
+	// Reaped under the lock, Finalize() must never see the pid reaped but not marked as such.
+	int   status = 0;
+	pid_t pid    = 0;
+	while (pid == 0) {
+		{
+			std::unique_lock<std::mutex> lock(s_lock);
+			pid = waitpid(s_process, &status, WNOHANG);
+			if (pid != 0)
+				s_reaped = true;
+		}
+		if (pid == 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	if (pid == s_process) {
+		if (WIFEXITED(status)) {
+			exitCode = WEXITSTATUS(status);
+			crashed  = false;
+		} else if (WIFSIGNALED(status)) {
+			exitCode = WTERMSIG(status);
+		}
+	}
+#endif
+
+	std::unique_lock<std::mutex> lock(s_lock);
+	s_result.exitCode = exitCode;
+	s_result.wallTime = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+							std::chrono::steady_clock::now() - s_started)
+							.count();
+	if (crashed) {
+		s_result.status = SelfTest::Status::Crashed;
+	} else if ((exitCode != 0) || (s_result.errors.size() > 0)) {
+		s_result.status = SelfTest::Status::Failed;
+	} else {
+		s_result.status = SelfTest::Status::Passed;
+	}
+	s_done = true;
+
+	PLOG_INFO("AMF Test %s after %" PRIu64 " ms (exit code %" PRId64 ").", SelfTest::StatusToString(s_result.status),
+			  s_result.wallTime / 1000, s_result.exitCode);
+	for (auto& probe : s_result.probes) {
+		PLOG_DEBUG("AMF Test: %s Adapter '%s' with codec %s: %s (%" PRIu64 " us)", probe.api.c_str(),
+				   probe.adapter.c_str(), probe.codec.c_str(), probe.supported ? "Supported" : "Not Supported",
+				   probe.time);
+	}
+	for (auto& error : s_result.errors) {
+		PLOG_ERROR("AMF Test: %s", error.c_str());
+	}
+	s_cv.notify_all();
+}
+
+bool Plugin::SelfTest::Start()
+{
+	std::unique_lock<std::mutex> lock(s_lock);
+	if (s_thread.joinable())
+		return true;
+
+	char* path = obs_module_file(SELFTEST_EXECUTABLE);
+	if (!path) {
+		PLOG_ERROR("Unable to find '%s'.", SELFTEST_EXECUTABLE);
+		return false;
+	}
+
+	s_result  = Result();
+	s_done    = false;
+	s_started = std::chrono::steady_clock::now();
+
+#if defined(_WIN32) || defined(_WIN64)
+	// Only the write ends are inherited by the child, the plugin keeps the read ends.
+	SECURITY_ATTRIBUTES sa = {0};
+	sa.nLength             = sizeof(sa);
+	sa.bInheritHandle      = true;
+	HANDLE hWrite          = NULL;
+	HANDLE hErrorWrite     = NULL;
+	if (!CreatePipe(&s_output, &hWrite, &sa, 0) || !SetHandleInformation(s_output, HANDLE_FLAG_INHERIT, 0)
+		|| !CreatePipe(&s_error, &hErrorWrite, &sa, 0) || !SetHandleInformation(s_error, HANDLE_FLAG_INHERIT, 0)) {
+		if (s_output)
+			CloseHandle(s_output);
+		if (hWrite)
+			CloseHandle(hWrite);
+		if (s_error)
+			CloseHandle(s_error);
+		if (hErrorWrite)
+			CloseHandle(hErrorWrite);
+		s_output = NULL;
+		s_error  = NULL;
+		PLOG_ERROR("Failed to create pipes for AMF test.");
+		bfree(path);
+		return false;
+	}
+
+	PROCESS_INFORMATION pi         = {0};
+	STARTUPINFOW        si         = {0};
+	wchar_t*            cmd_line_w = NULL;
+	bool                success    = false;
+	si.cb                          = sizeof(si);
+	si.dwFlags                     = STARTF_USESTDHANDLES;
+	si.hStdInput                   = NULL;
+	si.hStdOutput                  = hWrite;
+	si.hStdError                   = hErrorWrite;
+	os_utf8_to_wcs_ptr(path, 0, &cmd_line_w);
+	if (cmd_line_w) {
+		success = !!CreateProcessW(NULL, cmd_line_w, NULL, NULL, true, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+		bfree(cmd_line_w);
+	}
+	CloseHandle(hWrite);
+	CloseHandle(hErrorWrite);
+	bfree(path);
+	if (!success) {
+		CloseHandle(s_output);
+		CloseHandle(s_error);
+		s_output = NULL;
+		s_error  = NULL;
+		PLOG_ERROR("Failed to start AMF test subprocess.");
+		return false;
+	}
+	CloseHandle(pi.hThread);
+	s_process = pi.hProcess;
+#else
+	int fds[2], errorFds[2];
+	if (pipe(fds) != 0) {
+		PLOG_ERROR("Failed to create pipes for AMF test.");
+		bfree(path);
+		return false;
+	}
+	if (pipe(errorFds) != 0) {
+		close(fds[0]);
+		close(fds[1]);
+		PLOG_ERROR("Failed to create pipes for AMF test.");
+		bfree(path);
+		return false;
+	}
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, errorFds[1], STDERR_FILENO);
+	posix_spawn_file_actions_addclose(&actions, fds[0]);
+	posix_spawn_file_actions_addclose(&actions, fds[1]);
+	posix_spawn_file_actions_addclose(&actions, errorFds[0]);
+	posix_spawn_file_actions_addclose(&actions, errorFds[1]);
+	char* argv[] = {path, nullptr};
+	int   error  = posix_spawn(&s_process, path, &actions, nullptr, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	close(fds[1]);
+	close(errorFds[1]);
+	bfree(path);
+	if (error != 0) {
+		close(fds[0]);
+		close(errorFds[0]);
+		s_process = -1;
+		PLOG_ERROR("Failed to start AMF test subprocess.");
+		return false;
+	}
+	s_output = fds[0];
+	s_error  = errorFds[0];
+	s_reaped = false;
+#endif
+
+	s_thread      = std::thread(Reader);
+	s_errorThread = std::thread(ErrorReader);
+	return true;
+}
+
+Plugin::SelfTest::Result Plugin::SelfTest::Wait(uint32_t timeout)
+{
+	std::unique_lock<std::mutex> lock(s_lock);
+	s_cv.wait_for(lock, std::chrono::milliseconds(timeout), [] { return s_done || !s_thread.joinable(); });
+	return s_result;
+}
+
+void Plugin::SelfTest::Finalize()
+{
+	{
+		std::unique_lock<std::mutex> lock(s_lock);
+		if (!s_thread.joinable())
+			return;
+
+		// Killing the process closes the pipe, which lets the reader finish.
+		if (!s_done) {
+			PLOG_WARNING("AMF Test is still running, terminating it.");
+#if defined(_WIN32) || defined(_WIN64)
+			TerminateProcess(s_process, 0xFFFFFFFF);
+#else
+			if (!s_reaped)
+				kill(s_process, SIGKILL);
+#endif
+		}
+	}
+	s_thread.join();
+	s_errorThread.join();
+
+#if defined(_WIN32) || defined(_WIN64)
+	CloseHandle(s_process);
+	CloseHandle(s_output);
+	CloseHandle(s_error);
+	s_process = NULL;
+	s_output  = NULL;
+	s_error   = NULL;
+#else
+	close(s_output);
+	close(s_error);
+	s_process = -1;
+	s_output  = -1;
+	s_error   = -1;
+#endif
+}
+
+const char* Plugin::SelfTest::StatusToString(Status v)
+{
+	switch (v) {
+	case Status::Pending:
+		return "Pending";
+	case Status::Passed:
+		return "Passed";
+	case Status::Failed:
+		return "Failed";
+	case Status::Crashed:
+		return "Crashed";
+	}
+	throw std::runtime_error("Invalid Parameter");
+}
@@ -0,0 +1,97 @@
+/*
+ * A Plugin that integrates the AMD AMF encoder into OBS Studio
+ * Copyright (C) 2016 - 2018 Michael Fabian Dirks
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ */
+
+#include "temporal-layers.hpp"
+
+#define NAL_SLICE 1
+#define NAL_SLICE_IDR 5
+#define NAL_PREFIX 14
+#define NAL_SLICE_EXTENSION 20
+
+#define PRIORITY_DISPOSABLE 0
+#define PRIORITY_LOW 1
+#define PRIORITY_HIGH 2
+
+uint8_t Plugin::TemporalLayers::Find(const uint8_t* data, size_t size, uint8_t layers)
+{
+	if (layers <= 1)
+		return 0;
+
+	uint8_t top = layers - 1;
+	for (size_t pos = 0; (pos + 3) < size; pos++) {
+		// Start codes are 00 00 01, the four byte version just has another zero in front.
+		if ((data[pos] != 0) || (data[pos + 1] != 0) || (data[pos + 2] != 1))
+			continue;
+		pos += 3;
+
+		uint8_t header = data[pos];
+		uint8_t type   = header & 0x1F;
+		if ((type == NAL_PREFIX) || (type == NAL_SLICE_EXTENSION)) {
+			// svc_extension_flag, then priority_id, dependency_id, quality_id and finally temporal_id in the top
+			// three bits of the last byte. Without the flag this is an MVC header, which is of no use here.
+			if (((pos + 3) < size) && (data[pos + 1] & 0x80)) {
+				uint8_t layer = data[pos + 3] >> 5;
+				return (layer > top) ? top : layer;
+			}
+		} else if ((type == NAL_SLICE) || (type == NAL_SLICE_IDR)) {
+			// A prefix would have come before the first slice.
+			return ((header & 0x60) == 0) ? top : 0;
+		}
+	}
+	return 0;
+}
+
+int Plugin::TemporalLayers::Priority(uint8_t layer, uint8_t layers)
+{
+	if (layer == 0)
+		return PRIORITY_HIGH;
+	if (layer >= (layers - 1))
+		return PRIORITY_DISPOSABLE;
+	return PRIORITY_LOW;
+}
+
+double Plugin::TemporalLayers::FrameShare(uint8_t layer, uint8_t layers)
+{
+	if ((layers <= 1) || (layer >= layers))
+		return (layer == 0) ? 1.0 : 0.0;
+
+	// Layer 0 and 1 carry one frame each per cycle of 2^(n-1), every layer above twice as many as the one below.
+	double cycle = (double)(1ull << (layers - 1));
+	if (layer == 0)
+		return 1.0 / cycle;
+	return (double)(1ull << (layer - 1)) / cycle;
+}
+
+uint64_t Plugin::TemporalLayers::Bitrate(uint8_t layer, uint8_t layers, uint64_t bitrate, double baseShare)
+{
+	if (layers <= 1)
+		return (layer == 0) ? bitrate : 0;
+	if (layer >= layers)
+		return 0;
+
+	if (baseShare < 0.0)
+		baseShare = 0.0;
+	else if (baseShare > 1.0)
+		baseShare = 1.0;
+	if (layer == 0)
+		return (uint64_t)(bitrate * baseShare);
+
+	double enhancement = 1.0 - FrameShare(0, layers);
+	return (uint64_t)(bitrate * (1.0 - baseShare) * FrameShare(layer, layers) / enhancement);
+}
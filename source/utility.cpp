@@ -26,6 +26,7 @@
 #include "amf-encoder-h265.hpp"
 #include "amf-encoder.hpp"
 #include "amf.hpp"
+#include "clock.hpp"
 
 #include <components/VideoConverter.h>
 #include <components/VideoEncoderHEVC.h>
@@ -96,6 +97,47 @@ const char* Utility::obs_module_text_multi(const char* key, uint8_t depth)
 #endif
 }
 
+#ifndef LITE_OBS
+struct OutputCongestionQuery {
+	obs_encoder_t* encoder;
+	bool           found;
+	double         congestion;
+	double         ratio;
+	uint64_t       dropped, total;
+};
+
+bool Utility::GetOutputCongestion(obs_encoder_t* encoder, double& congestion, uint64_t& dropped, uint64_t& total)
+{
+	OutputCongestionQuery query = {encoder, false, 0, 0, 0, 0};
+	obs_enum_outputs(
+		[](void* param, obs_output_t* output) {
+			OutputCongestionQuery* query = static_cast<OutputCongestionQuery*>(param);
+			if (!obs_output_active(output) || (obs_output_get_video_encoder(output) != query->encoder))
+				return true;
+
+			// Recording and streaming can share an encoder, the worst one decides. The frame counters have to come
+			// from the same output, a recording never drops but counts the most frames.
+			uint64_t dropped = (uint64_t)obs_output_get_frames_dropped(output);
+			uint64_t total   = (uint64_t)obs_output_get_total_frames(output);
+			double   ratio   = (total > 0) ? ((double)dropped / (double)total) : 0.0;
+			if (!query->found || (ratio > query->ratio)) {
+				query->ratio   = ratio;
+				query->dropped = dropped;
+				query->total   = total;
+			}
+			query->found      = true;
+			query->congestion = max(query->congestion, (double)obs_output_get_congestion(output));
+			return true;
+		},
+		&query);
+
+	congestion = query.congestion;
+	dropped    = query.dropped;
+	total      = query.total;
+	return query.found;
+}
+#endif
+
 // Codec
 const char* Utility::CodecToString(Plugin::AMD::Codec v)
 {
@@ -686,6 +728,51 @@ const char* Utility::SliceControlModeToString(Plugin::AMD::SliceControlMode v)
 	throw std::runtime_error("Invalid Parameter");
 }
 
+const char* Utility::SceneCutModeToString(Plugin::AMD::SceneCutMode v)
+{
+	switch (v) {
+	case SceneCutMode::Disabled:
+		return "Disabled";
+	case SceneCutMode::IFrame:
+		return "I-Frame";
+	case SceneCutMode::IDRFrame:
+		return "IDR-Frame";
+	}
+	throw std::runtime_error("Invalid Parameter");
+}
+
+const char* Utility::HRDModelModeToString(Plugin::AMD::HRDModelMode v)
+{
+	switch (v) {
+	case HRDModelMode::Disabled:
+		return "Disabled";
+	case HRDModelMode::Monitor:
+		return "Monitor";
+	case HRDModelMode::Feedback:
+		return "Feedback";
+	}
+	throw std::runtime_error("Invalid Parameter");
+}
+
+const char* Utility::PictureTypeToString(Plugin::PictureType v)
+{
+	switch (v) {
+	case PictureType::None:
+		return "Automatic";
+	case PictureType::Skip:
+		return "Skip";
+	case PictureType::IDR:
+		return "IDR";
+	case PictureType::I:
+		return "I";
+	case PictureType::P:
+		return "P";
+	case PictureType::B:
+		return "B";
+	}
+	return "Unknown";
+}
+
 Plugin::AMD::ProfileLevel Utility::H264ProfileLevel(std::pair<uint32_t, uint32_t> resolution,
 													std::pair<uint32_t, uint32_t> frameRate)
 {
@@ -812,8 +899,27 @@ void Utility::SetThreadName(std::thread* pthread, const char* threadName)
 	Utility::SetThreadName(threadId, threadName);
 }
 
+uint64_t Utility::GetThreadCPUTime()
+{
+	// Cycles are counted at the TSC rate and are exact per call.
+	ULONG64 cycles;
+	if (Clock::IsTSC() && QueryThreadCycleTime(GetCurrentThread(), &cycles))
+		return Clock::ToNanoseconds(cycles);
+
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return 0;
+
+	// FILETIME is in 100 nanosecond units but advances with the scheduler tick (about 15.6 ms), so this is only
+	// meaningful when summed up over many frames.
+	uint64_t kernel100 = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+	uint64_t user100   = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+	return (kernel100 + user100) * 100;
+}
+
 #else // Linux, Mac
 #include <sys/prctl.h>
+#include <time.h>
 
 void Utility::SetThreadName(std::thread* pthread, const char* threadName)
 {
@@ -825,4 +931,12 @@ void Utility::SetThreadName(const char* threadName)
 	prctl(PR_SET_NAME, threadName, 0, 0, 0);
 }
 
+uint64_t Utility::GetThreadCPUTime()
+{
+	struct timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+		return 0;
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
 #endif